@@ -38,5 +38,10 @@ test-phpdbg:
 	@echo "Running phpdbg tests ..."
 	@$(top_builddir)/sapi/cli/php sapi/phpdbg/tests/run-tests.php --phpdbg sapi/phpdbg/phpdbg
 
-.PHONY: clean-phpdbg test-phpdbg
+bench-phpdbg-escape:
+	@echo "Running phpdbg escaper benchmark ..."
+	@$(CC) -O2 $(CFLAGS_CLEAN) -I$(srcdir) $(srcdir)/tests/bench/escape.c $(srcdir)/phpdbg_escape.c -o $(builddir)/escape-bench
+	@$(builddir)/escape-bench
+
+.PHONY: clean-phpdbg test-phpdbg bench-phpdbg-escape
 
@@ -13,6 +13,7 @@ PHP_ARG_ENABLE(phpdbg-debug, for phpdbg debug build,
 
 if test "$BUILD_PHPDBG" == "" && test "$PHP_PHPDBG" != "no"; then
   AC_HEADER_TIOCGWINSZ
+  AC_CHECK_HEADERS([sys/epoll.h])
   AC_DEFINE(HAVE_PHPDBG, 1, [ ])
 
   if test "$PHP_PHPDBG_DEBUG" != "no"; then
@@ -29,11 +30,16 @@ if test "$BUILD_PHPDBG" == "" && test "$PHP_PHPDBG" != "no"; then
   fi
 
   PHP_PHPDBG_CFLAGS="-D_GNU_SOURCE"
-  PHP_PHPDBG_FILES="phpdbg.c phpdbg_parser.c phpdbg_lexer.c phpdbg_prompt.c phpdbg_help.c phpdbg_break.c phpdbg_print.c phpdbg_bp.c phpdbg_opcode.c phpdbg_list.c phpdbg_utils.c phpdbg_info.c phpdbg_cmd.c phpdbg_set.c phpdbg_frame.c phpdbg_watch.c phpdbg_btree.c phpdbg_sigsafe.c phpdbg_wait.c phpdbg_io.c phpdbg_eol.c phpdbg_out.c"
+  PHP_PHPDBG_FILES="phpdbg.c phpdbg_parser.c phpdbg_lexer.c phpdbg_prompt.c phpdbg_help.c phpdbg_break.c phpdbg_print.c phpdbg_bp.c phpdbg_opcode.c phpdbg_list.c phpdbg_utils.c phpdbg_info.c phpdbg_cmd.c phpdbg_set.c phpdbg_frame.c phpdbg_watch.c phpdbg_btree.c phpdbg_sigsafe.c phpdbg_wait.c phpdbg_io.c phpdbg_eol.c phpdbg_out.c phpdbg_escape.c phpdbg_observe.c phpdbg_iothread.c"
 
   if test "$PHP_READLINE" != "no" -o  "$PHP_LIBEDIT" != "no"; then
   	PHPDBG_EXTRA_LIBS="$PHP_READLINE_LIBS"
   fi
+
+  AC_CHECK_LIB(pthread, pthread_create, [
+    AC_DEFINE(HAVE_PHPDBG_IOTHREAD, 1, [ ])
+    PHPDBG_EXTRA_LIBS="$PHPDBG_EXTRA_LIBS -lpthread"
+  ])
   
   PHP_SUBST(PHP_PHPDBG_CFLAGS)
   PHP_SUBST(PHP_PHPDBG_FILES)
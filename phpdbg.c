@@ -29,6 +29,10 @@
 #include "phpdbg_utils.h"
 #include "phpdbg_set.h"
 #include "phpdbg_io.h"
+#include "phpdbg_observe.h"
+#include "phpdbg_iothread.h"
+#include "phpdbg_wait.h"
+#include "phpdbg_opcode.h"
 #include "zend_alloc.h"
 #include "phpdbg_eol.h"
 
@@ -40,6 +44,7 @@
 #	include <sys/types.h>
 #	include <sys/poll.h>
 #	include <netinet/in.h>
+#	include <netinet/tcp.h>
 #	include <unistd.h>
 #	include <arpa/inet.h>
 #endif /* }}} */
@@ -87,17 +92,38 @@ static inline void php_phpdbg_globals_ctor(zend_phpdbg_globals *pg) /* {{{ */
 	pg->bp_count = 0;
 	pg->flags = PHPDBG_DEFAULT_FLAGS;
 	pg->oplog = NULL;
+	pg->tracelog = NULL;
+	pg->breakcmds_def = NULL;
 	memset(pg->io, 0, sizeof(pg->io));
 	pg->frame.num = 0;
 	pg->sapi_name_ptr = NULL;
 	pg->socket_client_stream = NULL;
 	pg->socket_server_stream = NULL;
+	pg->pool.lock = -1;
+	pg->pool.worker = 0;
+	pg->pool.console = 0;
+	memset(&pg->webdata, 0, sizeof(pg->webdata));
+	memset(&pg->replay, 0, sizeof(pg->replay));
+	memset(&pg->ini_cache, 0, sizeof(pg->ini_cache));
 
 	pg->req_id = 0;
 	pg->err_buf.active = 0;
 	pg->err_buf.type = 0;
-
-	pg->input_buflen = 0;
+	memset(&pg->out_buf, 0, sizeof(pg->out_buf));
+	memset(&pg->json_tag, 0, sizeof(pg->json_tag));
+	memset(pg->io_stats, 0, sizeof(pg->io_stats));
+	pg->observers.server = -1;
+	pg->observers.loop = -1;
+	pg->observers.controller = -1;
+	pg->observers.num = 0;
+	pg->observers.list = NULL;
+
+	pg->var_handle = 0;
+	pg->var_depth = PHPDBG_DEFAULT_VAR_DEPTH;
+	pg->var_children = PHPDBG_DEFAULT_VAR_CHILDREN;
+	pg->source_cache.budget = PHPDBG_DEFAULT_SOURCE_BUDGET;
+
+	memset(&pg->input, 0, sizeof(pg->input));
 	pg->sigsafe_mem.mem = NULL;
 	pg->sigsegv_bailout = NULL;
 
@@ -152,6 +178,14 @@ static void php_phpdbg_destroy_bp_opcode(void *brake) /* {{{ */
 } /* }}} */
 
 
+static void php_phpdbg_destroy_bp_pattern(void *brake) /* {{{ */
+{
+	efree((char*)((phpdbg_breakpattern_t*)brake)->pattern);
+	if (((phpdbg_breakpattern_t*)brake)->method) {
+		efree((char*)((phpdbg_breakpattern_t*)brake)->method);
+	}
+} /* }}} */
+
 static void php_phpdbg_destroy_bp_methods(void *brake) /* {{{ */
 {
 	zend_hash_destroy((HashTable*)brake);
@@ -196,9 +230,16 @@ static PHP_RINIT_FUNCTION(phpdbg) /* {{{ */
 	zend_hash_init(&PHPDBG_G(bp)[PHPDBG_BREAK_METHOD], 8, NULL, php_phpdbg_destroy_bp_methods, 0);
 	zend_hash_init(&PHPDBG_G(bp)[PHPDBG_BREAK_COND], 8, NULL, php_phpdbg_destroy_bp_condition, 0);
 	zend_hash_init(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], 8, NULL, NULL, 0);
+	zend_hash_init(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], 8, NULL, php_phpdbg_destroy_bp_pattern, 0);
+	phpdbg_init_pending_files(TSRMLS_C);
+	phpdbg_init_pattern_matches(TSRMLS_C);
+	zend_hash_init(&PHPDBG_G(tracepoints), 8, NULL, phpdbg_tracepoint_dtor, 0);
+	zend_hash_init(&PHPDBG_G(breakcmds), 8, NULL, phpdbg_breakcmds_dtor, 0);
 
 	zend_hash_init(&PHPDBG_G(seek), 8, NULL, NULL, 0);
 	zend_hash_init(&PHPDBG_G(registered), 8, NULL, php_phpdbg_destroy_registered, 0);
+	zend_hash_init(&PHPDBG_G(var_handles), 8, NULL, ZVAL_PTR_DTOR, 0);
+	phpdbg_init_decode_cache(TSRMLS_C);
 
 	return SUCCESS;
 } /* }}} */
@@ -206,6 +247,7 @@ static PHP_RINIT_FUNCTION(phpdbg) /* {{{ */
 static PHP_RSHUTDOWN_FUNCTION(phpdbg) /* {{{ */
 {
 	zend_hash_destroy(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE]);
+	phpdbg_destroy_pending_files(TSRMLS_C);
 	zend_hash_destroy(&PHPDBG_G(bp)[PHPDBG_BREAK_SYM]);
 	zend_hash_destroy(&PHPDBG_G(bp)[PHPDBG_BREAK_FUNCTION_OPLINE]);
 	zend_hash_destroy(&PHPDBG_G(bp)[PHPDBG_BREAK_METHOD_OPLINE]);
@@ -215,9 +257,16 @@ static PHP_RSHUTDOWN_FUNCTION(phpdbg) /* {{{ */
 	zend_hash_destroy(&PHPDBG_G(bp)[PHPDBG_BREAK_METHOD]);
 	zend_hash_destroy(&PHPDBG_G(bp)[PHPDBG_BREAK_COND]);
 	zend_hash_destroy(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP]);
+	phpdbg_destroy_pattern_matches(TSRMLS_C);
+	zend_hash_destroy(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN]);
+	zend_hash_destroy(&PHPDBG_G(tracepoints));
+	phpdbg_discard_breakcmds(TSRMLS_C);
+	zend_hash_destroy(&PHPDBG_G(breakcmds));
 	zend_hash_destroy(&PHPDBG_G(seek));
 	zend_hash_destroy(&PHPDBG_G(file_sources));
 	zend_hash_destroy(&PHPDBG_G(registered));
+	zend_hash_destroy(&PHPDBG_G(var_handles));
+	phpdbg_destroy_decode_cache(TSRMLS_C);
 	zend_hash_destroy(&PHPDBG_G(watchpoints));
 	zend_llist_destroy(&PHPDBG_G(watchlist_mem));
 
@@ -247,6 +296,11 @@ static PHP_RSHUTDOWN_FUNCTION(phpdbg) /* {{{ */
 		PHPDBG_G(oplog) = NULL;
 	}
 
+	if (PHPDBG_G(tracelog)) {
+		fclose(PHPDBG_G(tracelog));
+		PHPDBG_G(tracelog) = NULL;
+	}
+
 	if (PHPDBG_G(ops)) {
 		destroy_op_array(PHPDBG_G(ops) TSRMLS_CC);
 		efree(PHPDBG_G(ops));
@@ -362,15 +416,7 @@ static PHP_FUNCTION(phpdbg_break_function)
    instructs phpdbg to clear breakpoints */
 static PHP_FUNCTION(phpdbg_clear)
 {
-	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE]);
-	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE_PENDING]);
-	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_SYM]);
-	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_FUNCTION_OPLINE]);
-	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_METHOD_OPLINE]);
-	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE_OPLINE]);
-	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE]);
-	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_METHOD]);
-	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_COND]);
+	phpdbg_clear_breakpoints(TSRMLS_C);
 } /* }}} */
 
 /* {{{ proto void phpdbg_color(integer element, string color) */
@@ -556,6 +602,13 @@ static int php_sapi_phpdbg_deactivate(TSRMLS_D) /* {{{ */
 		pg->prompt[1] = PHPDBG_G(prompt)[1];
 		memcpy(pg->colors, PHPDBG_G(colors), sizeof(pg->colors));
 		pg->eol = PHPDBG_G(eol);
+		pg->var_depth = PHPDBG_G(var_depth);
+		pg->var_children = PHPDBG_G(var_children);
+		pg->source_cache.budget = PHPDBG_G(source_cache).budget;
+		pg->observers = PHPDBG_G(observers);
+		pg->input = PHPDBG_G(input); /* pipelined commands survive a clean */
+		pg->replay = PHPDBG_G(replay);
+		pg->ini_cache = PHPDBG_G(ini_cache);
 		pg->flags = PHPDBG_G(flags) & PHPDBG_PRESERVE_FLAGS_MASK;
 	}
 
@@ -660,6 +713,7 @@ static inline void php_sapi_phpdbg_flush(void *context)  /* {{{ */
 #endif
 
 	if (!phpdbg_active_sigsafe_mem(TSRMLS_C)) {
+		phpdbg_flush_output(TSRMLS_C);
 		fflush(PHPDBG_G(io)[PHPDBG_STDOUT].ptr);
 	}
 } /* }}} */
@@ -780,6 +834,8 @@ const opt_struct OPTIONS[] = { /* {{{ */
 	{'l', 1, "listen"},
 	{'a', 1, "address-or-any"},
 	{'x', 0, "xml output"},
+	{'j', 0, "json output"},
+	{'t', 0, "io thread"},
 	{'V', 0, "version"},
 	{'-', 0, NULL}
 }; /* }}} */
@@ -875,7 +931,9 @@ static void phpdbg_remote_close(int socket, FILE *stream) {
 
 /* don't inline this, want to debug it easily, will inline when done */
 static int phpdbg_remote_init(const char* address, unsigned short port, int server, int *socket, FILE **stream TSRMLS_DC) {
+	phpdbg_iothread_stop(TSRMLS_C);
 	phpdbg_remote_close(*socket, *stream);
+	phpdbg_clear_input(TSRMLS_C);
 
 	if (server < 0) {
 		phpdbg_rlog(fileno(stderr), "Initializing connection on %s:%u failed", address, port);
@@ -883,7 +941,12 @@ static int phpdbg_remote_init(const char* address, unsigned short port, int serv
 		return FAILURE;
 	}
 
-	phpdbg_rlog(fileno(stderr), "accepting connections on %s:%u", address, port);
+	if (!port) {
+		/* a UNIX domain socket or one passed by a service manager */
+		phpdbg_rlog(fileno(stderr), "accepting connections on %s", address);
+	} else {
+		phpdbg_rlog(fileno(stderr), "accepting connections on %s:%u", address, port);
+	}
 	{
 		struct sockaddr_storage address;
 		socklen_t size = sizeof(address);
@@ -891,7 +954,23 @@ static int phpdbg_remote_init(const char* address, unsigned short port, int serv
 		/* XXX error checks */
 		memset(&address, 0, size);
 		*socket = accept(server, (struct sockaddr *) &address, &size);
-		inet_ntop(AF_INET, &(((struct sockaddr_in *)&address)->sin_addr), buffer, sizeof(buffer));
+
+#ifndef _WIN32
+		if (address.ss_family == AF_UNIX) {
+			strcpy(buffer, "local socket");
+		} else
+#endif
+		{
+			inet_ntop(AF_INET, &(((struct sockaddr_in *)&address)->sin_addr), buffer, sizeof(buffer));
+
+#ifndef _WIN32
+			{
+				/* output is batched by phpdbg itself, Nagle would only hold back the prompt */
+				int nodelay = 1;
+				setsockopt(*socket, IPPROTO_TCP, TCP_NODELAY, (char *) &nodelay, sizeof(nodelay));
+			}
+#endif
+		}
 
 		phpdbg_rlog(fileno(stderr), "connection established from %s", buffer);
 	}
@@ -904,7 +983,15 @@ static int phpdbg_remote_init(const char* address, unsigned short port, int serv
 
 	*stream = fdopen(*socket, "r+");
 
-	phpdbg_set_async_io(*socket);
+	if (!(PHPDBG_G(flags) & PHPDBG_IO_THREAD)) {
+		phpdbg_set_async_io(*socket);
+	} else if (phpdbg_iothread_start(*socket TSRMLS_CC) == FAILURE) {
+		phpdbg_rlog(fileno(stderr), "could not start the io thread, falling back to SIGIO");
+		PHPDBG_G(flags) &= ~PHPDBG_IO_THREAD;
+		phpdbg_set_async_io(*socket);
+	}
+
+	phpdbg_observe_reconnect(TSRMLS_C);
 #endif
 	return SUCCESS;
 }
@@ -951,6 +1038,13 @@ void phpdbg_sigio_handler(int sig, siginfo_t *info, void *context) /* {{{ */
 						PHPDBG_G(flags) |= PHPDBG_IS_SIGNALED;
 					}
 					break;
+
+				default:
+					/* pipelined commands, answered between two oplines */
+					if (!(PHPDBG_G(flags) & PHPDBG_IS_INTERACTIVE)) {
+						PHPDBG_G(flags) |= PHPDBG_HAS_PENDING_INPUT;
+					}
+					break;
 /*				case '\n':
 					zend_llist_add_element(PHPDBG_G(stdin), strndup()
 					last_nl = PHPDBG_G(stdin_buf).len + i;
@@ -977,6 +1071,8 @@ void phpdbg_signal_handler(int sig, siginfo_t *info, void *context) /* {{{ */
 			}
 			is_handled = phpdbg_watchpoint_segfault_handler(info, context TSRMLS_CC);
 			if (is_handled == FAILURE) {
+				/* we are going to crash, don't lose what was printed until now */
+				phpdbg_flush_output(TSRMLS_C);
 #ifdef ZEND_SIGNALS
 				zend_sigaction(sig, &PHPDBG_G(old_sigsegv_signal), NULL TSRMLS_CC);
 #else
@@ -1038,10 +1134,12 @@ int main(int argc, char **argv) /* {{{ */
 	int php_optind, opt, show_banner = 1;
 	long cleaning = -1;
 	zend_bool remote = 0;
+	zend_bool activated = 0;
 	int step = 0;
 	zend_phpdbg_globals *settings = NULL;
 	char *bp_tmp = NULL;
 	char *address;
+	char *unix_path = NULL; /* -l unix://..., kept apart from the -a bind address */
 	int listen = -1;
 	int server = -1;
 	int socket = -1;
@@ -1204,7 +1302,14 @@ phpdbg_main:
 
 			/* if you pass a listen port, we will read and write on listen port */
 			case 'l': /* set listen ports */
-				if (sscanf(php_optarg, "%d", &listen) != 1) {
+				if (unix_path) {
+					free(unix_path);
+					unix_path = NULL;
+				}
+				if (!strncmp(php_optarg, PHPDBG_UNIX_SOCKET_PREFIX, sizeof(PHPDBG_UNIX_SOCKET_PREFIX) - 1)) {
+					unix_path = strdup(php_optarg);
+					listen = -1;
+				} else if (sscanf(php_optarg, "%d", &listen) != 1) {
 					listen = 8000;
 				}
 				break;
@@ -1220,6 +1325,17 @@ phpdbg_main:
 				flags |= PHPDBG_WRITE_XML;
 			break;
 
+			case 't': /* read remote consoles in a thread instead of on SIGIO */
+				flags |= PHPDBG_IO_THREAD;
+			break;
+
+			case 'j': /* -jj also sends the human readable messages */
+				if (flags & PHPDBG_WRITE_JSON) {
+					flags |= PHPDBG_JSON_MSGOUT;
+				}
+				flags |= PHPDBG_WRITE_XML | PHPDBG_WRITE_JSON;
+			break;
+
 			case 'V': {
 				sapi_startup(phpdbg);
 				phpdbg->startup(phpdbg);
@@ -1316,10 +1432,27 @@ phpdbg_main:
 #endif
 		}
 
+#ifndef _WIN32
+		/* started by a service manager on the first connection */
+		if (cleaning <= 0 && !activated && (server = phpdbg_inherited_socket()) >= 0) {
+			activated = 1;
+			listen = 0;
+			free(address);
+			address = strdup("the inherited socket");
+		}
+#endif
+
 		/* setup remote server if necessary */
-		if (cleaning <= 0 && listen > 0) {
-			server = phpdbg_open_socket(address, listen TSRMLS_CC);
-				if (-1 > server || phpdbg_remote_init(address, listen, server, &socket, &stream TSRMLS_CC) == FAILURE) {
+		if (cleaning <= 0 && (listen > 0 || unix_path || activated)) {
+			if (!activated) {
+				server = phpdbg_open_socket(unix_path ? unix_path : address, unix_path ? 0 : listen TSRMLS_CC);
+			}
+				if (-1 > server || phpdbg_remote_init(unix_path ? unix_path : address, unix_path ? 0 : listen, server, &socket, &stream TSRMLS_CC) == FAILURE) {
+#ifndef _WIN32
+				if (unix_path && !activated && server >= 0) {
+					phpdbg_remove_unix_socket(unix_path);
+				}
+#endif
 				exit(0);
 			}
 
@@ -1327,6 +1460,9 @@ phpdbg_main:
 			sigaction(SIGIO, &sigio_struct, NULL);
 #endif
 
+			/* further connections are observers */
+			phpdbg_observe_init(server TSRMLS_CC);
+
 			/* set remote flag to stop service shutting down upon quit */
 			remote = 1;
 		}
@@ -1386,7 +1522,7 @@ phpdbg_main:
 		/* do not install sigint handlers for remote consoles */
 		/* sending SIGINT then provides a decent way of shutting down the server */
 #ifndef _WIN32
-		if (listen < 0) {
+		if (listen < 0 && !unix_path && !activated) {
 #endif
 #if defined(ZEND_SIGNALS) && !defined(_WIN32)
 			zend_try { zend_signal(SIGINT, phpdbg_sigint_handler TSRMLS_CC); } zend_end_try();
@@ -1520,6 +1656,11 @@ phpdbg_interact:
 					}
 				}
 
+				/* each replayed request ends with a clean, pick up the next one */
+				if (PHPDBG_G(replay).file) {
+					phpdbg_replay_next(TSRMLS_C);
+				}
+
 				phpdbg_interactive(1 TSRMLS_CC);
 			} zend_catch {
 				if ((PHPDBG_G(flags) & PHPDBG_IS_CLEANING)) {
@@ -1540,9 +1681,13 @@ phpdbg_interact:
 					/* remote client disconnected */
 					if ((PHPDBG_G(flags) & PHPDBG_IS_DISCONNECTED)) {
 					
-						if (PHPDBG_G(flags) & PHPDBG_IS_REMOTE) {
+						if (activated) {
+							/* the service manager starts us again on the next connection */
+							PHPDBG_G(flags) &= ~PHPDBG_IS_DISCONNECTED;
+							remote = 0;
+						} else if (PHPDBG_G(flags) & PHPDBG_IS_REMOTE) {
 							/* renegociate connections */
-							phpdbg_remote_init(address, listen, server, &socket, &stream TSRMLS_CC);
+							phpdbg_remote_init(unix_path ? unix_path : address, unix_path ? 0 : listen, server, &socket, &stream TSRMLS_CC);
 				
 							/* set streams */
 							if (stream) {
@@ -1648,8 +1793,17 @@ phpdbg_out:
 
 		if ((PHPDBG_G(flags) & PHPDBG_IS_STOPPING) == PHPDBG_IS_CLEANING) {
 			settings = PHPDBG_G(backup);
+		} else {
+			/* observers, pending input, replays and the ini cache only survive a clean */
+			phpdbg_observe_shutdown(TSRMLS_C);
+			phpdbg_free_input(TSRMLS_C);
+			phpdbg_replay_free(TSRMLS_C);
+			phpdbg_webdata_free_ini_cache(TSRMLS_C);
 		}
 
+		/* globals are reinitialized on the next startup */
+		phpdbg_free_output_buffer(TSRMLS_C);
+
 		php_output_deactivate(TSRMLS_C);
 
 		zend_try {
@@ -1660,7 +1814,7 @@ phpdbg_out:
 
 	}
 
-	if (cleaning > 0 || remote) {
+	if (cleaning > 0 || (remote && !activated)) {
 		goto phpdbg_main;
 	}
 
@@ -1673,6 +1827,13 @@ phpdbg_out:
 	if (address) {
 		free(address);
 	}
+	if (unix_path) {
+		/* do not leave the socket file behind */
+		if (!activated && server >= 0) {
+			phpdbg_remove_unix_socket(unix_path);
+		}
+		free(unix_path);
+	}
 #endif
 
 	if (PHPDBG_G(sapi_name_ptr)) {
@@ -97,6 +97,13 @@
 #define PHPDBG_DEFAULT_PROMPT "prompt>"
 /* }}} */
 
+/* {{{ limits of a single variable dump, see "print children" */
+#define PHPDBG_DEFAULT_VAR_DEPTH    4
+#define PHPDBG_DEFAULT_VAR_CHILDREN 256 /* }}} */
+
+/* bytes of re-read source kept for listing, see "set sources" */
+#define PHPDBG_DEFAULT_SOURCE_BUDGET (4 * 1024 * 1024)
+
 /* Hey, apple. One shouldn't define *functions* from the standard C library as marcos. */
 #ifdef memcpy
 #define memcpy_tmp(...) memcpy(__VA_ARGS__)
@@ -182,12 +189,22 @@ int phpdbg_do_parse(phpdbg_param_t *stack, char *input TSRMLS_DC);
 
 #define PHPDBG_DISCARD_OUTPUT         (1ULL<<34)
 
+#define PHPDBG_WRITE_JSON             (1ULL<<35)
+#define PHPDBG_JSON_MSGOUT            (1ULL<<36)
+
+#define PHPDBG_IO_THREAD              (1ULL<<37)
+
+#define PHPDBG_HAS_PENDING_INPUT      (1ULL<<38)
+
+#define PHPDBG_HAS_PATTERN_BP         (1ULL<<39)
+#define PHPDBG_HAS_SYM_PATTERN_BP     (1ULL<<40)
+
 #define PHPDBG_SEEK_MASK              (PHPDBG_IN_UNTIL | PHPDBG_IN_FINISH | PHPDBG_IN_LEAVE)
 #define PHPDBG_BP_RESOLVE_MASK	      (PHPDBG_HAS_FUNCTION_OPLINE_BP | PHPDBG_HAS_METHOD_OPLINE_BP | PHPDBG_HAS_FILE_OPLINE_BP)
-#define PHPDBG_BP_MASK                (PHPDBG_HAS_FILE_BP | PHPDBG_HAS_SYM_BP | PHPDBG_HAS_METHOD_BP | PHPDBG_HAS_OPLINE_BP | PHPDBG_HAS_COND_BP | PHPDBG_HAS_OPCODE_BP | PHPDBG_HAS_FUNCTION_OPLINE_BP | PHPDBG_HAS_METHOD_OPLINE_BP | PHPDBG_HAS_FILE_OPLINE_BP)
+#define PHPDBG_BP_MASK                (PHPDBG_HAS_FILE_BP | PHPDBG_HAS_SYM_BP | PHPDBG_HAS_METHOD_BP | PHPDBG_HAS_OPLINE_BP | PHPDBG_HAS_COND_BP | PHPDBG_HAS_OPCODE_BP | PHPDBG_HAS_FUNCTION_OPLINE_BP | PHPDBG_HAS_METHOD_OPLINE_BP | PHPDBG_HAS_FILE_OPLINE_BP | PHPDBG_HAS_PATTERN_BP | PHPDBG_HAS_SYM_PATTERN_BP)
 #define PHPDBG_IS_STOPPING            (PHPDBG_IS_QUITTING | PHPDBG_IS_CLEANING)
 
-#define PHPDBG_PRESERVE_FLAGS_MASK    (PHPDBG_SHOW_REFCOUNTS | PHPDBG_IS_STEPONEVAL | PHPDBG_IS_BP_ENABLED | PHPDBG_STEP_OPCODE | PHPDBG_IS_QUIET | PHPDBG_IS_COLOURED | PHPDBG_IS_REMOTE | PHPDBG_WRITE_XML | PHPDBG_IS_DISCONNECTED)
+#define PHPDBG_PRESERVE_FLAGS_MASK    (PHPDBG_SHOW_REFCOUNTS | PHPDBG_IS_STEPONEVAL | PHPDBG_IS_BP_ENABLED | PHPDBG_STEP_OPCODE | PHPDBG_IS_QUIET | PHPDBG_IS_COLOURED | PHPDBG_IS_REMOTE | PHPDBG_WRITE_XML | PHPDBG_WRITE_JSON | PHPDBG_JSON_MSGOUT | PHPDBG_IO_THREAD | PHPDBG_IS_DISCONNECTED)
 
 #ifndef _WIN32
 #	define PHPDBG_DEFAULT_FLAGS (PHPDBG_IS_QUIET | PHPDBG_IS_COLOURED | PHPDBG_IS_BP_ENABLED)
@@ -220,6 +237,12 @@ int phpdbg_do_parse(phpdbg_param_t *stack, char *input TSRMLS_DC);
 /* {{{ structs */
 ZEND_BEGIN_MODULE_GLOBALS(phpdbg)
 	HashTable bp[PHPDBG_BREAK_TABLES];           /* break points */
+	phpdbg_pending_file_t pending_files;         /* reversed path component trie of pending file breakpoints */
+	HashTable pattern_files;                     /* compiled file => line => pattern breakpoint matching it */
+	HashTable pattern_symbols;                   /* opcodes of a function or method => pattern breakpoint matching it, or NULL */
+	HashTable tracepoints;                       /* breakpoint id => tracepoint */
+	HashTable breakcmds;                         /* breakpoint id => command list */
+	phpdbg_breakcmds_t *breakcmds_def;           /* command list being defined, if any */
 	HashTable registered;                        /* registered */
 	HashTable seek;                              /* seek oplines */
 	phpdbg_frame_t frame;                        /* frame */
@@ -247,8 +270,20 @@ ZEND_BEGIN_MODULE_GLOBALS(phpdbg)
 
 	zend_op_array *(*compile_file)(zend_file_handle *file_handle, int type TSRMLS_DC);
 	HashTable file_sources;
+	HashTable decode_cache;                      /* op_array opcodes => decoded oplines, see phpdbg_decode_opline_cached */
+	struct {
+		size_t budget;                           /* bytes of re-read sources kept at most */
+		size_t used;                             /* bytes of re-read sources currently kept */
+		struct _phpdbg_file_source *head, *tail; /* most recently listed first */
+	} source_cache;
+
+	HashTable var_handles;                       /* zvals whose children can be fetched by "print children" */
+	zend_ulong var_handle;                       /* last handed out variable handle */
+	int var_depth;                               /* nesting levels dumped at once, 0 for all */
+	int var_children;                            /* children dumped per container at once, 0 for all */
 
 	FILE *oplog;                                 /* opline log */
+	FILE *tracelog;                              /* tracepoint log, the console if NULL */
 	struct {
 		FILE *ptr;
 		int fd;
@@ -266,6 +301,33 @@ ZEND_BEGIN_MODULE_GLOBALS(phpdbg)
 		char *xml;
 		int xmllen;
 	} err_buf;                                   /* error buffer */
+	struct {
+		char *buf;
+		size_t len;
+		size_t size;
+		int fd;
+		size_t limit;
+		size_t observed;
+	} out_buf;                                   /* pending output, flushed before waiting for input */
+	struct {
+		char *buf;
+		size_t len;
+		size_t size;
+		zend_bool in_tag;
+		zend_bool in_quote;
+	} json_tag;                                  /* xml tag being translated to a json frame */
+	struct {
+		zend_ulong bytes;
+		zend_ulong syscalls;
+		zend_ulong stalls;
+	} io_stats[3];                               /* output statistics */
+	struct {
+		int server;
+		int loop;
+		int controller;
+		int num;
+		struct _phpdbg_observer *list;
+	} observers;                                 /* read-only remote clients, see phpdbg_observe.c */
 	zend_ulong req_id;                           /* "request id" to keep track of commands */
 
 	char *prompt[2];                             /* prompt */
@@ -273,8 +335,14 @@ ZEND_BEGIN_MODULE_GLOBALS(phpdbg)
 	char *buffer;                                /* buffer */
 	zend_bool last_was_newline;                  /* check if we don't need to output a newline upon next phpdbg_error or phpdbg_notice */
 
-	char input_buffer[PHPDBG_MAX_CMD];           /* stdin input buffer */
-	int input_buflen;                            /* length of stdin input buffer */
+	struct {
+		char *buf;
+		size_t size;
+		size_t start;                            /* first byte not handed out yet */
+		size_t end;                              /* end of the data read so far */
+		size_t scan;                             /* no newline in [start, scan) */
+		zend_bool held;                          /* the first line waits for the prompt, see phpdbg_serve_pipelined */
+	} input;                                     /* stdin input buffer, see phpdbg_consume_stdin_line */
 	phpdbg_signal_safe_mem sigsafe_mem;          /* memory to use in async safe environment (only once!) */
 
 	JMP_BUF *sigsegv_bailout;                    /* bailout address for accesibility probing */
@@ -285,6 +353,30 @@ ZEND_BEGIN_MODULE_GLOBALS(phpdbg)
 	char *sapi_name_ptr;                         /* store sapi name to free it if necessary to not leak memory */
 	php_stream *socket_client_stream;            /* client stream (wait command) (NULL if unused) */
 	php_stream *socket_server_stream;            /* server stream (wait command) (NULL if unused) */
+	struct {
+		int lock;                                /* console lock file (-1 if no pool is running) */
+		zend_bool worker;                        /* this process is a pool worker */
+		zend_bool console;                       /* this worker holds the console */
+	} pool;                                      /* worker pool, see wait <n> */
+	struct {
+		unsigned char hash[16];
+		zend_bool applied;
+	} webdata;                                   /* static part of the last request imported by wait */
+	struct {
+		unsigned char hash[16];
+		HashTable *diff;                         /* directive => value, persistent */
+	} ini_cache;                                 /* system ini of a static part differing from a fresh startup */
+	struct {
+		char *file;                              /* capture file being replayed (NULL if none) */
+		off_t offset;                            /* next record to read */
+		long seen;                               /* request records read so far */
+		long first, last;                        /* requests to replay, last 0 for all */
+		long count;                              /* requests replayed */
+		double time;                             /* milliseconds spent in them, without the prompt */
+		double paused;                           /* milliseconds spent at the prompt during the replay */
+		double paused_since;                     /* when the prompt was entered, 0 when not at the prompt */
+		HashTable *statics;                      /* offsets of the static records by hash */
+	} replay;                                    /* survives the clean after each request, see replay */
 
 #ifdef PHP_WIN32
 	HANDLE sigio_watcher_thread;                 /* sigio watcher thread handle */
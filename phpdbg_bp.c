@@ -25,6 +25,12 @@
 #include "phpdbg_utils.h"
 #include "phpdbg_opcode.h"
 #include "zend_globals.h"
+#include "ext/standard/php_smart_str.h"
+#include "ext/pcre/php_pcre.h"
+
+#ifdef HAVE_FNMATCH
+#	include <fnmatch.h>
+#endif
 
 ZEND_EXTERN_MODULE_GLOBALS(phpdbg);
 
@@ -32,21 +38,43 @@ ZEND_EXTERN_MODULE_GLOBALS(phpdbg);
 static inline phpdbg_breakbase_t *phpdbg_find_breakpoint_file(zend_op_array* TSRMLS_DC);
 static inline phpdbg_breakbase_t *phpdbg_find_breakpoint_symbol(zend_function* TSRMLS_DC);
 static inline phpdbg_breakbase_t *phpdbg_find_breakpoint_method(zend_op_array* TSRMLS_DC);
+static phpdbg_breakbase_t *phpdbg_find_breakpoint_pattern(zend_op_array* TSRMLS_DC);
+static inline zend_bool phpdbg_is_breakpoint_glob(const char *str);
 static inline phpdbg_breakbase_t *phpdbg_find_breakpoint_opline(phpdbg_opline_ptr_t TSRMLS_DC);
 static inline phpdbg_breakbase_t *phpdbg_find_breakpoint_opcode(zend_uchar TSRMLS_DC);
-static inline phpdbg_breakbase_t *phpdbg_find_conditional_breakpoint(zend_execute_data *execute_data TSRMLS_DC); /* }}} */
+static inline phpdbg_breakbase_t *phpdbg_find_conditional_breakpoint(zend_execute_data *execute_data TSRMLS_DC);
+static void phpdbg_index_pending_file(const char *path, uint path_len TSRMLS_DC);
+static void phpdbg_unindex_pending_file(const char *path, uint path_len TSRMLS_DC); /* }}} */
 
 /*
 * Note:
 *	A break point must always set the correct id and type
-*	A set breakpoint function must always map new points
+*	A set breakpoint function must always map new points, to the table holding them and
+*	to where the table stores them (the pDest of the insertion), so ids are found directly
 */
-static inline void _phpdbg_break_mapping(int id, HashTable *table TSRMLS_DC)
+typedef struct _phpdbg_breakmap_t {
+	HashTable          *table;
+	phpdbg_breakbase_t *brake;
+} phpdbg_breakmap_t;
+
+/* the pattern matching a function, kept by its opcodes; the name and scope tell a function reusing freed opcodes apart */
+typedef struct _phpdbg_pattern_match_t {
+	const char            *function_name;
+	zend_class_entry      *scope;
+	phpdbg_breakpattern_t *brake;
+} phpdbg_pattern_match_t;
+
+static inline void _phpdbg_break_mapping(int id, HashTable *table, void *brake TSRMLS_DC)
 {
-	zend_hash_index_update(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], (id), (void**) &table, sizeof(void*), NULL);
+	phpdbg_breakmap_t map;
+
+	map.table = table;
+	map.brake = (phpdbg_breakbase_t *) brake;
+
+	zend_hash_index_update(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], (id), (void**) &map, sizeof(phpdbg_breakmap_t), NULL);
 }
 
-#define PHPDBG_BREAK_MAPPING(id, table) _phpdbg_break_mapping(id, table TSRMLS_CC)
+#define PHPDBG_BREAK_MAPPING(id, table, brake) _phpdbg_break_mapping(id, table, brake TSRMLS_CC)
 #define PHPDBG_BREAK_UNMAPPING(id) \
 	zend_hash_index_del(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], (id))
 
@@ -91,151 +119,514 @@ static void phpdbg_opline_breaks_dtor(void *data) /* {{{ */
 
 PHPDBG_API void phpdbg_reset_breakpoints(TSRMLS_D) /* {{{ */
 {
-	if (zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP])) {
-		HashPosition position[2];
-		HashTable **table = NULL;
-
-		for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], &position[0]);
-		     zend_hash_get_current_data_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], (void **) &table, &position[0]) == SUCCESS;
-		     zend_hash_move_forward_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], &position[0])) {
-			phpdbg_breakbase_t *brake;
-
-			for (zend_hash_internal_pointer_reset_ex((*table), &position[1]);
-				zend_hash_get_current_data_ex((*table), (void**)&brake, &position[1]) == SUCCESS;
-				zend_hash_move_forward_ex((*table), &position[1])) {
-				brake->hits = 0;
+	HashPosition position;
+	phpdbg_breakmap_t *map;
+	phpdbg_breakline_t *brake;
+
+	for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], &position);
+	     zend_hash_get_current_data_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], (void **) &map, &position) == SUCCESS;
+	     zend_hash_move_forward_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], &position)) {
+		map->brake->hits = 0;
+	}
+
+	/* the resolved copies of file, function and method opline breakpoints are not mapped */
+	for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE], &position);
+	     zend_hash_get_current_data_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE], (void **) &brake, &position) == SUCCESS;
+	     zend_hash_move_forward_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE], &position)) {
+		brake->hits = 0;
+	}
+} /* }}} */
+
+static void phpdbg_export_breakpoint(smart_str *buf, phpdbg_breakbase_t *brake) /* {{{ */
+{
+	switch (brake->type) {
+		case PHPDBG_BREAK_FILE:
+			smart_str_appends(buf, "break ");
+			smart_str_appends(buf, ((phpdbg_breakfile_t*)brake)->filename);
+			smart_str_appendc(buf, ':');
+			smart_str_append_long(buf, ((phpdbg_breakfile_t*)brake)->line);
+			break;
+
+		case PHPDBG_BREAK_SYM:
+			smart_str_appends(buf, "break ");
+			smart_str_appends(buf, ((phpdbg_breaksymbol_t*)brake)->symbol);
+			break;
+
+		case PHPDBG_BREAK_METHOD:
+			smart_str_appends(buf, "break ");
+			smart_str_appends(buf, ((phpdbg_breakmethod_t*)brake)->class_name);
+			smart_str_appendl(buf, "::", 2);
+			smart_str_appends(buf, ((phpdbg_breakmethod_t*)brake)->func_name);
+			break;
+
+		case PHPDBG_BREAK_METHOD_OPLINE:
+			smart_str_appends(buf, "break ");
+			smart_str_appends(buf, ((phpdbg_breakopline_t*)brake)->class_name);
+			smart_str_appendl(buf, "::", 2);
+			smart_str_appends(buf, ((phpdbg_breakopline_t*)brake)->func_name);
+			smart_str_appendc(buf, '#');
+			smart_str_append_long(buf, ((phpdbg_breakopline_t*)brake)->opline_num);
+			break;
+
+		case PHPDBG_BREAK_FUNCTION_OPLINE:
+			smart_str_appends(buf, "break ");
+			smart_str_appends(buf, ((phpdbg_breakopline_t*)brake)->func_name);
+			smart_str_appendc(buf, '#');
+			smart_str_append_long(buf, ((phpdbg_breakopline_t*)brake)->opline_num);
+			break;
+
+		case PHPDBG_BREAK_FILE_OPLINE:
+			smart_str_appends(buf, "break ");
+			smart_str_appends(buf, ((phpdbg_breakopline_t*)brake)->class_name);
+			smart_str_appendl(buf, ":#", 2);
+			smart_str_append_long(buf, ((phpdbg_breakopline_t*)brake)->opline_num);
+			break;
+
+		case PHPDBG_BREAK_OPCODE:
+			smart_str_appends(buf, "break ");
+			smart_str_appends(buf, ((phpdbg_breakop_t*)brake)->name);
+			break;
+
+		case PHPDBG_BREAK_PATTERN:
+			smart_str_appends(buf, "break ");
+			smart_str_appends(buf, ((phpdbg_breakpattern_t*)brake)->pattern);
+			switch (((phpdbg_breakpattern_t*)brake)->kind) {
+				case PHPDBG_PATTERN_FILE:
+					smart_str_appendc(buf, ':');
+					smart_str_append_long(buf, ((phpdbg_breakpattern_t*)brake)->line);
+					break;
+				case PHPDBG_PATTERN_METHOD:
+					smart_str_appendl(buf, "::", 2);
+					smart_str_appends(buf, ((phpdbg_breakpattern_t*)brake)->method);
+					break;
 			}
+			break;
+
+		case PHPDBG_BREAK_COND: {
+			phpdbg_breakcond_t *conditional = (phpdbg_breakcond_t*) brake;
+
+			if (conditional->paramed) {
+				switch (conditional->param.type) {
+					case STR_PARAM:
+						smart_str_appends(buf, "break at ");
+						smart_str_appends(buf, conditional->param.str);
+					break;
+
+					case METHOD_PARAM:
+						smart_str_appends(buf, "break at ");
+						smart_str_appends(buf, conditional->param.method.class);
+						smart_str_appendl(buf, "::", 2);
+						smart_str_appends(buf, conditional->param.method.name);
+					break;
+
+					case FILE_PARAM:
+						smart_str_appends(buf, "break at ");
+						smart_str_appends(buf, conditional->param.file.name);
+						smart_str_appendc(buf, ':');
+						smart_str_append_unsigned(buf, conditional->param.file.line);
+					break;
+
+					default:
+						return;
+				}
+				smart_str_appends(buf, " if ");
+			} else {
+				smart_str_appends(buf, "break if ");
+			}
+			smart_str_appends(buf, conditional->code);
+		} break;
+
+		default:
+			return;
+	}
+
+	smart_str_appendc(buf, '\n');
+} /* }}} */
+
+/* breakpoints are exported in the order of their ids, each one as the command recreating it */
+static void phpdbg_export_breakpoints_ex(smart_str *buf TSRMLS_DC) /* {{{ */
+{
+	HashPosition position;
+	phpdbg_breakmap_t *map;
+
+	if (zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP])) {
+		phpdbg_notice("exportbreakpoint", "count=\"%d\"", "Exporting %d breakpoints", zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP]));
+
+		for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], &position);
+		     zend_hash_get_current_data_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], (void **) &map, &position) == SUCCESS;
+		     zend_hash_move_forward_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], &position)) {
+			phpdbg_export_breakpoint(buf, map->brake);
 		}
 	}
+
+	smart_str_0(buf);
 } /* }}} */
 
 PHPDBG_API void phpdbg_export_breakpoints(FILE *handle TSRMLS_DC) /* {{{ */
 {
-	char *string;
-	phpdbg_export_breakpoints_to_string(&string TSRMLS_CC);
-	fputs(string, handle);
-}
+	smart_str buf = {0};
+
+	phpdbg_export_breakpoints_ex(&buf TSRMLS_CC);
+
+	if (buf.c) {
+		fwrite(buf.c, 1, buf.len, handle);
+		smart_str_free(&buf);
+	}
+} /* }}} */
 
 PHPDBG_API void phpdbg_export_breakpoints_to_string(char **str TSRMLS_DC) /* {{{ */
 {
-	HashPosition position[2];
-	HashTable **table = NULL;
-	zend_ulong id = 0L;
+	smart_str buf = {0};
 
-	*str = "";
+	phpdbg_export_breakpoints_ex(&buf TSRMLS_CC);
 
-	if (zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP])) {
-		phpdbg_notice("exportbreakpoint", "count=\"%d\"", "Exporting %d breakpoints", zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP]));
-		/* this only looks like magic, it isn't */
-		for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], &position[0]);
-		     zend_hash_get_current_data_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], (void **) &table, &position[0]) == SUCCESS;
-		     zend_hash_move_forward_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], &position[0])) {
-			phpdbg_breakbase_t *brake;
-
-			zend_hash_get_current_key_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], NULL, NULL, &id, 0, &position[0]);
-
-			for (zend_hash_internal_pointer_reset_ex((*table), &position[1]);
-			     zend_hash_get_current_data_ex((*table), (void**)&brake, &position[1]) == SUCCESS;
-			     zend_hash_move_forward_ex((*table), &position[1])) {
-				if (brake->id == id) {
-					char *new_str = NULL;
-
-					switch (brake->type) {
-						case PHPDBG_BREAK_FILE: {
-							phpdbg_asprintf(&new_str,
-								"%sbreak %s:%lu\n", *str,
-								((phpdbg_breakfile_t*)brake)->filename,
-								((phpdbg_breakfile_t*)brake)->line);
-						} break;
-
-						case PHPDBG_BREAK_SYM: {
-							phpdbg_asprintf(&new_str,
-								"%sbreak %s\n", *str,
-								((phpdbg_breaksymbol_t*)brake)->symbol);
-						} break;
-
-						case PHPDBG_BREAK_METHOD: {
-							phpdbg_asprintf(&new_str,
-								"%sbreak %s::%s\n", *str,
-								((phpdbg_breakmethod_t*)brake)->class_name,
-								((phpdbg_breakmethod_t*)brake)->func_name);
-						} break;
-
-						case PHPDBG_BREAK_METHOD_OPLINE: {
-							phpdbg_asprintf(&new_str,
-								"%sbreak %s::%s#%ld\n", *str,
-								((phpdbg_breakopline_t*)brake)->class_name,
-								((phpdbg_breakopline_t*)brake)->func_name,
-								((phpdbg_breakopline_t*)brake)->opline_num);
-						} break;
-
-						case PHPDBG_BREAK_FUNCTION_OPLINE: {
-							phpdbg_asprintf(&new_str,
-								"%sbreak %s#%ld\n", *str,
-								((phpdbg_breakopline_t*)brake)->func_name,
-								((phpdbg_breakopline_t*)brake)->opline_num);
-						} break;
-
-						case PHPDBG_BREAK_FILE_OPLINE: {
-							phpdbg_asprintf(&new_str,
-								"%sbreak %s:#%ld\n", *str,
-								((phpdbg_breakopline_t*)brake)->class_name,
-								((phpdbg_breakopline_t*)brake)->opline_num);
-						} break;
-
-						case PHPDBG_BREAK_OPCODE: {
-							phpdbg_asprintf(&new_str,
-								"%sbreak %s\n", *str,
-								((phpdbg_breakop_t*)brake)->name);
-						} break;
-
-						case PHPDBG_BREAK_COND: {
-							phpdbg_breakcond_t *conditional = (phpdbg_breakcond_t*) brake;
-
-							if (conditional->paramed) {
-								switch (conditional->param.type) {
-									case STR_PARAM:
-										phpdbg_asprintf(&new_str,
-											"%sbreak at %s if %s\n", *str, conditional->param.str, conditional->code);
-									break;
-
-									case METHOD_PARAM:
-										phpdbg_asprintf(&new_str,
-											"%sbreak at %s::%s if %s\n", *str,
-											conditional->param.method.class, conditional->param.method.name,
-											conditional->code);
-									break;
-
-									case FILE_PARAM:
-										phpdbg_asprintf(&new_str,
-											"%sbreak at %s:%lu if %s\n", *str,
-											conditional->param.file.name, conditional->param.file.line,
-											conditional->code);
-									break;
-
-									default: { /* do nothing */ } break;
-								}
-							} else {
-								phpdbg_asprintf(&new_str, "%sbreak if %s\n", str, conditional->code);
-							}
-						} break;
-					}
+	if (buf.len) {
+		*str = buf.c;
+	} else {
+		smart_str_free(&buf);
+		*str = NULL;
+	}
+} /* }}} */
 
-					if ((*str)[0]) {
-						efree(*str);
-					}
-					*str = new_str;
+/* a bulk line is led by the kind of the breakpoint and whether it is enabled */
+static inline void phpdbg_export_bulk_kind(smart_str *buf, const char *kind, phpdbg_breakbase_t *brake) /* {{{ */
+{
+	smart_str_appends(buf, kind);
+	smart_str_appendc(buf, '\t');
+	smart_str_appends(buf, brake->disabled ? "disabled" : "enabled");
+	smart_str_appendc(buf, '\t');
+} /* }}} */
+
+static void phpdbg_export_breakpoint_bulk(smart_str *buf, phpdbg_breakbase_t *brake) /* {{{ */
+{
+	switch (brake->type) {
+		case PHPDBG_BREAK_FILE:
+			phpdbg_export_bulk_kind(buf, "file", brake);
+			smart_str_appends(buf, ((phpdbg_breakfile_t*)brake)->filename);
+			smart_str_appendc(buf, '\t');
+			smart_str_append_long(buf, ((phpdbg_breakfile_t*)brake)->line);
+			break;
+
+		case PHPDBG_BREAK_SYM:
+			phpdbg_export_bulk_kind(buf, "func", brake);
+			smart_str_appends(buf, ((phpdbg_breaksymbol_t*)brake)->symbol);
+			break;
+
+		case PHPDBG_BREAK_METHOD:
+			phpdbg_export_bulk_kind(buf, "method", brake);
+			smart_str_appends(buf, ((phpdbg_breakmethod_t*)brake)->class_name);
+			smart_str_appendc(buf, '\t');
+			smart_str_appends(buf, ((phpdbg_breakmethod_t*)brake)->func_name);
+			break;
+
+		case PHPDBG_BREAK_METHOD_OPLINE:
+			phpdbg_export_bulk_kind(buf, "method#", brake);
+			smart_str_appends(buf, ((phpdbg_breakopline_t*)brake)->class_name);
+			smart_str_appendc(buf, '\t');
+			smart_str_appends(buf, ((phpdbg_breakopline_t*)brake)->func_name);
+			smart_str_appendc(buf, '\t');
+			smart_str_append_long(buf, ((phpdbg_breakopline_t*)brake)->opline_num);
+			break;
+
+		case PHPDBG_BREAK_FUNCTION_OPLINE:
+			phpdbg_export_bulk_kind(buf, "func#", brake);
+			smart_str_appends(buf, ((phpdbg_breakopline_t*)brake)->func_name);
+			smart_str_appendc(buf, '\t');
+			smart_str_append_long(buf, ((phpdbg_breakopline_t*)brake)->opline_num);
+			break;
+
+		case PHPDBG_BREAK_FILE_OPLINE:
+			phpdbg_export_bulk_kind(buf, "file#", brake);
+			smart_str_appends(buf, ((phpdbg_breakopline_t*)brake)->class_name);
+			smart_str_appendc(buf, '\t');
+			smart_str_append_long(buf, ((phpdbg_breakopline_t*)brake)->opline_num);
+			break;
+
+		case PHPDBG_BREAK_OPCODE:
+			phpdbg_export_bulk_kind(buf, "opcode", brake);
+			smart_str_appends(buf, ((phpdbg_breakop_t*)brake)->name);
+			break;
+
+		case PHPDBG_BREAK_PATTERN:
+			switch (((phpdbg_breakpattern_t*)brake)->kind) {
+				case PHPDBG_PATTERN_FILE:
+					phpdbg_export_bulk_kind(buf, "file", brake);
+					smart_str_appends(buf, ((phpdbg_breakpattern_t*)brake)->pattern);
+					smart_str_appendc(buf, '\t');
+					smart_str_append_long(buf, ((phpdbg_breakpattern_t*)brake)->line);
+					break;
+				case PHPDBG_PATTERN_METHOD:
+					phpdbg_export_bulk_kind(buf, "method", brake);
+					smart_str_appends(buf, ((phpdbg_breakpattern_t*)brake)->pattern);
+					smart_str_appendc(buf, '\t');
+					smart_str_appends(buf, ((phpdbg_breakpattern_t*)brake)->method);
+					break;
+				default:
+					phpdbg_export_bulk_kind(buf, "func", brake);
+					smart_str_appends(buf, ((phpdbg_breakpattern_t*)brake)->pattern);
+			}
+			break;
+
+		case PHPDBG_BREAK_COND: {
+			phpdbg_breakcond_t *conditional = (phpdbg_breakcond_t*) brake;
+
+			if (conditional->paramed) {
+				switch (conditional->param.type) {
+					case STR_PARAM:
+						phpdbg_export_bulk_kind(buf, "at-func", brake);
+						smart_str_appends(buf, conditional->param.str);
+					break;
+
+					case METHOD_PARAM:
+						phpdbg_export_bulk_kind(buf, "at-method", brake);
+						smart_str_appends(buf, conditional->param.method.class);
+						smart_str_appendc(buf, '\t');
+						smart_str_appends(buf, conditional->param.method.name);
+					break;
+
+					case FILE_PARAM:
+						phpdbg_export_bulk_kind(buf, "at-file", brake);
+						smart_str_appends(buf, conditional->param.file.name);
+						smart_str_appendc(buf, '\t');
+						smart_str_append_long(buf, conditional->param.file.line);
+					break;
+
+					default:
+						return;
 				}
+				smart_str_appendc(buf, '\t');
+			} else {
+				phpdbg_export_bulk_kind(buf, "if", brake);
+			}
+			smart_str_appends(buf, conditional->code);
+		} break;
+
+		default:
+			return;
+	}
+
+	smart_str_appendc(buf, '\n');
+} /* }}} */
+
+PHPDBG_API void phpdbg_export_breakpoints_bulk(FILE *handle TSRMLS_DC) /* {{{ */
+{
+	HashPosition position;
+	phpdbg_breakmap_t *map;
+	smart_str buf = {0};
+
+	for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], &position);
+	     zend_hash_get_current_data_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], (void **) &map, &position) == SUCCESS;
+	     zend_hash_move_forward_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], &position)) {
+		phpdbg_export_breakpoint_bulk(&buf, map->brake);
+	}
+
+	if (buf.c) {
+		fwrite(buf.c, 1, buf.len, handle);
+		smart_str_free(&buf);
+	}
+
+	phpdbg_notice("exportbreakpoint", "count=\"%d\"", "Exported %d breakpoints", zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP]));
+} /* }}} */
+
+/* splits the tab separated fields of a bulk line, the last field takes the rest of the line */
+static int phpdbg_import_fields(char *rest, char **field, int count) /* {{{ */
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (!rest || !*rest) {
+			return FAILURE;
+		}
+
+		field[i] = rest;
+
+		if (i < count - 1 && (rest = strchr(rest, '\t'))) {
+			*rest++ = '\0';
+		}
+	}
+
+	return i == count ? SUCCESS : FAILURE;
+} /* }}} */
+
+static int phpdbg_import_number(const char *str, long *num) /* {{{ */
+{
+	char *end;
+
+	*num = strtol(str, &end, 10);
+
+	return (end != str && !*end) ? SUCCESS : FAILURE;
+} /* }}} */
+
+/* returns FAILURE for a malformed line, *added tells whether the breakpoint was set */
+static int phpdbg_import_breakpoint(char *line, zend_bool *added TSRMLS_DC) /* {{{ */
+{
+	char *field[4], *rest = strchr(line, '\t');
+	zend_bool disabled = 0;
+	int result;
+	long num;
+
+	if (!rest) {
+		return FAILURE;
+	}
+	*rest++ = '\0';
+
+	/* the state of the breakpoint comes right after its kind */
+	if (!strncmp(rest, "enabled\t", sizeof("enabled\t") - 1)) {
+		rest += sizeof("enabled\t") - 1;
+	} else if (!strncmp(rest, "disabled\t", sizeof("disabled\t") - 1)) {
+		rest += sizeof("disabled\t") - 1;
+		disabled = 1;
+	} else {
+		return FAILURE;
+	}
+
+#define PHPDBG_IMPORT_IS(kind) (!strcmp(line, kind))
+	if (PHPDBG_IMPORT_IS("file")) {
+		if (phpdbg_import_fields(rest, field, 2) == FAILURE || phpdbg_import_number(field[1], &num) == FAILURE) {
+			return FAILURE;
+		}
+		result = phpdbg_set_breakpoint_file(field[0], num TSRMLS_CC);
+	} else if (PHPDBG_IMPORT_IS("file#")) {
+		if (phpdbg_import_fields(rest, field, 2) == FAILURE || phpdbg_import_number(field[1], &num) == FAILURE) {
+			return FAILURE;
+		}
+		result = phpdbg_set_breakpoint_file_opline(field[0], num TSRMLS_CC);
+	} else if (PHPDBG_IMPORT_IS("func")) {
+		if (phpdbg_import_fields(rest, field, 1) == FAILURE) {
+			return FAILURE;
+		}
+		result = phpdbg_set_breakpoint_symbol(field[0], strlen(field[0]) TSRMLS_CC);
+	} else if (PHPDBG_IMPORT_IS("func#")) {
+		if (phpdbg_import_fields(rest, field, 2) == FAILURE || phpdbg_import_number(field[1], &num) == FAILURE) {
+			return FAILURE;
+		}
+		result = phpdbg_set_breakpoint_function_opline(field[0], num TSRMLS_CC);
+	} else if (PHPDBG_IMPORT_IS("method")) {
+		if (phpdbg_import_fields(rest, field, 2) == FAILURE) {
+			return FAILURE;
+		}
+		result = phpdbg_set_breakpoint_method(field[0], field[1] TSRMLS_CC);
+	} else if (PHPDBG_IMPORT_IS("method#")) {
+		if (phpdbg_import_fields(rest, field, 3) == FAILURE || phpdbg_import_number(field[2], &num) == FAILURE) {
+			return FAILURE;
+		}
+		result = phpdbg_set_breakpoint_method_opline(field[0], field[1], num TSRMLS_CC);
+	} else if (PHPDBG_IMPORT_IS("opcode")) {
+		if (phpdbg_import_fields(rest, field, 1) == FAILURE) {
+			return FAILURE;
+		}
+		result = phpdbg_set_breakpoint_opcode(field[0], strlen(field[0]) TSRMLS_CC);
+	} else if (PHPDBG_IMPORT_IS("if")) {
+		if (!*rest) {
+			return FAILURE;
+		}
+		result = phpdbg_set_breakpoint_expression(rest, strlen(rest) TSRMLS_CC);
+	} else {
+		phpdbg_param_t param, condition;
+
+		phpdbg_init_param(&param, EMPTY_PARAM);
+		phpdbg_init_param(&condition, STR_PARAM);
+
+		if (PHPDBG_IMPORT_IS("at-file")) {
+			if (phpdbg_import_fields(rest, field, 3) == FAILURE || phpdbg_import_number(field[1], &num) == FAILURE) {
+				return FAILURE;
 			}
+			param.type = FILE_PARAM;
+			param.file.name = field[0];
+			param.file.line = num;
+			condition.str = field[2];
+		} else if (PHPDBG_IMPORT_IS("at-func")) {
+			if (phpdbg_import_fields(rest, field, 2) == FAILURE) {
+				return FAILURE;
+			}
+			param.type = STR_PARAM;
+			param.str = field[0];
+			param.len = strlen(field[0]);
+			condition.str = field[1];
+		} else if (PHPDBG_IMPORT_IS("at-method")) {
+			if (phpdbg_import_fields(rest, field, 3) == FAILURE) {
+				return FAILURE;
+			}
+			param.type = METHOD_PARAM;
+			param.method.class = field[0];
+			param.method.name = field[1];
+			condition.str = field[2];
+		} else {
+			return FAILURE;
 		}
+
+		condition.len = strlen(condition.str);
+		param.next = &condition;
+		result = phpdbg_set_breakpoint_at(&param TSRMLS_CC);
 	}
+#undef PHPDBG_IMPORT_IS
 
-	if (!(*str)[0]) {
-		*str = NULL;
+	/* ids are handed out in order, the breakpoint just set has the last one */
+	if (result == SUCCESS && disabled) {
+		phpdbg_disable_breakpoint(PHPDBG_G(bp_count) - 1 TSRMLS_CC);
 	}
+
+	*added = result == SUCCESS;
+
+	return SUCCESS;
 } /* }}} */
 
-PHPDBG_API void phpdbg_set_breakpoint_file(const char *path, long line_num TSRMLS_DC) /* {{{ */
+PHPDBG_API int phpdbg_import_breakpoints_bulk(const char *path TSRMLS_DC) /* {{{ */
+{
+	php_stream *stream = php_stream_open_wrapper((char *) path, "rb", 0, NULL);
+	zend_ulong discard = PHPDBG_G(flags) & PHPDBG_DISCARD_OUTPUT;
+	volatile int added = 0, failed = 0, malformed = 0;
+	zend_bool bailout = 0;
+	char *line;
+	size_t len;
+
+	if (!stream) {
+		phpdbg_error("import", "type=\"openfailure\" file=\"%s\"", "Failed to open %s", path);
+		return FAILURE;
+	}
+
+	/* the individual breakpoints are not reported, only the summary */
+	PHPDBG_G(flags) |= PHPDBG_DISCARD_OUTPUT;
+
+	zend_try {
+		while ((line = php_stream_get_line(stream, NULL, 0, &len))) {
+			zend_bool is_added;
+
+			while (len && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+				line[--len] = '\0';
+			}
+
+			if (len && *line != '#') {
+				if (phpdbg_import_breakpoint(line, &is_added TSRMLS_CC) == FAILURE) {
+					malformed++;
+				} else if (is_added) {
+					added++;
+				} else {
+					failed++;
+				}
+			}
+
+			efree(line);
+		}
+	} zend_catch {
+		bailout = 1;
+	} zend_end_try();
+
+	php_stream_close(stream);
+
+	/* output is restored even if setting a breakpoint bailed out */
+	PHPDBG_G(flags) = (PHPDBG_G(flags) & ~PHPDBG_DISCARD_OUTPUT) | discard;
+
+	if (bailout) {
+		zend_bailout();
+	}
+
+	phpdbg_notice("import", "added=\"%d\" failed=\"%d\" malformed=\"%d\" file=\"%s\"", "Imported %d breakpoints from %s (%d not added, %d malformed lines)", added, path, failed, malformed);
+
+	return SUCCESS;
+} /* }}} */
+
+PHPDBG_API int phpdbg_set_breakpoint_file(const char *path, long line_num TSRMLS_DC) /* {{{ */
 {
 	php_stream_statbuf ssb;
 	char realpath[MAXPATHLEN];
@@ -255,9 +646,14 @@ PHPDBG_API void phpdbg_set_breakpoint_file(const char *path, long line_num TSRML
 
 	if (!zend_hash_exists(&PHPDBG_G(file_sources), path, path_len)) {
 		if (php_stream_stat_path(path, &ssb) == FAILURE) {
+			/* a path which exists as it is written is never taken for a glob, "tpl/[id].php" included */
+			if (phpdbg_is_breakpoint_glob(original_path)) {
+				return phpdbg_set_breakpoint_file_pattern(original_path, line_num TSRMLS_CC);
+			}
+
 			if (original_path[0] == '/') {
 				phpdbg_error("breakpoint", "type=\"nofile\" add=\"fail\" file=\"%s\"", "Cannot stat %s, it does not exist", original_path);
-				return;
+				return FAILURE;
 			}
 
 			file_breaks = &PHPDBG_G(bp)[PHPDBG_BREAK_FILE_PENDING];
@@ -266,7 +662,7 @@ PHPDBG_API void phpdbg_set_breakpoint_file(const char *path, long line_num TSRML
 			pending = 1;
 		} else if (!(ssb.sb.st_mode & (S_IFREG|S_IFLNK))) {
 			phpdbg_error("breakpoint", "type=\"notregular\" add=\"fail\" file=\"%s\"", "Cannot set breakpoint in %s, it is not a regular file", path);
-			return;
+			return FAILURE;
 		} else {
 			phpdbg_debug("File exists, but not compiled\n");
 		}
@@ -277,20 +673,25 @@ PHPDBG_API void phpdbg_set_breakpoint_file(const char *path, long line_num TSRML
 		zend_hash_init(&breaks, 8, NULL, phpdbg_file_breaks_dtor, 0);
 
 		zend_hash_add(file_breaks, path, path_len, &breaks, sizeof(HashTable), (void **) &broken);
+
+		if (pending) {
+			phpdbg_index_pending_file(path, path_len TSRMLS_CC);
+		}
 	}
 
 	if (!zend_hash_index_exists(broken, line_num)) {
 		HashPosition position;
 		char *file;
 		uint filelen;
+		phpdbg_breakfile_t *stored;
 
 		PHPDBG_BREAK_INIT(new_break, PHPDBG_BREAK_FILE);
 		new_break.filename = estrndup(path, path_len);
 		new_break.line = line_num;
 
-		zend_hash_index_update(broken, line_num, (void **) &new_break, sizeof(phpdbg_breakfile_t), NULL);
+		zend_hash_index_update(broken, line_num, (void **) &new_break, sizeof(phpdbg_breakfile_t), (void **) &stored);
 
-		PHPDBG_BREAK_MAPPING(new_break.id, broken);
+		PHPDBG_BREAK_MAPPING(new_break.id, broken, stored);
 
 		if (pending) {
 			for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(file_sources), &position);
@@ -320,15 +721,55 @@ PHPDBG_API void phpdbg_set_breakpoint_file(const char *path, long line_num TSRML
 		}
 	} else {
 		phpdbg_error("breakpoint", "type=\"exists\" add=\"fail\" file=\"%s\" line=\"%ld\"", "Breakpoint at %s:%ld exists", path, line_num);
+		return FAILURE;
+	}
+
+	return SUCCESS;
+} /* }}} */
+
+/* whether the components of cur are the last ones of file, empty components ("a//b.php") are skipped like in the pending trie */
+static zend_bool phpdbg_is_pending_file_of(const char *file, uint filelen, const char *cur, uint curlen) /* {{{ */
+{
+	const char *f = file + filelen, *c = cur + curlen;
+	zend_bool matched = 0;
+
+	while (1) {
+		while (c > cur && c[-1] == '/') {
+			c--;
+		}
+		if (c == cur) {
+			/* an absolute path has to match the whole file */
+			if (*cur == '/') {
+				while (f > file && f[-1] == '/') {
+					f--;
+				}
+				return matched && f == file;
+			}
+			return matched;
+		}
+
+		while (f > file && f[-1] == '/') {
+			f--;
+		}
+		while (c > cur && c[-1] != '/') {
+			if (f == file || *--f != *--c) {
+				return 0;
+			}
+		}
+		if (f > file && f[-1] != '/') {
+			return 0;
+		}
+
+		matched = 1;
 	}
 } /* }}} */
 
 PHPDBG_API HashTable *phpdbg_resolve_pending_file_break_ex(const char *file, uint filelen, const char *cur, uint curlen, HashTable *fileht TSRMLS_DC) /* {{{ */
 {
-	phpdbg_debug("file: %s, filelen: %u, cur: %s, curlen %u, pos: %c, memcmp: %d\n", file, filelen, cur, curlen, filelen > curlen ? file[filelen - curlen - 1] : '?', filelen > curlen ? memcmp(file + filelen - curlen, cur, curlen) : 0);
+	phpdbg_debug("file: %s, filelen: %u, cur: %s, curlen %u\n", file, filelen, cur, curlen);
 
-	if (((curlen < filelen && file[filelen - curlen - 1] == '/') || filelen == curlen) && !memcmp(file + filelen - curlen, cur, curlen)) {
-		phpdbg_breakfile_t *brake, new_brake;
+	if (phpdbg_is_pending_file_of(file, filelen, cur, curlen)) {
+		phpdbg_breakfile_t *brake, *stored, new_brake;
 		HashTable *master = NULL;
 		HashPosition position;
 
@@ -348,19 +789,24 @@ PHPDBG_API HashTable *phpdbg_resolve_pending_file_break_ex(const char *file, uin
 			PHPDBG_BREAK_UNMAPPING(brake->id);
 
 			if (master) {
-				zend_hash_index_update(master, brake->line, (void **) &new_brake, sizeof(phpdbg_breakfile_t), NULL);
-				PHPDBG_BREAK_MAPPING(brake->id, master);
+				/* an existing breakpoint on that line is replaced */
+				if (zend_hash_index_find(master, brake->line, (void **) &stored) == SUCCESS) {
+					PHPDBG_BREAK_UNMAPPING(stored->id);
+				}
+				zend_hash_index_update(master, brake->line, (void **) &new_brake, sizeof(phpdbg_breakfile_t), (void **) &stored);
+				PHPDBG_BREAK_MAPPING(brake->id, master, stored);
 			}
 		}
 
+		phpdbg_debug("compiled file: %s, cur bp file: %s\n", file, cur);
+
 		zend_hash_del(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE_PENDING], cur, curlen);
+		phpdbg_unindex_pending_file(cur, curlen TSRMLS_CC);
 
 		if (!zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE_PENDING])) {
 			PHPDBG_G(flags) &= ~PHPDBG_HAS_PENDING_FILE_BP;
 		}
 
-		phpdbg_debug("compiled file: %s, cur bp file: %s\n", file, cur);
-
 		return master;
 	}
 
@@ -369,30 +815,418 @@ PHPDBG_API HashTable *phpdbg_resolve_pending_file_break_ex(const char *file, uin
 
 PHPDBG_API void phpdbg_resolve_pending_file_break(const char *file TSRMLS_DC) /* {{{ */
 {
-	HashPosition position;
-	HashTable *fileht;
+	phpdbg_pending_file_t *node = &PHPDBG_G(pending_files);
 	uint filelen = strlen(file);
+	const char *start, *end = file + filelen;
 
 	phpdbg_debug("was compiled: %s\n", file);
 
-	zend_hash_internal_pointer_reset_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE_PENDING], &position);
-	while (zend_hash_get_current_data_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE_PENDING], (void**) &fileht, &position) == SUCCESS) {
-		const char *cur;
-		uint curlen;
+	if (!zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE_PENDING])) {
+		return;
+	}
+
+	/* walk the path from its last component on, every pending path ending at a visited node is a suffix of it */
+	while (end > file) {
+		for (start = end; start > file && start[-1] != '/'; start--);
+
+		if (start < end) {
+			HashPosition position;
+			char *key;
+			uint keylen;
 
-		zend_hash_get_current_key_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE_PENDING], (char **) &cur, &curlen, NULL, 0, &position);
-		zend_hash_move_forward_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE_PENDING], &position);
+			if (zend_hash_find(&node->children, start, end - start, (void **) &node) == FAILURE) {
+				break;
+			}
+
+			/* paths "a/b.php", "a//b.php" and "/a/b.php" share a node, each is checked by phpdbg_resolve_pending_file_break_ex() */
+			zend_hash_internal_pointer_reset_ex(&node->paths, &position);
+			while (zend_hash_get_current_key_ex(&node->paths, &key, &keylen, NULL, 0, &position) == HASH_KEY_IS_STRING) {
+				HashTable *fileht;
+				char *cur = estrndup(key, keylen);
+				uint curlen = keylen;
+
+				/* resolving unindexes cur, so the position is moved away from it first */
+				zend_hash_move_forward_ex(&node->paths, &position);
+
+				phpdbg_debug("check bp: %s\n", cur);
+
+				if (zend_hash_find(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE_PENDING], cur, curlen, (void **) &fileht) == FAILURE) {
+					/* the pending table was cleaned behind our back */
+					phpdbg_unindex_pending_file(cur, curlen TSRMLS_CC);
+				} else {
+					phpdbg_resolve_pending_file_break_ex(file, filelen, cur, curlen, fileht TSRMLS_CC);
+				}
 
-		phpdbg_debug("check bp: %s\n", cur);
+				efree(cur);
+			}
+		}
 
-		phpdbg_resolve_pending_file_break_ex(file, filelen, cur, curlen, fileht TSRMLS_CC);
+		if (start == file) {
+			break;
+		}
+		end = start - 1;
 	}
-}
+} /* }}} */
+
+static void phpdbg_pending_file_dtor(void *data) /* {{{ */
+{
+	phpdbg_pending_file_t *node = (phpdbg_pending_file_t *) data;
+
+	zend_hash_destroy(&node->children);
+	zend_hash_destroy(&node->paths);
+} /* }}} */
+
+static void phpdbg_pending_file_ctor(phpdbg_pending_file_t *node, uint size) /* {{{ */
+{
+	zend_hash_init(&node->children, size, NULL, phpdbg_pending_file_dtor, 0);
+	zend_hash_init(&node->paths, 1, NULL, NULL, 0);
+} /* }}} */
+
+void phpdbg_init_pending_files(TSRMLS_D) /* {{{ */
+{
+	phpdbg_pending_file_ctor(&PHPDBG_G(pending_files), 8);
+} /* }}} */
+
+void phpdbg_destroy_pending_files(TSRMLS_D) /* {{{ */
+{
+	phpdbg_pending_file_dtor(&PHPDBG_G(pending_files));
+} /* }}} */
+
+/* returns the node of the last component of path (the first one looked at), creating missing nodes on demand;
+ * empty components, as in "a//b.php", are skipped */
+static phpdbg_pending_file_t *phpdbg_pending_file_node(const char *path, uint path_len, zend_bool create TSRMLS_DC) /* {{{ */
+{
+	phpdbg_pending_file_t *node = &PHPDBG_G(pending_files), *child;
+	const char *start, *end = path + path_len;
+
+	while (end > path) {
+		for (start = end; start > path && start[-1] != '/'; start--);
+
+		if (start < end) {
+			if (zend_hash_find(&node->children, start, end - start, (void **) &child) == FAILURE) {
+				phpdbg_pending_file_t new_node;
+
+				if (!create) {
+					return NULL;
+				}
+
+				phpdbg_pending_file_ctor(&new_node, 1);
+				if (zend_hash_add(&node->children, start, end - start, &new_node, sizeof(phpdbg_pending_file_t), (void **) &child) == FAILURE) {
+					phpdbg_pending_file_dtor(&new_node);
+					return NULL;
+				}
+			}
+
+			node = child;
+		}
+
+		if (start == path) {
+			break;
+		}
+		end = start - 1;
+	}
+
+	return node;
+} /* }}} */
+
+static void phpdbg_index_pending_file(const char *path, uint path_len TSRMLS_DC) /* {{{ */
+{
+	phpdbg_pending_file_t *node = phpdbg_pending_file_node(path, path_len, 1 TSRMLS_CC);
+	char dummy = 1;
+
+	if (node && node != &PHPDBG_G(pending_files)) {
+		zend_hash_update(&node->paths, path, path_len, &dummy, sizeof(char), NULL);
+	}
+} /* }}} */
+
+static void phpdbg_unindex_pending_file(const char *path, uint path_len TSRMLS_DC) /* {{{ */
+{
+	phpdbg_pending_file_t *node = phpdbg_pending_file_node(path, path_len, 0 TSRMLS_CC);
+
+	if (node) {
+		zend_hash_del(&node->paths, path, path_len);
+	}
+} /* }}} */
+
+static inline zend_bool phpdbg_is_breakpoint_glob(const char *str) /* {{{ */
+{
+	return strpbrk(str, "*?[") != NULL;
+} /* }}} */
+
+static inline zend_bool phpdbg_is_breakpoint_regex(const char *str, size_t len) /* {{{ */
+{
+	return len > 2 && str[0] == '/' && str[len - 1] == '/';
+} /* }}} */
+
+PHPDBG_API zend_bool phpdbg_is_breakpoint_pattern(const char *str, size_t len) /* {{{ */
+{
+	return phpdbg_is_breakpoint_regex(str, len) || phpdbg_is_breakpoint_glob(str);
+} /* }}} */
+
+/* globs match lowercased names, as functions and classes are case insensitive; regular expressions match the name as declared */
+static zend_bool phpdbg_match_pattern(const char *pattern, const char *name, const char *lcname, zend_bool path TSRMLS_DC) /* {{{ */
+{
+	size_t pattern_len = strlen(pattern);
+
+	if (!path && phpdbg_is_breakpoint_regex(pattern, pattern_len)) {
+		pcre_extra *extra;
+		int options;
+		pcre *re = pcre_get_compiled_regex((char *) pattern, &extra, &options TSRMLS_CC);
+
+		return re && pcre_exec(re, extra, name, strlen(name), 0, 0, NULL, 0) >= 0;
+	}
+
+#ifdef HAVE_FNMATCH
+	return fnmatch(pattern, lcname, FNM_NOESCAPE | (path ? FNM_PATHNAME : 0)) == 0;
+#else
+	/* not reached, globs are refused when they are set */
+	return 0;
+#endif
+} /* }}} */
+
+/* an absolute glob matches the whole path, a relative one any trailing components of it */
+static zend_bool phpdbg_match_file_pattern(const char *pattern, const char *file TSRMLS_DC) /* {{{ */
+{
+	const char *cur = file;
+
+	if (IS_ABSOLUTE_PATH(pattern, strlen(pattern))) {
+		return phpdbg_match_pattern(pattern, file, file, 1 TSRMLS_CC);
+	}
+
+	do {
+		if (phpdbg_match_pattern(pattern, cur, cur, 1 TSRMLS_CC)) {
+			return 1;
+		}
+	} while ((cur = strchr(cur, '/')) && *++cur);
+
+	return 0;
+} /* }}} */
+
+static void phpdbg_pattern_lines_dtor(void *data) /* {{{ */
+{
+	zend_hash_destroy((HashTable *) data);
+} /* }}} */
+
+void phpdbg_init_pattern_matches(TSRMLS_D) /* {{{ */
+{
+	zend_hash_init(&PHPDBG_G(pattern_files), 8, NULL, phpdbg_pattern_lines_dtor, 0);
+	zend_hash_init(&PHPDBG_G(pattern_symbols), 8, NULL, NULL, 0);
+} /* }}} */
+
+void phpdbg_destroy_pattern_matches(TSRMLS_D) /* {{{ */
+{
+	zend_hash_destroy(&PHPDBG_G(pattern_files));
+	zend_hash_destroy(&PHPDBG_G(pattern_symbols));
+} /* }}} */
+
+PHPDBG_API void phpdbg_resolve_pattern_file_break(const char *file TSRMLS_DC) /* {{{ */
+{
+	HashPosition position;
+	HashTable *lines = NULL;
+	phpdbg_breakpattern_t *brake;
+	uint filelen = strlen(file);
+
+	if (!zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN])) {
+		return;
+	}
+
+	zend_hash_del(&PHPDBG_G(pattern_files), file, filelen);
+
+	for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], &position);
+	     zend_hash_get_current_data_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], (void **) &brake, &position) == SUCCESS;
+	     zend_hash_move_forward_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], &position)) {
+		if (brake->kind != PHPDBG_PATTERN_FILE || !phpdbg_match_file_pattern(brake->pattern, file TSRMLS_CC)) {
+			continue;
+		}
+
+		phpdbg_debug("pattern %s matches %s\n", brake->pattern, file);
+
+		if (!lines) {
+			HashTable new_lines;
+
+			zend_hash_init(&new_lines, 8, NULL, NULL, 0);
+			zend_hash_add(&PHPDBG_G(pattern_files), file, filelen, &new_lines, sizeof(HashTable), (void **) &lines);
+		}
+
+		/* the first pattern set on a line wins */
+		if (!zend_hash_index_exists(lines, brake->line)) {
+			zend_hash_index_update(lines, brake->line, &brake, sizeof(phpdbg_breakpattern_t *), NULL);
+		}
+	}
+} /* }}} */
 
-PHPDBG_API void phpdbg_set_breakpoint_symbol(const char *name, size_t name_len TSRMLS_DC) /* {{{ */
+/* the matches refer to the pattern breakpoints, they are worked out again whenever those change */
+static void phpdbg_rematch_patterns(TSRMLS_D) /* {{{ */
 {
+	HashPosition position;
+	phpdbg_breakpattern_t *brake;
+	char *file;
+	uint filelen;
+
+	zend_hash_clean(&PHPDBG_G(pattern_files));
+	zend_hash_clean(&PHPDBG_G(pattern_symbols));
+
+	/* function entries only look at the patterns when one of them can match a function */
+	PHPDBG_G(flags) &= ~PHPDBG_HAS_SYM_PATTERN_BP;
+	for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], &position);
+	     zend_hash_get_current_data_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], (void **) &brake, &position) == SUCCESS;
+	     zend_hash_move_forward_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], &position)) {
+		if (brake->kind != PHPDBG_PATTERN_FILE) {
+			PHPDBG_G(flags) |= PHPDBG_HAS_SYM_PATTERN_BP;
+			break;
+		}
+	}
+
+	for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(file_sources), &position);
+	     zend_hash_get_current_key_ex(&PHPDBG_G(file_sources), &file, &filelen, NULL, 0, &position) == HASH_KEY_IS_STRING;
+	     zend_hash_move_forward_ex(&PHPDBG_G(file_sources), &position)) {
+		phpdbg_resolve_pattern_file_break(file TSRMLS_CC);
+	}
+} /* }}} */
+
+static int phpdbg_set_breakpoint_pattern(zend_uchar kind, const char *pattern, const char *method, long line TSRMLS_DC) /* {{{ */
+{
+	char *key;
+	int key_len;
+
+	switch (kind) {
+		case PHPDBG_PATTERN_FILE:
+			key_len = spprintf(&key, 0, "%c%s:%ld", '0' + kind, pattern, line);
+			break;
+		case PHPDBG_PATTERN_METHOD:
+			key_len = spprintf(&key, 0, "%c%s::%s", '0' + kind, pattern, method);
+			break;
+		default:
+			key_len = spprintf(&key, 0, "%c%s", '0' + kind, pattern);
+	}
+
+	if (!zend_hash_exists(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], key, key_len)) {
+		phpdbg_breakpattern_t new_break, *stored;
+
+		PHPDBG_BREAK_INIT(new_break, PHPDBG_BREAK_PATTERN);
+		new_break.pattern = estrdup(pattern);
+		new_break.method = method ? estrdup(method) : NULL;
+		new_break.kind = kind;
+		new_break.line = line;
+
+		zend_hash_update(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], key, key_len, &new_break, sizeof(phpdbg_breakpattern_t), (void **) &stored);
+
+		PHPDBG_BREAK_MAPPING(new_break.id, &PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], stored);
+
+		PHPDBG_G(flags) |= PHPDBG_HAS_PATTERN_BP;
+
+		phpdbg_rematch_patterns(TSRMLS_C);
+
+		phpdbg_notice("breakpoint", "add=\"success\" id=\"%d\" pattern=\"%s\"", "Breakpoint #%d added matching %s", new_break.id, key + 1);
+	} else {
+		phpdbg_error("breakpoint", "type=\"exists\" add=\"fail\" pattern=\"%s\"", "Breakpoint matching %s exists", key + 1);
+		efree(key);
+		return FAILURE;
+	}
+
+	efree(key);
+
+	return SUCCESS;
+} /* }}} */
+
+/* globs are matched by fnmatch(), without it they are refused rather than compared as plain names */
+static zend_bool phpdbg_check_breakpoint_glob(const char *pattern TSRMLS_DC) /* {{{ */
+{
+#ifndef HAVE_FNMATCH
+	phpdbg_error("breakpoint", "type=\"noglob\" add=\"fail\" pattern=\"%s\"", "Cannot set breakpoint matching %s, globs are not supported on this platform", pattern);
+	return 0;
+#else
+	return 1;
+#endif
+} /* }}} */
+
+static zend_bool phpdbg_check_breakpoint_pattern(const char *pattern TSRMLS_DC) /* {{{ */
+{
+	size_t pattern_len = strlen(pattern);
+
+	if (phpdbg_is_breakpoint_regex(pattern, pattern_len)) {
+		pcre_extra *extra;
+		int options;
+
+		if (!pcre_get_compiled_regex((char *) pattern, &extra, &options TSRMLS_CC)) {
+			phpdbg_error("breakpoint", "type=\"invalidpattern\" add=\"fail\" pattern=\"%s\"", "%s is not a valid regular expression", pattern);
+			return 0;
+		}
+
+		return 1;
+	}
+
+	return !phpdbg_is_breakpoint_glob(pattern) || phpdbg_check_breakpoint_glob(pattern TSRMLS_CC);
+} /* }}} */
+
+PHPDBG_API int phpdbg_set_breakpoint_file_pattern(const char *pattern, long line TSRMLS_DC) /* {{{ */
+{
+	if (!phpdbg_check_breakpoint_glob(pattern TSRMLS_CC)) {
+		return FAILURE;
+	}
+
+	return phpdbg_set_breakpoint_pattern(PHPDBG_PATTERN_FILE, pattern, NULL, line TSRMLS_CC);
+} /* }}} */
+
+PHPDBG_API int phpdbg_set_breakpoint_symbol_pattern(const char *pattern, size_t pattern_len TSRMLS_DC) /* {{{ */
+{
+	char *lcpattern;
+	int result;
+
+	if (*pattern == '\\') {
+		pattern++;
+		pattern_len--;
+	}
+
+	if (!phpdbg_check_breakpoint_pattern(pattern TSRMLS_CC)) {
+		return FAILURE;
+	}
+
+	lcpattern = phpdbg_is_breakpoint_regex(pattern, pattern_len) ? estrndup(pattern, pattern_len) : zend_str_tolower_dup(pattern, pattern_len);
+	result = phpdbg_set_breakpoint_pattern(PHPDBG_PATTERN_FUNCTION, lcpattern, NULL, 0 TSRMLS_CC);
+	efree(lcpattern);
+
+	return result;
+} /* }}} */
+
+PHPDBG_API int phpdbg_set_breakpoint_method_pattern(const char *class_pattern, const char *func_pattern TSRMLS_DC) /* {{{ */
+{
+	size_t class_len, func_len = strlen(func_pattern);
+	char *lcclass, *lcfunc;
+	int result;
+
+	if (*class_pattern == '\\') {
+		class_pattern++;
+	}
+	class_len = strlen(class_pattern);
+
+	if (!phpdbg_check_breakpoint_pattern(class_pattern TSRMLS_CC) || !phpdbg_check_breakpoint_pattern(func_pattern TSRMLS_CC)) {
+		return FAILURE;
+	}
+
+	lcclass = phpdbg_is_breakpoint_regex(class_pattern, class_len) ? estrndup(class_pattern, class_len) : zend_str_tolower_dup(class_pattern, class_len);
+	lcfunc = phpdbg_is_breakpoint_regex(func_pattern, func_len) ? estrndup(func_pattern, func_len) : zend_str_tolower_dup(func_pattern, func_len);
+	result = phpdbg_set_breakpoint_pattern(PHPDBG_PATTERN_METHOD, lcclass, lcfunc, 0 TSRMLS_CC);
+	efree(lcclass);
+	efree(lcfunc);
+
+	return result;
+} /* }}} */
+
+PHPDBG_API int phpdbg_set_breakpoint_symbol(const char *name, size_t name_len TSRMLS_DC) /* {{{ */
+{
+	if (phpdbg_is_breakpoint_pattern(name, name_len)) {
+		return phpdbg_set_breakpoint_symbol_pattern(name, name_len TSRMLS_CC);
+	}
+
+	/* a leading backslash only qualifies the name, it tells "break \import" from "break import" */
+	if (*name == '\\' && name_len > 1) {
+		name++;
+		name_len--;
+	}
+
 	if (!zend_hash_exists(&PHPDBG_G(bp)[PHPDBG_BREAK_SYM], name, name_len)) {
-		phpdbg_breaksymbol_t new_break;
+		phpdbg_breaksymbol_t new_break, *stored;
 
 		PHPDBG_G(flags) |= PHPDBG_HAS_SYM_BP;
 
@@ -400,23 +1234,32 @@ PHPDBG_API void phpdbg_set_breakpoint_symbol(const char *name, size_t name_len T
 		new_break.symbol = estrndup(name, name_len);
 
 		zend_hash_update(&PHPDBG_G(bp)[PHPDBG_BREAK_SYM], new_break.symbol,
-			name_len, &new_break, sizeof(phpdbg_breaksymbol_t), NULL);
+			name_len, &new_break, sizeof(phpdbg_breaksymbol_t), (void **) &stored);
 
 		phpdbg_notice("breakpoint", "add=\"success\" id=\"%d\" function=\"%s\"", "Breakpoint #%d added at %s",
 			new_break.id, new_break.symbol);
 
-		PHPDBG_BREAK_MAPPING(new_break.id, &PHPDBG_G(bp)[PHPDBG_BREAK_SYM]);
+		PHPDBG_BREAK_MAPPING(new_break.id, &PHPDBG_G(bp)[PHPDBG_BREAK_SYM], stored);
 	} else {
 		phpdbg_error("breakpoint", "type=\"exists\" add=\"fail\" function=\"%s\"", "Breakpoint exists at %s", name);
+		return FAILURE;
 	}
+
+	return SUCCESS;
 } /* }}} */
 
-PHPDBG_API void phpdbg_set_breakpoint_method(const char *class_name, const char *func_name TSRMLS_DC) /* {{{ */
+PHPDBG_API int phpdbg_set_breakpoint_method(const char *class_name, const char *func_name TSRMLS_DC) /* {{{ */
 {
 	HashTable class_breaks, *class_table;
 	size_t class_len = strlen(class_name);
 	size_t func_len = strlen(func_name);
-	char *lcname = zend_str_tolower_dup(func_name, func_len);
+	char *lcname;
+
+	if (phpdbg_is_breakpoint_pattern(class_name, class_len) || phpdbg_is_breakpoint_pattern(func_name, func_len)) {
+		return phpdbg_set_breakpoint_method_pattern(class_name, func_name TSRMLS_CC);
+	}
+
+	lcname = zend_str_tolower_dup(func_name, func_len);
 
 	if (zend_hash_find(&PHPDBG_G(bp)[PHPDBG_BREAK_METHOD], class_name,
 		class_len, (void**)&class_table) != SUCCESS) {
@@ -428,7 +1271,7 @@ PHPDBG_API void phpdbg_set_breakpoint_method(const char *class_name, const char
 	}
 
 	if (!zend_hash_exists(class_table, lcname, func_len)) {
-		phpdbg_breakmethod_t new_break;
+		phpdbg_breakmethod_t new_break, *stored;
 
 		PHPDBG_G(flags) |= PHPDBG_HAS_METHOD_BP;
 
@@ -439,23 +1282,27 @@ PHPDBG_API void phpdbg_set_breakpoint_method(const char *class_name, const char
 		new_break.func_len = func_len;
 
 		zend_hash_update(class_table, lcname, func_len,
-			&new_break, sizeof(phpdbg_breakmethod_t), NULL);
+			&new_break, sizeof(phpdbg_breakmethod_t), (void **) &stored);
 
 		phpdbg_notice("breakpoint", "add=\"success\" id=\"%d\" method=\"%s::%s\"", "Breakpoint #%d added at %s::%s",
 			new_break.id, class_name, func_name);
 
-		PHPDBG_BREAK_MAPPING(new_break.id, class_table);
+		PHPDBG_BREAK_MAPPING(new_break.id, class_table, stored);
 	} else {
 		phpdbg_error("breakpoint", "type=\"exists\" add=\"fail\" method=\"%s::%s\"", "Breakpoint exists at %s::%s", class_name, func_name);
+		efree(lcname);
+		return FAILURE;
 	}
 
 	efree(lcname);
+
+	return SUCCESS;
 } /* }}} */
 
-PHPDBG_API void phpdbg_set_breakpoint_opline(zend_ulong opline TSRMLS_DC) /* {{{ */
+PHPDBG_API int phpdbg_set_breakpoint_opline(zend_ulong opline TSRMLS_DC) /* {{{ */
 {
 	if (!zend_hash_index_exists(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE], opline)) {
-		phpdbg_breakline_t new_break;
+		phpdbg_breakline_t new_break, *stored;
 
 		PHPDBG_G(flags) |= PHPDBG_HAS_OPLINE_BP;
 
@@ -465,19 +1312,22 @@ PHPDBG_API void phpdbg_set_breakpoint_opline(zend_ulong opline TSRMLS_DC) /* {{{
 		new_break.base = NULL;
 
 		zend_hash_index_update(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE], opline,
-			&new_break, sizeof(phpdbg_breakline_t), NULL);
+			&new_break, sizeof(phpdbg_breakline_t), (void **) &stored);
 
 		phpdbg_notice("breakpoint", "add=\"success\" id=\"%d\" opline=\"%#lx\"", "Breakpoint #%d added at %#lx",
 			new_break.id, new_break.opline);
-		PHPDBG_BREAK_MAPPING(new_break.id, &PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE]);
+		PHPDBG_BREAK_MAPPING(new_break.id, &PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE], stored);
 	} else {
 		phpdbg_error("breakpoint", "type=\"exists\" add=\"fail\" opline=\"%#lx\"", "Breakpoint exists at %#lx", opline);
+		return FAILURE;
 	}
+
+	return SUCCESS;
 } /* }}} */
 
 PHPDBG_API int phpdbg_resolve_op_array_break(phpdbg_breakopline_t *brake, zend_op_array *op_array TSRMLS_DC) /* {{{ */
 {
-	phpdbg_breakline_t opline_break;
+	phpdbg_breakline_t opline_break, *existing;
 	if (op_array->last <= brake->opline_num) {
 		if (brake->class_name == NULL) {
 			phpdbg_error("breakpoint", "type=\"maxoplines\" add=\"fail\" maxoplinenum=\"%d\" function=\"%s\" usedoplinenum=\"%ld\"", "There are only %d oplines in function %s (breaking at opline %ld impossible)", op_array->last, brake->func_name, brake->opline_num);
@@ -490,10 +1340,17 @@ PHPDBG_API int phpdbg_resolve_op_array_break(phpdbg_breakopline_t *brake, zend_o
 		return FAILURE;
 	}
 
+	opline_break.opline = brake->opline = (zend_ulong)(op_array->opcodes + brake->opline_num);
+
+	/* the id map points at the record already breaking there, it must not be overwritten */
+	if (zend_hash_index_find(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE], opline_break.opline, (void **) &existing) == SUCCESS && existing->id != brake->id) {
+		phpdbg_error("breakpoint", "type=\"exists\" add=\"fail\" id=\"%d\" opline=\"%#lx\"", "Breakpoint #%d already breaks at opline %#lx", existing->id, opline_break.opline);
+		return FAILURE;
+	}
+
 	opline_break.disabled = 0;
 	opline_break.hits = 0;
 	opline_break.id = brake->id;
-	opline_break.opline = brake->opline = (zend_ulong)(op_array->opcodes + brake->opline_num);
 	opline_break.name = NULL;
 	opline_break.base = brake;
 	if (op_array->scope) {
@@ -534,6 +1391,12 @@ PHPDBG_API void phpdbg_resolve_op_array_breaks(zend_op_array *op_array TSRMLS_DC
 	for (zend_hash_internal_pointer_reset_ex(oplines_table, &position);
 	     zend_hash_get_current_data_ex(oplines_table, (void**) &brake, &position) == SUCCESS;
 	     zend_hash_move_forward_ex(oplines_table, &position)) {
+		/* this runs before every opline, a breakpoint already resolved into this op_array keeps its record and hits */
+		if (brake->opline_num < op_array->last && brake->opline == (zend_ulong)(op_array->opcodes + brake->opline_num)
+		 && zend_hash_index_exists(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE], brake->opline)) {
+			continue;
+		}
+
 		if (phpdbg_resolve_op_array_break(brake, op_array TSRMLS_CC) == SUCCESS) {
 			phpdbg_breakline_t *opline_break;
 
@@ -613,9 +1476,9 @@ PHPDBG_API int phpdbg_resolve_opline_break(phpdbg_breakopline_t *new_break TSRML
 	return SUCCESS;
 } /* }}} */
 
-PHPDBG_API void phpdbg_set_breakpoint_method_opline(const char *class, const char *method, zend_ulong opline TSRMLS_DC) /* {{{ */
+PHPDBG_API int phpdbg_set_breakpoint_method_opline(const char *class, const char *method, zend_ulong opline TSRMLS_DC) /* {{{ */
 {
-	phpdbg_breakopline_t new_break;
+	phpdbg_breakopline_t new_break, *stored;
 	HashTable class_breaks, *class_table;
 	HashTable method_breaks, *method_table;
 
@@ -637,7 +1500,7 @@ PHPDBG_API void phpdbg_set_breakpoint_method_opline(const char *class, const cha
 			break;
 
 		case 2:
-			return;
+			return FAILURE;
 	}
 
 	if (zend_hash_find(&PHPDBG_G(bp)[PHPDBG_BREAK_METHOD_OPLINE], new_break.class_name, new_break.class_len, (void **)&class_table) == FAILURE) {
@@ -663,19 +1526,22 @@ PHPDBG_API void phpdbg_set_breakpoint_method_opline(const char *class, const cha
 		efree((char*)new_break.func_name);
 		efree((char*)new_break.class_name);
 		PHPDBG_G(bp_count)--;
-		return;
+		return FAILURE;
 	}
 
 	PHPDBG_G(flags) |= PHPDBG_HAS_METHOD_OPLINE_BP;
 
-	PHPDBG_BREAK_MAPPING(new_break.id, method_table);
 
-	zend_hash_index_update(method_table, opline, &new_break, sizeof(phpdbg_breakopline_t), NULL);
+	zend_hash_index_update(method_table, opline, &new_break, sizeof(phpdbg_breakopline_t), (void **) &stored);
+
+	PHPDBG_BREAK_MAPPING(new_break.id, method_table, stored);
+
+	return SUCCESS;
 }
 
-PHPDBG_API void phpdbg_set_breakpoint_function_opline(const char *function, zend_ulong opline TSRMLS_DC) /* {{{ */
+PHPDBG_API int phpdbg_set_breakpoint_function_opline(const char *function, zend_ulong opline TSRMLS_DC) /* {{{ */
 {
-	phpdbg_breakopline_t new_break;
+	phpdbg_breakopline_t new_break, *stored;
 	HashTable func_breaks, *func_table;
 
 	PHPDBG_BREAK_INIT(new_break, PHPDBG_BREAK_FUNCTION_OPLINE);
@@ -696,7 +1562,7 @@ PHPDBG_API void phpdbg_set_breakpoint_function_opline(const char *function, zend
 			break;
 
 		case 2:
-			return;
+			return FAILURE;
 	}
 
 	if (zend_hash_find(&PHPDBG_G(bp)[PHPDBG_BREAK_FUNCTION_OPLINE], new_break.func_name, new_break.func_len, (void **)&func_table) == FAILURE) {
@@ -712,19 +1578,22 @@ PHPDBG_API void phpdbg_set_breakpoint_function_opline(const char *function, zend
 		phpdbg_error("breakpoint", "type=\"exists\" function=\"%s\" num=\"%ld\"", "Breakpoint already exists for %s#%ld", new_break.func_name, opline);
 		efree((char*)new_break.func_name);
 		PHPDBG_G(bp_count)--;
-		return;
+		return FAILURE;
 	}
 
-	PHPDBG_BREAK_MAPPING(new_break.id, func_table);
 
 	PHPDBG_G(flags) |= PHPDBG_HAS_FUNCTION_OPLINE_BP;
 
-	zend_hash_index_update(func_table, opline, &new_break, sizeof(phpdbg_breakopline_t), NULL);
+	zend_hash_index_update(func_table, opline, &new_break, sizeof(phpdbg_breakopline_t), (void **) &stored);
+
+	PHPDBG_BREAK_MAPPING(new_break.id, func_table, stored);
+
+	return SUCCESS;
 }
 
-PHPDBG_API void phpdbg_set_breakpoint_file_opline(const char *file, zend_ulong opline TSRMLS_DC) /* {{{ */
+PHPDBG_API int phpdbg_set_breakpoint_file_opline(const char *file, zend_ulong opline TSRMLS_DC) /* {{{ */
 {
-	phpdbg_breakopline_t new_break;
+	phpdbg_breakopline_t new_break, *stored;
 	HashTable file_breaks, *file_table;
 
 	PHPDBG_BREAK_INIT(new_break, PHPDBG_BREAK_FILE_OPLINE);
@@ -745,7 +1614,7 @@ PHPDBG_API void phpdbg_set_breakpoint_file_opline(const char *file, zend_ulong o
 			break;
 
 		case 2:
-			return;
+			return FAILURE;
 	}
 
 	if (zend_hash_find(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE_OPLINE], new_break.class_name, new_break.class_len, (void **)&file_table) == FAILURE) {
@@ -761,24 +1630,27 @@ PHPDBG_API void phpdbg_set_breakpoint_file_opline(const char *file, zend_ulong o
 		phpdbg_error("breakpoint", "type=\"exists\" file=\"%s\" num=\"%d\"", "Breakpoint already exists for %s:%ld", new_break.class_name, opline);
 		efree((char*)new_break.class_name);
 		PHPDBG_G(bp_count)--;
-		return;
+		return FAILURE;
 	}
 
-	PHPDBG_BREAK_MAPPING(new_break.id, file_table);
 
 	PHPDBG_G(flags) |= PHPDBG_HAS_FILE_OPLINE_BP;
 
-	zend_hash_index_update(file_table, opline, &new_break, sizeof(phpdbg_breakopline_t), NULL);
+	zend_hash_index_update(file_table, opline, &new_break, sizeof(phpdbg_breakopline_t), (void **) &stored);
+
+	PHPDBG_BREAK_MAPPING(new_break.id, file_table, stored);
+
+	return SUCCESS;
 }
 
-PHPDBG_API void phpdbg_set_breakpoint_opcode(const char *name, size_t name_len TSRMLS_DC) /* {{{ */
+PHPDBG_API int phpdbg_set_breakpoint_opcode(const char *name, size_t name_len TSRMLS_DC) /* {{{ */
 {
-	phpdbg_breakop_t new_break;
+	phpdbg_breakop_t new_break, *stored;
 	zend_ulong hash = zend_hash_func(name, name_len);
 
 	if (zend_hash_index_exists(&PHPDBG_G(bp)[PHPDBG_BREAK_OPCODE], hash)) {
 		phpdbg_error("breakpoint", "type=\"exists\" opcode=\"%s\"", "Breakpoint exists for %s", name);
-		return;
+		return FAILURE;
 	}
 
 	PHPDBG_BREAK_INIT(new_break, PHPDBG_BREAK_OPCODE);
@@ -786,18 +1658,20 @@ PHPDBG_API void phpdbg_set_breakpoint_opcode(const char *name, size_t name_len T
 	new_break.name = estrndup(name, name_len);
 
 	zend_hash_index_update(&PHPDBG_G(bp)[PHPDBG_BREAK_OPCODE], hash,
-		&new_break, sizeof(phpdbg_breakop_t), NULL);
+		&new_break, sizeof(phpdbg_breakop_t), (void **) &stored);
 
 	PHPDBG_G(flags) |= PHPDBG_HAS_OPCODE_BP;
 
 	phpdbg_notice("breakpoint", "id=\"%d\" opcode=\"%s\"", "Breakpoint #%d added at %s", new_break.id, name);
-	PHPDBG_BREAK_MAPPING(new_break.id, &PHPDBG_G(bp)[PHPDBG_BREAK_OPCODE]);
+	PHPDBG_BREAK_MAPPING(new_break.id, &PHPDBG_G(bp)[PHPDBG_BREAK_OPCODE], stored);
+
+	return SUCCESS;
 } /* }}} */
 
-PHPDBG_API void phpdbg_set_breakpoint_opline_ex(phpdbg_opline_ptr_t opline TSRMLS_DC) /* {{{ */
+PHPDBG_API int phpdbg_set_breakpoint_opline_ex(phpdbg_opline_ptr_t opline TSRMLS_DC) /* {{{ */
 {
 	if (!zend_hash_index_exists(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE], (zend_ulong) opline)) {
-		phpdbg_breakline_t new_break;
+		phpdbg_breakline_t new_break, *stored;
 
 		PHPDBG_G(flags) |= PHPDBG_HAS_OPLINE_BP;
 
@@ -805,21 +1679,48 @@ PHPDBG_API void phpdbg_set_breakpoint_opline_ex(phpdbg_opline_ptr_t opline TSRML
 		new_break.opline = (zend_ulong) opline;
 
 		zend_hash_index_update(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE],
-			(zend_ulong) opline, &new_break, sizeof(phpdbg_breakline_t), NULL);
+			(zend_ulong) opline, &new_break, sizeof(phpdbg_breakline_t), (void **) &stored);
 
 		phpdbg_notice("breakpoint", "id=\"%d\" opline=\"%#lx\"", "Breakpoint #%d added at %#lx", new_break.id, new_break.opline);
-		PHPDBG_BREAK_MAPPING(new_break.id, &PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE]);
+		PHPDBG_BREAK_MAPPING(new_break.id, &PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE], stored);
 	} else {
 		phpdbg_error("breakpoint", "type=\"exists\" opline=\"%#lx\"", "Breakpoint exists for opline %#lx", (zend_ulong) opline);
+		return FAILURE;
 	}
+
+	return SUCCESS;
 } /* }}} */
 
-static inline void phpdbg_create_conditional_break(phpdbg_breakcond_t *brake, const phpdbg_param_t *param, const char *expr, size_t expr_len, zend_ulong hash TSRMLS_DC) /* {{{ */
+/* compiles "return <expr>;" as eval()'d code would be */
+static zend_op_array *phpdbg_compile_expression(const char *expr, size_t expr_len, char *name TSRMLS_DC) /* {{{ */
 {
-	phpdbg_breakcond_t new_break;
+	zend_op_array *ops;
 	zend_uint cops = CG(compiler_options);
 	zval pv;
 
+	CG(compiler_options) = ZEND_COMPILE_DEFAULT_FOR_EVAL;
+
+	Z_STRLEN(pv) = expr_len + sizeof("return ;") - 1;
+	Z_STRVAL(pv) = emalloc(Z_STRLEN(pv) + 1);
+	memcpy(Z_STRVAL(pv), "return ", sizeof("return ") - 1);
+	memcpy(Z_STRVAL(pv) + sizeof("return ") - 1, expr, expr_len);
+	Z_STRVAL(pv)[Z_STRLEN(pv) - 1] = ';';
+	Z_STRVAL(pv)[Z_STRLEN(pv)] = '\0';
+	Z_TYPE(pv) = IS_STRING;
+
+	ops = zend_compile_string(&pv, name TSRMLS_CC);
+
+	zval_dtor(&pv);
+
+	CG(compiler_options) = cops;
+
+	return ops;
+} /* }}} */
+
+static inline int phpdbg_create_conditional_break(phpdbg_breakcond_t *brake, const phpdbg_param_t *param, const char *expr, size_t expr_len, zend_ulong hash TSRMLS_DC) /* {{{ */
+{
+	phpdbg_breakcond_t new_break;
+
 	PHPDBG_BREAK_INIT(new_break, PHPDBG_BREAK_COND);
 	new_break.hash = hash;
 
@@ -831,24 +1732,10 @@ static inline void phpdbg_create_conditional_break(phpdbg_breakcond_t *brake, co
 		new_break.paramed = 0;
 	}
 
-	cops = CG(compiler_options);
-
-	CG(compiler_options) = ZEND_COMPILE_DEFAULT_FOR_EVAL;
-
 	new_break.code = estrndup(expr, expr_len);
 	new_break.code_len = expr_len;
 
-	Z_STRLEN(pv) = expr_len + sizeof("return ;") - 1;
-	Z_STRVAL(pv) = emalloc(Z_STRLEN(pv) + 1);
-	memcpy(Z_STRVAL(pv), "return ", sizeof("return ") - 1);
-	memcpy(Z_STRVAL(pv) + sizeof("return ") - 1, expr, expr_len);
-	Z_STRVAL(pv)[Z_STRLEN(pv) - 1] = ';';
-	Z_STRVAL(pv)[Z_STRLEN(pv)] = '\0';
-	Z_TYPE(pv) = IS_STRING;
-
-	new_break.ops = zend_compile_string(&pv, "Conditional Breakpoint Code" TSRMLS_CC);
-
-	zval_dtor(&pv);
+	new_break.ops = phpdbg_compile_expression(expr, expr_len, "Conditional Breakpoint Code" TSRMLS_CC);
 
 	if (new_break.ops) {
 		zend_hash_index_update(
@@ -858,29 +1745,33 @@ static inline void phpdbg_create_conditional_break(phpdbg_breakcond_t *brake, co
 		phpdbg_notice("breakpoint", "id=\"%d\" expression=\"%s\" ptr=\"%p\"", "Conditional breakpoint #%d added %s/%p", brake->id, brake->code, brake->ops);
 
 		PHPDBG_G(flags) |= PHPDBG_HAS_COND_BP;
-		PHPDBG_BREAK_MAPPING(new_break.id, &PHPDBG_G(bp)[PHPDBG_BREAK_COND]);
+		PHPDBG_BREAK_MAPPING(new_break.id, &PHPDBG_G(bp)[PHPDBG_BREAK_COND], brake);
 	} else {
 		 phpdbg_error("compile", "expression=\"%s\"", "Failed to compile code for expression %s", expr);
 		 efree((char*)new_break.code);
 		 PHPDBG_G(bp_count)--;
+		 return FAILURE;
 	}
-	CG(compiler_options) = cops;
+
+	return SUCCESS;
 } /* }}} */
 
-PHPDBG_API void phpdbg_set_breakpoint_expression(const char *expr, size_t expr_len TSRMLS_DC) /* {{{ */
+PHPDBG_API int phpdbg_set_breakpoint_expression(const char *expr, size_t expr_len TSRMLS_DC) /* {{{ */
 {
 	zend_ulong expr_hash = zend_inline_hash_func(expr, expr_len);
 	phpdbg_breakcond_t new_break;
 
 	if (!zend_hash_index_exists(&PHPDBG_G(bp)[PHPDBG_BREAK_COND], expr_hash)) {
-		phpdbg_create_conditional_break(
+		return phpdbg_create_conditional_break(
 			&new_break, NULL, expr, expr_len, expr_hash TSRMLS_CC);
 	} else {
 		phpdbg_error("breakpoint", "type=\"exists\" expression=\"%s\"", "Conditional break %s exists", expr);
 	}
+
+	return FAILURE;
 } /* }}} */
 
-PHPDBG_API void phpdbg_set_breakpoint_at(const phpdbg_param_t *param TSRMLS_DC) /* {{{ */
+PHPDBG_API int phpdbg_set_breakpoint_at(const phpdbg_param_t *param TSRMLS_DC) /* {{{ */
 {
 	phpdbg_breakcond_t new_break;
 	phpdbg_param_t *condition;
@@ -891,18 +1782,19 @@ PHPDBG_API void phpdbg_set_breakpoint_at(const phpdbg_param_t *param TSRMLS_DC)
 		hash = zend_inline_hash_func(condition->str, condition->len);
 
 		if (!zend_hash_index_exists(&PHPDBG_G(bp)[PHPDBG_BREAK_COND], hash)) {
-			phpdbg_create_conditional_break(&new_break, param, condition->str, condition->len, hash TSRMLS_CC);
+			return phpdbg_create_conditional_break(&new_break, param, condition->str, condition->len, hash TSRMLS_CC);
 		} else {
 			phpdbg_notice("breakpoint", "type=\"exists\" arg=\"%s\"", "Conditional break %s exists at the specified location", condition->str);
 		}
 	}
 
+	return FAILURE;
 } /* }}} */
 
 static inline phpdbg_breakbase_t *phpdbg_find_breakpoint_file(zend_op_array *op_array TSRMLS_DC) /* {{{ */
 {
 	HashTable *breaks;
-	phpdbg_breakbase_t *brake;
+	phpdbg_breakbase_t *brake, **matched;
 	size_t path_len;
 	char realpath[MAXPATHLEN];
 	const char *path = op_array->filename;
@@ -917,12 +1809,15 @@ static inline phpdbg_breakbase_t *phpdbg_find_breakpoint_file(zend_op_array *op_
 	phpdbg_debug("Op at: %.*s %d\n", path_len, path, (*EG(opline_ptr))->lineno);
 #endif
 
-	if (zend_hash_find(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE], path, path_len, (void**)&breaks) == FAILURE) {
-		return NULL;
+	if (zend_hash_find(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE], path, path_len, (void**)&breaks) == SUCCESS
+	 && zend_hash_index_find(breaks, (*EG(opline_ptr))->lineno, (void**)&brake) == SUCCESS) {
+		return brake;
 	}
 
-	if (zend_hash_index_find(breaks, (*EG(opline_ptr))->lineno, (void**)&brake) == SUCCESS) {
-		return brake;
+	if ((PHPDBG_G(flags) & PHPDBG_HAS_PATTERN_BP)
+	 && zend_hash_find(&PHPDBG_G(pattern_files), path, path_len, (void**)&breaks) == SUCCESS
+	 && zend_hash_index_find(breaks, (*EG(opline_ptr))->lineno, (void**)&matched) == SUCCESS) {
+		return *matched;
 	}
 
 	return NULL;
@@ -942,22 +1837,73 @@ static inline phpdbg_breakbase_t *phpdbg_find_breakpoint_symbol(zend_function *f
 
 	if (ops->scope) {
 		/* find method breaks here */
-		return phpdbg_find_breakpoint_method(ops TSRMLS_CC);
-	}
+		if ((brake = phpdbg_find_breakpoint_method(ops TSRMLS_CC))) {
+			return brake;
+		}
+	} else {
+		fname = ops->function_name;
 
-	fname = ops->function_name;
+		if (!fname) {
+			fname = "main";
+		}
 
-	if (!fname) {
-		fname = "main";
+		if (zend_hash_find(&PHPDBG_G(bp)[PHPDBG_BREAK_SYM], fname, strlen(fname), (void**)&brake) == SUCCESS) {
+			return brake;
+		}
 	}
 
-	if (zend_hash_find(&PHPDBG_G(bp)[PHPDBG_BREAK_SYM], fname, strlen(fname), (void**)&brake) == SUCCESS) {
-		return brake;
+	if (PHPDBG_G(flags) & PHPDBG_HAS_SYM_PATTERN_BP) {
+		return phpdbg_find_breakpoint_pattern(ops TSRMLS_CC);
 	}
 
 	return NULL;
 } /* }}} */
 
+/* functions and methods are matched against the patterns once, the outcome is kept by their opcodes */
+static phpdbg_breakbase_t *phpdbg_find_breakpoint_pattern(zend_op_array *ops TSRMLS_DC) /* {{{ */
+{
+	HashPosition position;
+	phpdbg_breakpattern_t *brake;
+	phpdbg_pattern_match_t *cached, match;
+	const char *fname;
+	char *lcname, *lcclass;
+
+	if (zend_hash_index_find(&PHPDBG_G(pattern_symbols), (zend_ulong) ops->opcodes, (void **) &cached) == SUCCESS
+	 && cached->function_name == ops->function_name && cached->scope == ops->scope) {
+		return (phpdbg_breakbase_t *) cached->brake;
+	}
+
+	match.function_name = ops->function_name;
+	match.scope = ops->scope;
+	match.brake = NULL;
+
+	fname = ops->function_name ? ops->function_name : "main";
+	lcname = zend_str_tolower_dup(fname, strlen(fname));
+	lcclass = ops->scope ? zend_str_tolower_dup(ops->scope->name, ops->scope->name_length) : NULL;
+
+	for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], &position);
+	     !match.brake && zend_hash_get_current_data_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], (void **) &brake, &position) == SUCCESS;
+	     zend_hash_move_forward_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], &position)) {
+		if (ops->scope) {
+			if (brake->kind == PHPDBG_PATTERN_METHOD
+			 && phpdbg_match_pattern(brake->pattern, ops->scope->name, lcclass, 0 TSRMLS_CC)
+			 && phpdbg_match_pattern(brake->method, fname, lcname, 0 TSRMLS_CC)) {
+				match.brake = brake;
+			}
+		} else if (brake->kind == PHPDBG_PATTERN_FUNCTION && phpdbg_match_pattern(brake->pattern, fname, lcname, 0 TSRMLS_CC)) {
+			match.brake = brake;
+		}
+	}
+
+	zend_hash_index_update(&PHPDBG_G(pattern_symbols), (zend_ulong) ops->opcodes, &match, sizeof(phpdbg_pattern_match_t), NULL);
+	efree(lcname);
+	if (lcclass) {
+		efree(lcclass);
+	}
+
+	return (phpdbg_breakbase_t *) match.brake;
+} /* }}} */
+
 static inline phpdbg_breakbase_t *phpdbg_find_breakpoint_method(zend_op_array *ops TSRMLS_DC) /* {{{ */
 {
 	HashTable *class_table;
@@ -1163,12 +2109,12 @@ PHPDBG_API phpdbg_breakbase_t *phpdbg_find_breakpoint(zend_execute_data* execute
 		goto result;
 	}
 
-	if ((PHPDBG_G(flags) & PHPDBG_HAS_FILE_BP) &&
+	if ((PHPDBG_G(flags) & (PHPDBG_HAS_FILE_BP|PHPDBG_HAS_PATTERN_BP)) &&
 		(base = phpdbg_find_breakpoint_file(execute_data->op_array TSRMLS_CC))) {
 		goto result;
 	}
 
-	if (PHPDBG_G(flags) & (PHPDBG_HAS_METHOD_BP|PHPDBG_HAS_SYM_BP)) {
+	if (PHPDBG_G(flags) & (PHPDBG_HAS_METHOD_BP|PHPDBG_HAS_SYM_BP|PHPDBG_HAS_SYM_PATTERN_BP)) {
 		/* check we are at the beginning of the stack */
 		if (execute_data->opline == EG(active_op_array)->opcodes) {
 			if ((base = phpdbg_find_breakpoint_symbol(
@@ -1225,6 +2171,12 @@ PHPDBG_API void phpdbg_delete_breakpoint(zend_ulong num TSRMLS_DC) /* {{{ */
 				}
 			break;
 
+			case PHPDBG_BREAK_PATTERN:
+				if (zend_hash_num_elements((*table)) == 1) {
+					PHPDBG_G(flags) &= ~PHPDBG_HAS_PATTERN_BP;
+				}
+			break;
+
 			default: {
 				if (zend_hash_num_elements((*table)) == 1) {
 					PHPDBG_G(flags) &= ~(1<<(brake->type+1));
@@ -1235,11 +2187,17 @@ PHPDBG_API void phpdbg_delete_breakpoint(zend_ulong num TSRMLS_DC) /* {{{ */
 		switch (type) {
 			case PHPDBG_BREAK_FILE_OPLINE:
 			case PHPDBG_BREAK_FUNCTION_OPLINE:
-			case PHPDBG_BREAK_METHOD_OPLINE:
-				if (zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE]) == 1) {
-					PHPDBG_G(flags) &= PHPDBG_HAS_OPLINE_BP;
+			case PHPDBG_BREAK_METHOD_OPLINE: {
+				phpdbg_breakline_t *resolved;
+
+				/* the record at the opline may belong to another breakpoint, see phpdbg_resolve_op_array_break() */
+				if (zend_hash_index_find(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE], ((phpdbg_breakopline_t*)brake)->opline, (void **) &resolved) == SUCCESS && resolved->id == num) {
+					if (zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE]) == 1) {
+						PHPDBG_G(flags) &= ~PHPDBG_HAS_OPLINE_BP;
+					}
+					zend_hash_index_del(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE], ((phpdbg_breakopline_t*)brake)->opline);
 				}
-				zend_hash_index_del(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE], ((phpdbg_breakopline_t*)brake)->opline);
+			}
 		}
 
 		switch (zend_hash_get_current_key_ex(
@@ -1261,10 +2219,16 @@ PHPDBG_API void phpdbg_delete_breakpoint(zend_ulong num TSRMLS_DC) /* {{{ */
 					efree(name);
 				}
 			break;
+
+			case PHPDBG_BREAK_PATTERN:
+				phpdbg_rematch_patterns(TSRMLS_C);
+			break;
 		}
 
 		phpdbg_notice("breakpoint", "deleted=\"success\" id=\"%ld\"", "Deleted breakpoint #%ld", num);
 		PHPDBG_BREAK_UNMAPPING(num);
+		zend_hash_index_del(&PHPDBG_G(tracepoints), num);
+		zend_hash_index_del(&PHPDBG_G(breakcmds), num);
 	} else {
 		phpdbg_error("breakpoint", "type=\"nobreakpoint\" deleted=\"fail\" id=\"%ld\"", "Failed to find breakpoint #%ld", num);
 	}
@@ -1274,6 +2238,7 @@ PHPDBG_API void phpdbg_clear_breakpoints(TSRMLS_D) /* {{{ */
 {
 	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE]);
 	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_FILE_PENDING]);
+	zend_hash_clean(&PHPDBG_G(pending_files).children);
 	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_SYM]);
 	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_OPLINE]);
 	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_METHOD_OPLINE]);
@@ -1282,7 +2247,12 @@ PHPDBG_API void phpdbg_clear_breakpoints(TSRMLS_D) /* {{{ */
 	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_OPCODE]);
 	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_METHOD]);
 	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_COND]);
+	zend_hash_clean(&PHPDBG_G(pattern_files));
+	zend_hash_clean(&PHPDBG_G(pattern_symbols));
+	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN]);
 	zend_hash_clean(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP]);
+	zend_hash_clean(&PHPDBG_G(tracepoints));
+	zend_hash_clean(&PHPDBG_G(breakcmds));
 
 	PHPDBG_G(flags) &= ~PHPDBG_BP_MASK;
 
@@ -1298,6 +2268,377 @@ PHPDBG_API void phpdbg_hit_breakpoint(phpdbg_breakbase_t *brake, zend_bool outpu
 	}
 } /* }}} */
 
+void phpdbg_tracepoint_dtor(void *data) /* {{{ */
+{
+	phpdbg_tracepoint_t *trace = (phpdbg_tracepoint_t *) data;
+	int i;
+	TSRMLS_FETCH();
+
+	for (i = 0; i < trace->count; i++) {
+		destroy_op_array(trace->ops[i] TSRMLS_CC);
+		efree(trace->ops[i]);
+		efree(trace->code[i]);
+	}
+
+	if (trace->ops) {
+		efree(trace->ops);
+		efree(trace->code);
+	}
+} /* }}} */
+
+PHPDBG_API void phpdbg_set_tracepoint(zend_ulong id, const phpdbg_param_t *exprs TSRMLS_DC) /* {{{ */
+{
+	phpdbg_tracepoint_t trace;
+	const phpdbg_param_t *expr;
+	int count = 0;
+
+	if (!phpdbg_find_breakbase(id TSRMLS_CC)) {
+		phpdbg_error("breakpoint", "type=\"nobreakpoint\" id=\"%ld\"", "Failed to find breakpoint #%ld", id);
+		return;
+	}
+
+	/* the lexer splits the input at whitespace, every expression arrives as a string parameter of its own */
+	for (expr = exprs; expr; expr = expr->next) {
+		if (expr->type != STR_PARAM) {
+			phpdbg_error("trace", "type=\"invalidexpression\" got=\"%s\"", "Trace expressions can't contain whitespace, colons or #, got %s", phpdbg_get_param_type(expr TSRMLS_CC));
+			return;
+		}
+		count++;
+	}
+
+	trace.count = 0;
+	trace.code = count ? safe_emalloc(count, sizeof(char *), 0) : NULL;
+	trace.ops = count ? safe_emalloc(count, sizeof(zend_op_array *), 0) : NULL;
+
+	for (expr = exprs; expr; expr = expr->next) {
+		if (!(trace.ops[trace.count] = phpdbg_compile_expression(expr->str, expr->len, "Tracepoint Code" TSRMLS_CC))) {
+			phpdbg_error("compile", "expression=\"%s\"", "Failed to compile code for expression %s", expr->str);
+			phpdbg_tracepoint_dtor(&trace);
+			return;
+		}
+		trace.code[trace.count++] = estrndup(expr->str, expr->len);
+	}
+
+	zend_hash_index_update(&PHPDBG_G(tracepoints), id, &trace, sizeof(phpdbg_tracepoint_t), NULL);
+
+	phpdbg_notice("trace", "id=\"%ld\" count=\"%d\"", "Breakpoint #%ld traces %d expressions instead of stopping", id, count);
+} /* }}} */
+
+/* evaluates a compiled expression in the current scope, the way conditional breakpoints are */
+static zval *phpdbg_trace_eval(zend_op_array *ops TSRMLS_DC) /* {{{ */
+{
+	zval *retval = NULL;
+	zval **orig_retval = EG(return_value_ptr_ptr);
+	zend_op_array *orig_ops = EG(active_op_array);
+	zend_op **orig_opline = EG(opline_ptr);
+	zend_bool failed = 0;
+
+	EG(return_value_ptr_ptr) = &retval;
+	EG(active_op_array) = ops;
+	EG(no_extensions) = 1;
+
+	if (!EG(active_symbol_table)) {
+		zend_rebuild_symbol_table(TSRMLS_C);
+	}
+
+	zend_try {
+		PHPDBG_G(flags) |= PHPDBG_IN_COND_BP;
+		zend_execute(ops TSRMLS_CC);
+	} zend_catch {
+		failed = 1;
+	} zend_end_try();
+
+	EG(no_extensions) = 1;
+	EG(return_value_ptr_ptr) = orig_retval;
+	EG(active_op_array) = orig_ops;
+	EG(opline_ptr) = orig_opline;
+	PHPDBG_G(flags) &= ~PHPDBG_IN_COND_BP;
+
+	return failed ? NULL : retval;
+} /* }}} */
+
+/* a short, single line rendering of a traced value */
+static void phpdbg_trace_value(smart_str *buf, zval *value TSRMLS_DC) /* {{{ */
+{
+	switch (Z_TYPE_P(value)) {
+		case IS_NULL:
+			smart_str_appendl(buf, "null", sizeof("null") - 1);
+			break;
+
+		case IS_BOOL:
+			smart_str_appends(buf, Z_LVAL_P(value) ? "true" : "false");
+			break;
+
+		case IS_LONG:
+			smart_str_append_long(buf, Z_LVAL_P(value));
+			break;
+
+		case IS_STRING: {
+			/* a record stays on one line: control characters are escaped, long strings are cut */
+			int len = MIN(Z_STRLEN_P(value), PHPDBG_TRACE_STRLEN), i;
+
+			smart_str_appendc(buf, '"');
+			for (i = 0; i < len; i++) {
+				unsigned char c = Z_STRVAL_P(value)[i];
+
+				switch (c) {
+					case '\n': smart_str_appendl(buf, "\\n", 2); break;
+					case '\r': smart_str_appendl(buf, "\\r", 2); break;
+					case '\t': smart_str_appendl(buf, "\\t", 2); break;
+					case '\\': smart_str_appendl(buf, "\\\\", 2); break;
+					case '"':  smart_str_appendl(buf, "\\\"", 2); break;
+
+					default:
+						if (c < 0x20 || c == 0x7f) {
+							static const char hex[] = "0123456789abcdef";
+
+							smart_str_appendl(buf, "\\x", 2);
+							smart_str_appendc(buf, hex[c >> 4]);
+							smart_str_appendc(buf, hex[c & 0xf]);
+						} else {
+							smart_str_appendc(buf, c);
+						}
+				}
+			}
+			smart_str_appendc(buf, '"');
+
+			if (len < Z_STRLEN_P(value)) {
+				smart_str_appendl(buf, "...", sizeof("...") - 1);
+			}
+		} break;
+
+		case IS_ARRAY:
+			smart_str_appendl(buf, "array(", sizeof("array(") - 1);
+			smart_str_append_long(buf, zend_hash_num_elements(Z_ARRVAL_P(value)));
+			smart_str_appendc(buf, ')');
+			break;
+
+		case IS_OBJECT:
+			smart_str_appendl(buf, "object(", sizeof("object(") - 1);
+			smart_str_appends(buf, Z_OBJCE_P(value)->name);
+			smart_str_appendc(buf, ')');
+			break;
+
+		default: {
+			zval copy = *value;
+
+			zval_copy_ctor(&copy);
+			convert_to_string(&copy);
+			smart_str_appendl(buf, Z_STRVAL(copy), Z_STRLEN(copy));
+			zval_dtor(&copy);
+		}
+	}
+} /* }}} */
+
+PHPDBG_API int phpdbg_trace_breakpoint(phpdbg_breakbase_t *brake TSRMLS_DC) /* {{{ */
+{
+	phpdbg_tracepoint_t *trace;
+	smart_str values = {0};
+	int i;
+
+	if (zend_hash_index_find(&PHPDBG_G(tracepoints), brake->id, (void **) &trace) == FAILURE) {
+		return FAILURE;
+	}
+
+	brake->hits++;
+
+	for (i = 0; i < trace->count; i++) {
+		zval *retval = phpdbg_trace_eval(trace->ops[i] TSRMLS_CC);
+
+		smart_str_appends(&values, i ? ", " : ": ");
+		smart_str_appends(&values, trace->code[i]);
+		smart_str_appendl(&values, " = ", 3);
+		if (retval) {
+			phpdbg_trace_value(&values, retval TSRMLS_CC);
+			zval_ptr_dtor(&retval);
+		} else {
+			smart_str_appendl(&values, "?", 1);
+		}
+	}
+	smart_str_0(&values);
+
+	if (PHPDBG_G(tracelog)) {
+		fprintf(PHPDBG_G(tracelog), "#%d %s:%u hits=%lu%s\n",
+			brake->id,
+			zend_get_executed_filename(TSRMLS_C),
+			zend_get_executed_lineno(TSRMLS_C),
+			brake->hits,
+			values.c ? values.c : "");
+	} else {
+		phpdbg_notice("trace", "id=\"%d\" file=\"%s\" line=\"%u\" hits=\"%lu\" values=\"%s\"", "Trace #%d at %s:%u, hits: %lu%s",
+			brake->id,
+			zend_get_executed_filename(TSRMLS_C),
+			zend_get_executed_lineno(TSRMLS_C),
+			brake->hits,
+			values.c ? values.c : "");
+	}
+
+	smart_str_free(&values);
+
+	return SUCCESS;
+} /* }}} */
+
+PHPDBG_API void phpdbg_print_tracepoints(TSRMLS_D) /* {{{ */
+{
+	HashPosition position;
+	phpdbg_tracepoint_t *trace;
+	zend_ulong id;
+
+	if (!zend_hash_num_elements(&PHPDBG_G(tracepoints))) {
+		return;
+	}
+
+	phpdbg_xml("<tracepoints %r>");
+
+	phpdbg_out(SEPARATE "\n");
+	phpdbg_out("Tracepoints:\n");
+	for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(tracepoints), &position);
+	     zend_hash_get_current_data_ex(&PHPDBG_G(tracepoints), (void **) &trace, &position) == SUCCESS;
+	     zend_hash_move_forward_ex(&PHPDBG_G(tracepoints), &position)) {
+		smart_str exprs = {0};
+		int i;
+
+		zend_hash_get_current_key_ex(&PHPDBG_G(tracepoints), NULL, NULL, &id, 0, &position);
+
+		for (i = 0; i < trace->count; i++) {
+			if (i) {
+				smart_str_appendc(&exprs, ' ');
+			}
+			smart_str_appends(&exprs, trace->code[i]);
+		}
+		smart_str_0(&exprs);
+
+		phpdbg_writeln("tracepoint", "id=\"%lu\" expressions=\"%s\"", "#%lu\t\t%s", id, exprs.c ? exprs.c : "");
+
+		smart_str_free(&exprs);
+	}
+
+	phpdbg_xml("</tracepoints>");
+} /* }}} */
+
+void phpdbg_breakcmds_dtor(void *data) /* {{{ */
+{
+	phpdbg_breakcmds_t *cmds = (phpdbg_breakcmds_t *) data;
+	int i;
+
+	for (i = 0; i < cmds->count; i++) {
+		phpdbg_stack_free(&cmds->stacks[i]);
+		efree(cmds->code[i]);
+	}
+
+	if (cmds->stacks) {
+		efree(cmds->stacks);
+		efree(cmds->code);
+	}
+} /* }}} */
+
+PHPDBG_API void phpdbg_discard_breakcmds(TSRMLS_D) /* {{{ */
+{
+	if (PHPDBG_G(breakcmds_def)) {
+		phpdbg_breakcmds_dtor(PHPDBG_G(breakcmds_def));
+		efree(PHPDBG_G(breakcmds_def));
+		PHPDBG_G(breakcmds_def) = NULL;
+	}
+} /* }}} */
+
+PHPDBG_API void phpdbg_begin_breakcmds(zend_ulong id TSRMLS_DC) /* {{{ */
+{
+	if (!phpdbg_find_breakbase(id TSRMLS_CC)) {
+		phpdbg_error("breakpoint", "type=\"nobreakpoint\" id=\"%ld\"", "Failed to find breakpoint #%ld", id);
+		return;
+	}
+
+	phpdbg_discard_breakcmds(TSRMLS_C);
+
+	PHPDBG_G(breakcmds_def) = ecalloc(1, sizeof(phpdbg_breakcmds_t));
+	PHPDBG_G(breakcmds_def)->id = id;
+
+	phpdbg_notice("commands", "id=\"%ld\"", "Type commands for breakpoint #%ld, one per line, end with a line saying just \"end\"", id);
+} /* }}} */
+
+PHPDBG_API void phpdbg_define_breakcmd(char *input TSRMLS_DC) /* {{{ */
+{
+	phpdbg_breakcmds_t *cmds = PHPDBG_G(breakcmds_def);
+	phpdbg_param_t stack;
+	size_t len = strlen(input);
+
+	while (len && isspace(input[len - 1])) {
+		len--;
+	}
+	while (len && isspace(*input)) {
+		input++;
+		len--;
+	}
+
+	if (!len) {
+		return;
+	}
+
+	if (len == sizeof("end") - 1 && !memcmp(input, "end", len)) {
+		PHPDBG_G(breakcmds_def) = NULL;
+
+		/* an empty list removes the commands of the breakpoint */
+		if (!cmds->count) {
+			zend_hash_index_del(&PHPDBG_G(breakcmds), cmds->id);
+			phpdbg_notice("commands", "id=\"%lu\" count=\"0\"", "Breakpoint #%lu has no commands", cmds->id);
+			efree(cmds);
+			return;
+		}
+
+		/* the breakpoint may have been deleted by now */
+		if (!phpdbg_find_breakbase(cmds->id TSRMLS_CC)) {
+			phpdbg_error("breakpoint", "type=\"nobreakpoint\" id=\"%lu\"", "Failed to find breakpoint #%lu", cmds->id);
+			phpdbg_breakcmds_dtor(cmds);
+			efree(cmds);
+			return;
+		}
+
+		zend_hash_index_update(&PHPDBG_G(breakcmds), cmds->id, cmds, sizeof(phpdbg_breakcmds_t), NULL);
+		phpdbg_notice("commands", "id=\"%lu\" count=\"%d\"", "Breakpoint #%lu runs %d commands when hit", cmds->id, cmds->count);
+		efree(cmds);
+		return;
+	}
+
+	phpdbg_init_param(&stack, STACK_PARAM);
+
+	/* parse errors are reported by the parser, the line is left out of the list */
+	if (phpdbg_do_parse(&stack, input TSRMLS_CC) > 0 || !stack.len) {
+		phpdbg_stack_free(&stack);
+		return;
+	}
+
+	cmds->stacks = erealloc(cmds->stacks, (cmds->count + 1) * sizeof(phpdbg_param_t));
+	cmds->code = erealloc(cmds->code, (cmds->count + 1) * sizeof(char *));
+	cmds->stacks[cmds->count] = stack;
+	cmds->code[cmds->count++] = estrndup(input, len);
+} /* }}} */
+
+PHPDBG_API void phpdbg_print_breakcmds(TSRMLS_D) /* {{{ */
+{
+	HashPosition position;
+	phpdbg_breakcmds_t *cmds;
+
+	if (!zend_hash_num_elements(&PHPDBG_G(breakcmds))) {
+		return;
+	}
+
+	phpdbg_xml("<breakcommands %r>");
+
+	phpdbg_out(SEPARATE "\n");
+	phpdbg_out("Commands:\n");
+	for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(breakcmds), &position);
+	     zend_hash_get_current_data_ex(&PHPDBG_G(breakcmds), (void **) &cmds, &position) == SUCCESS;
+	     zend_hash_move_forward_ex(&PHPDBG_G(breakcmds), &position)) {
+		int i;
+
+		for (i = 0; i < cmds->count; i++) {
+			phpdbg_writeln("breakcommand", "id=\"%lu\" num=\"%d\" command=\"%s\"", "#%lu\t\t%s", cmds->id, i, cmds->code[i]);
+		}
+	}
+
+	phpdbg_xml("</breakcommands>");
+} /* }}} */
+
 PHPDBG_API void phpdbg_print_breakpoint(phpdbg_breakbase_t *brake TSRMLS_DC) /* {{{ */
 {
 	if (!brake)
@@ -1379,6 +2720,17 @@ PHPDBG_API void phpdbg_print_breakpoint(phpdbg_breakbase_t *brake TSRMLS_DC) /*
 				((phpdbg_breakmethod_t*)brake)->hits);
 		} break;
 
+		case PHPDBG_BREAK_PATTERN: {
+			phpdbg_notice("breakpoint", "id=\"%d\" pattern=\"%s%s%s\" file=\"%s\" line=\"%u\" hits=\"%lu\"", "Breakpoint #%d matching %s%s%s at %s:%u, hits: %lu",
+				((phpdbg_breakpattern_t*)brake)->id,
+				((phpdbg_breakpattern_t*)brake)->pattern,
+				((phpdbg_breakpattern_t*)brake)->method ? "::" : "",
+				((phpdbg_breakpattern_t*)brake)->method ? ((phpdbg_breakpattern_t*)brake)->method : "",
+				zend_get_executed_filename(TSRMLS_C),
+				zend_get_executed_lineno(TSRMLS_C),
+				((phpdbg_breakpattern_t*)brake)->hits);
+		} break;
+
 		case PHPDBG_BREAK_COND: {
 			if (((phpdbg_breakcond_t*)brake)->paramed) {
 				char *param;
@@ -1440,22 +2792,29 @@ PHPDBG_API void phpdbg_disable_breakpoints(TSRMLS_D) { /* {{{ */
 
 PHPDBG_API phpdbg_breakbase_t *phpdbg_find_breakbase(zend_ulong id TSRMLS_DC) /* {{{ */
 {
-	HashTable **table;
-	HashPosition position;
+	phpdbg_breakmap_t *map;
 
-	return phpdbg_find_breakbase_ex(id, &table, &position TSRMLS_CC);
+	if (zend_hash_index_find(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], id, (void**) &map) == SUCCESS && map->brake->id == id) {
+		return map->brake;
+	}
+	return NULL;
 } /* }}} */
 
 PHPDBG_API phpdbg_breakbase_t *phpdbg_find_breakbase_ex(zend_ulong id, HashTable ***table, HashPosition *position TSRMLS_DC) /* {{{ */
 {
-	if (zend_hash_index_find(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], id, (void**)table) == SUCCESS) {
+	phpdbg_breakmap_t *map;
+
+	if (zend_hash_index_find(&PHPDBG_G(bp)[PHPDBG_BREAK_MAP], id, (void**) &map) == SUCCESS) {
 		phpdbg_breakbase_t *brake;
 
-		for (zend_hash_internal_pointer_reset_ex((**table), position);
-			zend_hash_get_current_data_ex((**table), (void**)&brake, position) == SUCCESS;
-			zend_hash_move_forward_ex((**table), position)) {
+		*table = &map->table;
 
-			if (brake->id == id) {
+		/* the position is only needed to delete the breakpoint from its table */
+		for (zend_hash_internal_pointer_reset_ex(map->table, position);
+			zend_hash_get_current_data_ex(map->table, (void**)&brake, position) == SUCCESS;
+			zend_hash_move_forward_ex(map->table, position)) {
+
+			if (brake == map->brake && brake->id == id) {
 				return brake;
 			}
 		}
@@ -1769,6 +3128,36 @@ PHPDBG_API void phpdbg_print_breakpoints(zend_ulong type TSRMLS_DC) /* {{{ */
 					((phpdbg_breakbase_t*)brake)->disabled ? " [disabled]" : "");
 			}
 		} break;
+
+		case PHPDBG_BREAK_PATTERN: if (PHPDBG_G(flags) & PHPDBG_HAS_PATTERN_BP) {
+			HashPosition position;
+			phpdbg_breakpattern_t *brake;
+
+			phpdbg_out(SEPARATE "\n");
+			phpdbg_out("Pattern Breakpoints:\n");
+			for (zend_hash_internal_pointer_reset_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], &position);
+			     zend_hash_get_current_data_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], (void**) &brake, &position) == SUCCESS;
+			     zend_hash_move_forward_ex(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN], &position)) {
+				switch (brake->kind) {
+					case PHPDBG_PATTERN_FILE:
+						phpdbg_writeln("patternfile", "id=\"%d\" name=\"%s\" line=\"%ld\" disabled=\"%s\"", "#%d\t\t%s:%ld%s",
+							brake->id, brake->pattern, brake->line,
+							((phpdbg_breakbase_t*)brake)->disabled ? " [disabled]" : "");
+					break;
+
+					case PHPDBG_PATTERN_METHOD:
+						phpdbg_writeln("patternmethod", "id=\"%d\" name=\"%s::%s\" disabled=\"%s\"", "#%d\t\t%s::%s%s",
+							brake->id, brake->pattern, brake->method,
+							((phpdbg_breakbase_t*)brake)->disabled ? " [disabled]" : "");
+					break;
+
+					default:
+						phpdbg_writeln("patternfunction", "id=\"%d\" name=\"%s\" disabled=\"%s\"", "#%d\t\t%s%s",
+							brake->id, brake->pattern,
+							((phpdbg_breakbase_t*)brake)->disabled ? " [disabled]" : "");
+				}
+			}
+		} break;
 	}
 
 	phpdbg_xml("</breakpoints>");
@@ -33,7 +33,13 @@
 #define PHPDBG_BREAK_METHOD_OPLINE   8
 #define PHPDBG_BREAK_FILE_OPLINE     9
 #define PHPDBG_BREAK_MAP             10
-#define PHPDBG_BREAK_TABLES          11 /* }}} */
+#define PHPDBG_BREAK_PATTERN         11
+#define PHPDBG_BREAK_TABLES          12 /* }}} */
+
+/* {{{ what a pattern breakpoint matches */
+#define PHPDBG_PATTERN_FILE          0
+#define PHPDBG_PATTERN_FUNCTION      1
+#define PHPDBG_PATTERN_METHOD        2 /* }}} */
 
 /* {{{ */
 typedef struct _zend_op *phpdbg_opline_ptr_t; /* }}} */
@@ -117,25 +123,73 @@ typedef struct _phpdbg_breakcond_t {
 	zend_op_array  *ops;
 } phpdbg_breakcond_t;
 
+/**
+ * Breakpoint pattern based representation
+ * Globs (or /regular expressions/ for functions and methods) resolved against files as they
+ * are compiled and against functions when first entered, not on every opcode
+ */
+typedef struct _phpdbg_breakpattern_t {
+	phpdbg_breakbase(pattern);
+	zend_uchar  kind;
+	const char *method;
+	long        line;
+} phpdbg_breakpattern_t;
+
+/**
+ * Tracepoint, logging expressions whenever the breakpoint it is attached to is hit, instead of stopping
+ */
+typedef struct _phpdbg_tracepoint_t {
+	int             count;
+	char          **code;
+	zend_op_array **ops;
+} phpdbg_tracepoint_t;
+
+/**
+ * Command list, executed whenever the breakpoint it is attached to is hit, before the prompt
+ */
+typedef struct _phpdbg_breakcmds_t {
+	zend_ulong      id;
+	int             count;
+	char          **code;
+	phpdbg_param_t *stacks;
+} phpdbg_breakcmds_t;
+
+/**
+ * Pending file breakpoints, indexed by their path components from the last one on
+ */
+typedef struct _phpdbg_pending_file_t {
+	HashTable   children;
+	HashTable   paths;    /* pending paths ending at this node, as keys */
+} phpdbg_pending_file_t;
+
 /* {{{ Resolving breaks API */
 PHPDBG_API void phpdbg_resolve_op_array_breaks(zend_op_array *op_array TSRMLS_DC);
 PHPDBG_API int phpdbg_resolve_op_array_break(phpdbg_breakopline_t *brake, zend_op_array *op_array TSRMLS_DC);
 PHPDBG_API int phpdbg_resolve_opline_break(phpdbg_breakopline_t *new_break TSRMLS_DC);
 PHPDBG_API HashTable *phpdbg_resolve_pending_file_break_ex(const char *file, uint filelen, const char *cur, uint curlen, HashTable *fileht TSRMLS_DC);
-PHPDBG_API void phpdbg_resolve_pending_file_break(const char *file TSRMLS_DC); /* }}} */
+PHPDBG_API void phpdbg_resolve_pending_file_break(const char *file TSRMLS_DC);
+PHPDBG_API void phpdbg_resolve_pattern_file_break(const char *file TSRMLS_DC);
+void phpdbg_init_pending_files(TSRMLS_D);
+void phpdbg_destroy_pending_files(TSRMLS_D);
+void phpdbg_init_pattern_matches(TSRMLS_D);
+void phpdbg_destroy_pattern_matches(TSRMLS_D); /* }}} */
 
 /* {{{ Breakpoint Creation API */
-PHPDBG_API void phpdbg_set_breakpoint_file(const char* filename, long lineno TSRMLS_DC);
-PHPDBG_API void phpdbg_set_breakpoint_symbol(const char* func_name, size_t func_name_len TSRMLS_DC);
-PHPDBG_API void phpdbg_set_breakpoint_method(const char* class_name, const char* func_name TSRMLS_DC);
-PHPDBG_API void phpdbg_set_breakpoint_opcode(const char* opname, size_t opname_len TSRMLS_DC);
-PHPDBG_API void phpdbg_set_breakpoint_opline(zend_ulong opline TSRMLS_DC);
-PHPDBG_API void phpdbg_set_breakpoint_opline_ex(phpdbg_opline_ptr_t opline TSRMLS_DC);
-PHPDBG_API void phpdbg_set_breakpoint_method_opline(const char *class, const char *method, zend_ulong opline TSRMLS_DC);
-PHPDBG_API void phpdbg_set_breakpoint_function_opline(const char *function, zend_ulong opline TSRMLS_DC);
-PHPDBG_API void phpdbg_set_breakpoint_file_opline(const char *file, zend_ulong opline TSRMLS_DC);
-PHPDBG_API void phpdbg_set_breakpoint_expression(const char* expression, size_t expression_len TSRMLS_DC);
-PHPDBG_API void phpdbg_set_breakpoint_at(const phpdbg_param_t *param TSRMLS_DC); /* }}} */
+PHPDBG_API int phpdbg_set_breakpoint_file(const char* filename, long lineno TSRMLS_DC);
+PHPDBG_API int phpdbg_set_breakpoint_symbol(const char* func_name, size_t func_name_len TSRMLS_DC);
+PHPDBG_API int phpdbg_set_breakpoint_method(const char* class_name, const char* func_name TSRMLS_DC);
+PHPDBG_API int phpdbg_set_breakpoint_opcode(const char* opname, size_t opname_len TSRMLS_DC);
+PHPDBG_API int phpdbg_set_breakpoint_opline(zend_ulong opline TSRMLS_DC);
+PHPDBG_API int phpdbg_set_breakpoint_opline_ex(phpdbg_opline_ptr_t opline TSRMLS_DC);
+PHPDBG_API int phpdbg_set_breakpoint_method_opline(const char *class, const char *method, zend_ulong opline TSRMLS_DC);
+PHPDBG_API int phpdbg_set_breakpoint_function_opline(const char *function, zend_ulong opline TSRMLS_DC);
+PHPDBG_API int phpdbg_set_breakpoint_file_opline(const char *file, zend_ulong opline TSRMLS_DC);
+PHPDBG_API int phpdbg_set_breakpoint_expression(const char* expression, size_t expression_len TSRMLS_DC);
+PHPDBG_API int phpdbg_set_breakpoint_at(const phpdbg_param_t *param TSRMLS_DC);
+PHPDBG_API int phpdbg_set_breakpoint_file_pattern(const char *pattern, long lineno TSRMLS_DC);
+PHPDBG_API int phpdbg_set_breakpoint_symbol_pattern(const char *pattern, size_t pattern_len TSRMLS_DC);
+PHPDBG_API int phpdbg_set_breakpoint_method_pattern(const char *class_pattern, const char *func_pattern TSRMLS_DC);
+PHPDBG_API zend_bool phpdbg_is_breakpoint_pattern(const char *str, size_t len); /* }}} */
 
 /* {{{ Breakpoint Detection API */
 PHPDBG_API phpdbg_breakbase_t* phpdbg_find_breakpoint(zend_execute_data* TSRMLS_DC); /* }}} */
@@ -152,6 +206,27 @@ PHPDBG_API void phpdbg_enable_breakpoint(zend_ulong id TSRMLS_DC);
 PHPDBG_API void phpdbg_disable_breakpoint(zend_ulong id TSRMLS_DC);
 PHPDBG_API void phpdbg_disable_breakpoints(TSRMLS_D); /* }}} */
 
+/* {{{ Tracepoint API
+ * Tracepoints are keyed by the id of their breakpoint, in PHPDBG_G(tracepoints); the expressions
+ * are compiled once when the tracepoint is set. Records go to PHPDBG_G(tracelog) when set, a block
+ * buffered file, and to the (buffered) console otherwise. */
+#define PHPDBG_TRACE_STRLEN 64 /* bytes of a traced string shown at most */
+
+PHPDBG_API void phpdbg_set_tracepoint(zend_ulong id, const phpdbg_param_t *exprs TSRMLS_DC);
+PHPDBG_API int phpdbg_trace_breakpoint(phpdbg_breakbase_t *brake TSRMLS_DC);
+PHPDBG_API void phpdbg_print_tracepoints(TSRMLS_D);
+void phpdbg_tracepoint_dtor(void *data); /* }}} */
+
+/* {{{ Command list API
+ * Command lists are keyed by the id of their breakpoint, in PHPDBG_G(breakcmds). A list is defined
+ * one command per line, up to a line saying "end", while PHPDBG_G(breakcmds_def) is set; every line
+ * is parsed once, as it is defined, and run from its stack on each hit. */
+PHPDBG_API void phpdbg_begin_breakcmds(zend_ulong id TSRMLS_DC);
+PHPDBG_API void phpdbg_define_breakcmd(char *input TSRMLS_DC);
+PHPDBG_API void phpdbg_discard_breakcmds(TSRMLS_D);
+PHPDBG_API void phpdbg_print_breakcmds(TSRMLS_D);
+void phpdbg_breakcmds_dtor(void *data); /* }}} */
+
 /* {{{ Breakbase API */
 PHPDBG_API phpdbg_breakbase_t *phpdbg_find_breakbase(zend_ulong id TSRMLS_DC);
 PHPDBG_API phpdbg_breakbase_t *phpdbg_find_breakbase_ex(zend_ulong id, HashTable ***table, HashPosition *position TSRMLS_DC); /* }}} */
@@ -160,4 +235,13 @@ PHPDBG_API phpdbg_breakbase_t *phpdbg_find_breakbase_ex(zend_ulong id, HashTable
 PHPDBG_API void phpdbg_export_breakpoints(FILE *handle TSRMLS_DC);
 PHPDBG_API void phpdbg_export_breakpoints_to_string(char **str TSRMLS_DC); /* }}} */
 
+/* {{{ Bulk Breakpoint API
+ * Bulk files hold one breakpoint per line, as tab separated fields led by the kind of breakpoint:
+ *   file <path> <line>, file# <path> <opline>, func <name>, func# <name> <opline>,
+ *   method <class> <name>, method# <class> <name> <opline>, opcode <name>, if <expression>,
+ *   at-file <path> <line> <expression>, at-func <name> <expression>, at-method <class> <name> <expression>
+ * Expressions extend to the end of the line, empty lines and lines starting with # are skipped. */
+PHPDBG_API void phpdbg_export_breakpoints_bulk(FILE *handle TSRMLS_DC);
+PHPDBG_API int phpdbg_import_breakpoints_bulk(const char *path TSRMLS_DC); /* }}} */
+
 #endif /* PHPDBG_BP_H */
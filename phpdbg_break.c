@@ -37,6 +37,10 @@ ZEND_EXTERN_MODULE_GLOBALS(phpdbg);
 const phpdbg_command_t phpdbg_break_commands[] = {
 	PHPDBG_BREAK_COMMAND_D(at,         "specify breakpoint by location and condition",           '@', break_at,      NULL, "*c", 0),
 	PHPDBG_BREAK_COMMAND_D(del,        "delete breakpoint by identifier number",                 '~', break_del,     NULL, "n",  0),
+	PHPDBG_BREAK_COMMAND_D(import,     "add the breakpoints listed in a bulk file",              '<', break_import,  NULL, "s",  0),
+	PHPDBG_BREAK_COMMAND_D(export,     "write all breakpoints to a bulk file",                   '>', break_export,  NULL, "s",  PHPDBG_ASYNC_SAFE),
+	PHPDBG_BREAK_COMMAND_D(trace,      "log expressions at a breakpoint instead of stopping",    '%', break_trace,   NULL, "n",  0),
+	PHPDBG_BREAK_COMMAND_D(commands,   "run a list of commands when a breakpoint is hit",        '!', break_commands, NULL, "n", 0),
 	PHPDBG_END_COMMAND
 };
 
@@ -53,3 +57,38 @@ PHPDBG_BREAK(del) /* {{{ */
 
 	return SUCCESS;
 } /* }}} */
+
+PHPDBG_BREAK(import) /* {{{ */
+{
+	phpdbg_import_breakpoints_bulk(param->str TSRMLS_CC);
+
+	return SUCCESS;
+} /* }}} */
+
+PHPDBG_BREAK(export) /* {{{ */
+{
+	FILE *handle = VCWD_FOPEN(param->str, "w+");
+
+	if (handle) {
+		phpdbg_export_breakpoints_bulk(handle TSRMLS_CC);
+		fclose(handle);
+	} else {
+		phpdbg_error("export", "type=\"openfailure\" file=\"%s\"", "Failed to open or create %s, check path and permissions", param->str);
+	}
+
+	return SUCCESS;
+} /* }}} */
+
+PHPDBG_BREAK(trace) /* {{{ */
+{
+	phpdbg_set_tracepoint(param->num, param->next TSRMLS_CC);
+
+	return SUCCESS;
+} /* }}} */
+
+PHPDBG_BREAK(commands) /* {{{ */
+{
+	phpdbg_begin_breakcmds(param->num TSRMLS_CC);
+
+	return SUCCESS;
+} /* }}} */
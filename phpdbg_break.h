@@ -31,6 +31,10 @@
  */
 PHPDBG_BREAK(at);
 PHPDBG_BREAK(del);
+PHPDBG_BREAK(import);
+PHPDBG_BREAK(export);
+PHPDBG_BREAK(trace);
+PHPDBG_BREAK(commands);
 
 extern const phpdbg_command_t phpdbg_break_commands[];
 
@@ -721,11 +721,26 @@ PHPDBG_API int phpdbg_stack_execute(phpdbg_param_t *stack, zend_bool allow_async
 	return SUCCESS;
 } /* }}} */
 
+/* {{{ whether the command may be answered while the script is running; only async safe
+ * commands which neither resume execution nor depend on the order of the prompt are */
+PHPDBG_API zend_bool phpdbg_stack_pipelinable(phpdbg_param_t *stack TSRMLS_DC) {
+	phpdbg_param_t *top = (phpdbg_param_t *) stack->next;
+	const phpdbg_command_t *handler;
+
+	if (!stack->len || top->type != STR_PARAM) {
+		return 0;
+	}
+
+	handler = phpdbg_stack_resolve(phpdbg_prompt_commands, NULL, &top TSRMLS_CC);
+
+	return handler && (handler->flags & PHPDBG_ASYNC_SAFE) && !(handler->flags & PHPDBG_PROMPT_ONLY);
+} /* }}} */
+
 PHPDBG_API char *phpdbg_read_input(char *buffered TSRMLS_DC) /* {{{ */
 {
-	char buf[PHPDBG_MAX_CMD];
 	char *cmd = NULL;
 	char *buffer = NULL;
+	size_t len;
 
 	if ((PHPDBG_G(flags) & (PHPDBG_IS_STOPPING | PHPDBG_IS_RUNNING)) != PHPDBG_IS_STOPPING) {
 		if ((PHPDBG_G(flags) & PHPDBG_IS_REMOTE) && (buffered == NULL) && !phpdbg_active_sigsafe_mem(TSRMLS_C)) {
@@ -741,10 +756,11 @@ readline:
 #endif
 			{
 				phpdbg_write("prompt", "", "%s", phpdbg_get_prompt(TSRMLS_C));
-				phpdbg_consume_stdin_line(cmd = buf TSRMLS_CC);
+				cmd = phpdbg_consume_stdin_line(&len TSRMLS_CC);
 			}
 #if USE_LIB_STAR
 			else {
+				phpdbg_flush_output(TSRMLS_C);
 				cmd = readline(phpdbg_get_prompt(TSRMLS_C));
 				PHPDBG_G(last_was_newline) = 1;
 			}
@@ -801,13 +817,14 @@ PHPDBG_API void phpdbg_destroy_input(char **input TSRMLS_DC) /*{{{ */
 
 PHPDBG_API int phpdbg_ask_user_permission(const char *question TSRMLS_DC) {
 	if (!(PHPDBG_G(flags) & PHPDBG_WRITE_XML)) {
-		char buf[PHPDBG_MAX_CMD];
+		char *buf;
+		size_t len;
 		phpdbg_out("%s", question);
 		phpdbg_out(" (type y or n): ");
 
 		while (1) {
-			phpdbg_consume_stdin_line(buf TSRMLS_CC);
-			if (buf[1] == '\n' && (buf[0] == 'y' || buf[0] == 'n')) {
+			buf = phpdbg_consume_stdin_line(&len TSRMLS_CC);
+			if (len == 1 && (buf[0] == 'y' || buf[0] == 'n')) {
 				if (buf[0] == 'y') {
 					return SUCCESS;
 				}
@@ -87,6 +87,7 @@ struct _phpdbg_param {
 #endif
 
 #define PHPDBG_ASYNC_SAFE 1
+#define PHPDBG_PROMPT_ONLY 2 /* never answered ahead of the prompt, see phpdbg_serve_pipelined() */
 
 typedef int (*phpdbg_command_handler_t)(const phpdbg_param_t* TSRMLS_DC);
 
@@ -140,6 +141,7 @@ PHPDBG_API void phpdbg_stack_push(phpdbg_param_t *stack, phpdbg_param_t *param);
 PHPDBG_API const phpdbg_command_t *phpdbg_stack_resolve(const phpdbg_command_t *commands, const phpdbg_command_t *parent, phpdbg_param_t **top TSRMLS_DC);
 PHPDBG_API int phpdbg_stack_verify(const phpdbg_command_t *command, phpdbg_param_t **stack TSRMLS_DC);
 PHPDBG_API int phpdbg_stack_execute(phpdbg_param_t *stack, zend_bool allow_async_unsafe TSRMLS_DC);
+PHPDBG_API zend_bool phpdbg_stack_pipelinable(phpdbg_param_t *stack TSRMLS_DC);
 PHPDBG_API void phpdbg_stack_free(phpdbg_param_t *stack);
 
 /*
@@ -0,0 +1,172 @@
+/*
+   +----------------------------------------------------------------------+
+   | PHP Version 5                                                        |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 1997-2014 The PHP Group                                |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+   | Authors: Felipe Pena <felipe@php.net>                                |
+   | Authors: Joe Watkins <joe.watkins@live.co.uk>                        |
+   | Authors: Bob Weinand <bwoebi@php.net>                                |
+   +----------------------------------------------------------------------+
+*/
+
+#include <string.h>
+#include "phpdbg_escape.h"
+
+#if defined(__AVX2__) && defined(__GNUC__)
+#	include <immintrin.h>
+#	define PHPDBG_ESCAPE_AVX2 1
+#endif
+#if defined(__SSE2__) && defined(__GNUC__)
+#	include <emmintrin.h>
+#	define PHPDBG_ESCAPE_SSE2 1
+#endif
+
+static inline int phpdbg_escape_is_special(unsigned char c, int mode) /* {{{ */
+{
+	return ((mode & PHPDBG_ESCAPE_XML) && (c == '&' || c == '<'))
+		|| ((mode & PHPDBG_ESCAPE_QUOT) && c == '"')
+		|| ((mode & PHPDBG_ESCAPE_CTRL) && c < 0x20)
+		|| ((mode & PHPDBG_ESCAPE_EOL) && (c == '\r' || c == '\n'));
+} /* }}} */
+
+/* returns the first byte in [str, end) which needs escaping, or end */
+const char *phpdbg_escape_scan(const char *str, const char *end, int mode) /* {{{ */
+{
+#ifdef PHPDBG_ESCAPE_AVX2
+	if (end - str >= 32) {
+		const __m256i amp = _mm256_set1_epi8('&'), lt = _mm256_set1_epi8('<'), quot = _mm256_set1_epi8('"');
+		const __m256i cr = _mm256_set1_epi8('\r'), lf = _mm256_set1_epi8('\n');
+		const __m256i ctrl = _mm256_set1_epi8(0x1f), zero = _mm256_setzero_si256();
+
+		do {
+			__m256i v = _mm256_loadu_si256((const __m256i *) str), m = zero;
+			unsigned int bits;
+
+			if (mode & PHPDBG_ESCAPE_XML) {
+				m = _mm256_or_si256(m, _mm256_or_si256(_mm256_cmpeq_epi8(v, amp), _mm256_cmpeq_epi8(v, lt)));
+			}
+			if (mode & PHPDBG_ESCAPE_QUOT) {
+				m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, quot));
+			}
+			if (mode & PHPDBG_ESCAPE_CTRL) {
+				/* unsigned v <= 0x1f */
+				m = _mm256_or_si256(m, _mm256_cmpeq_epi8(_mm256_subs_epu8(v, ctrl), zero));
+			}
+			if (mode & PHPDBG_ESCAPE_EOL) {
+				m = _mm256_or_si256(m, _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)));
+			}
+
+			if ((bits = (unsigned int) _mm256_movemask_epi8(m))) {
+				return str + __builtin_ctz(bits);
+			}
+			str += 32;
+		} while (end - str >= 32);
+	}
+#endif
+#ifdef PHPDBG_ESCAPE_SSE2
+	if (end - str >= 16) {
+		const __m128i amp = _mm_set1_epi8('&'), lt = _mm_set1_epi8('<'), quot = _mm_set1_epi8('"');
+		const __m128i cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+		const __m128i ctrl = _mm_set1_epi8(0x1f), zero = _mm_setzero_si128();
+
+		do {
+			__m128i v = _mm_loadu_si128((const __m128i *) str), m = zero;
+			unsigned int bits;
+
+			if (mode & PHPDBG_ESCAPE_XML) {
+				m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, amp), _mm_cmpeq_epi8(v, lt)));
+			}
+			if (mode & PHPDBG_ESCAPE_QUOT) {
+				m = _mm_or_si128(m, _mm_cmpeq_epi8(v, quot));
+			}
+			if (mode & PHPDBG_ESCAPE_CTRL) {
+				m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_subs_epu8(v, ctrl), zero));
+			}
+			if (mode & PHPDBG_ESCAPE_EOL) {
+				m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+			}
+
+			if ((bits = (unsigned int) _mm_movemask_epi8(m))) {
+				return str + __builtin_ctz(bits);
+			}
+			str += 16;
+		} while (end - str >= 16);
+	}
+#endif
+
+	while (str < end && !phpdbg_escape_is_special((unsigned char) *str, mode)) {
+		str++;
+	}
+
+	return str;
+} /* }}} */
+
+/* escapes len bytes of str into out, returns the number of bytes written */
+size_t phpdbg_escape(char *out, const char *str, size_t len, int mode, const char *eol, size_t eol_len) /* {{{ */
+{
+	const char *end = str + len;
+	char *start = out;
+
+	while (str < end) {
+		const char *special = phpdbg_escape_scan(str, end, mode);
+		unsigned char c;
+
+		/* clean runs are copied as a whole */
+		memcpy(out, str, special - str);
+		out += special - str;
+
+		if (special == end) {
+			break;
+		}
+
+		str = special + 1;
+		switch ((c = (unsigned char) *special)) {
+			case '&':
+				memcpy(out, "&amp;", sizeof("&amp;") - 1);
+				out += sizeof("&amp;") - 1;
+				continue;
+
+			case '<':
+				memcpy(out, "&lt;", sizeof("&lt;") - 1);
+				out += sizeof("&lt;") - 1;
+				continue;
+
+			case '"':
+				memcpy(out, "&quot;", sizeof("&quot;") - 1);
+				out += sizeof("&quot;") - 1;
+				continue;
+
+			case '\r':
+			case '\n':
+				if (mode & PHPDBG_ESCAPE_EOL) {
+					if (c == '\r' && str < end && *str == '\n') {
+						str++;
+					}
+					memcpy(out, eol, eol_len);
+					out += eol_len;
+					continue;
+				}
+				/* fallthrough */
+
+			default:
+				*out++ = '&';
+				*out++ = '#';
+				if (c > 9) {
+					*out++ = (c / 10) + '0';
+				}
+				*out++ = (c % 10) + '0';
+				*out++ = ';';
+		}
+	}
+
+	return out - start;
+} /* }}} */
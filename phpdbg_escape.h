@@ -0,0 +1,39 @@
+/*
+   +----------------------------------------------------------------------+
+   | PHP Version 5                                                        |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 1997-2014 The PHP Group                                |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+   | Authors: Felipe Pena <felipe@php.net>                                |
+   | Authors: Joe Watkins <joe.watkins@live.co.uk>                        |
+   | Authors: Bob Weinand <bwoebi@php.net>                                |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef PHPDBG_ESCAPE_H
+#define PHPDBG_ESCAPE_H
+
+#include <stddef.h>
+
+/* this file is deliberately independent of the PHP headers, see tests/bench/escape.c */
+
+#define PHPDBG_ESCAPE_XML  (1<<0) /* & and < as &amp; and &lt; */
+#define PHPDBG_ESCAPE_QUOT (1<<1) /* " as &quot; */
+#define PHPDBG_ESCAPE_CTRL (1<<2) /* bytes below 0x20 as &#N; */
+#define PHPDBG_ESCAPE_EOL  (1<<3) /* \r\n, \r and \n as the given line ending */
+
+/* the output buffer must have room for len * PHPDBG_ESCAPE_MAX_EXPANSION bytes */
+#define PHPDBG_ESCAPE_MAX_EXPANSION 6
+
+const char *phpdbg_escape_scan(const char *str, const char *end, int mode);
+size_t phpdbg_escape(char *out, const char *str, size_t len, int mode, const char *eol, size_t eol_len);
+
+#endif /* PHPDBG_ESCAPE_H */
@@ -387,8 +387,11 @@ phpdbg_help_text_t phpdbg_help_text[] = {
 "  **-E**                          Enable step through eval, careful!" CR
 "  **-S**      **-S**cli               Override SAPI name, careful!" CR
 "  **-l**      **-l**4000              Setup remote console ports" CR
+"  **-l**      **-l**unix:///tmp/dbg   Setup remote console on a UNIX domain socket" CR
 "  **-a**      **-a**192.168.0.3       Setup remote console bind address" CR
+"  **-t**                          Read the remote console in a thread instead of on SIGIO" CR
 "  **-x**                          Enable xml output (instead of normal text output)" CR
+"  **-j**                          Enable json frame output, **-jj** includes the text messages" CR
 "  **-V**                          Print version number" CR
 "  **--**      **--** arg1 arg2        Use to delimit phpdbg arguments and php $argv; append any $argv "
 "argument after it" CR CR
@@ -400,7 +403,15 @@ phpdbg_help_text_t phpdbg_help_text[] = {
 "bind address using the **-a** option. If **-a** is specied without an argument, then phpdbg "
 "will bind to all available interfaces.  You should be aware of the security implications of "
 "doing this, so measures should be taken to secure this service if bound to a publicly accessible "
-"interface/port."
+"interface/port." CR CR
+
+"**-l** also takes a **unix://** path, the socket is then only accessible to its owner. When "
+"started by a service manager with socket activation (**LISTEN_FDS**), phpdbg uses the passed "
+"socket instead and exits once the client disconnects, so it only runs while in use." CR CR
+
+"While a client is connected, further connections to the same port are accepted as observers. "
+"Observers receive everything sent to the controlling client, anything they send is ignored.  "
+"**info io** shows how many observers are connected."
 },
 
 {"phpdbginit", CR
@@ -503,7 +514,11 @@ phpdbg_help_text_t phpdbg_help_text[] = {
 
 "  **Target**   **Alias** **Purpose**" CR
 "  **at**       **A**     specify breakpoint by location and condition" CR
-"  **del**      **d**     delete breakpoint by breakpoint identifier number" CR CR
+"  **del**      **d**     delete breakpoint by breakpoint identifier number" CR
+"  **import**   **<**     add the breakpoints listed in a bulk file" CR
+"  **export**   **>**     write all breakpoints to a bulk file" CR
+"  **trace**    **%**     log expressions at a breakpoint instead of stopping" CR
+"  **commands** **!**     run a list of commands when a breakpoint is hit" CR CR
 
 "**Break at** takes two arguments. The first is any valid target. The second "
 "is a valid PHP expression which will trigger the break in "
@@ -511,6 +526,28 @@ phpdbg_help_text_t phpdbg_help_text[] = {
 
 "Note that breakpoints can also be disabled and re-enabled by the **set break** command." CR CR
 
+"**Break import** and **break export** read and write bulk files: one breakpoint per line, as tab "
+"separated fields led by its kind (**file**, **file#**, **func**, **func#**, **method**, **method#**, "
+"**opcode**, **if**, **at-file**, **at-func** or **at-method**) and by **enabled** or **disabled**, "
+"e.g. \"file<TAB>enabled<TAB>test.php<TAB>100\". An import only reports how many breakpoints were added." CR CR
+"The targets above take precedence over function names: **break i** is **break import**, not a "
+"breakpoint on the function i(). Such a function is given with a leading backslash, as in "
+"**break \\\\i**." CR CR
+"Files, functions and methods may be given as globs (*, ? and [...]); functions and methods "
+"also as /regular expressions/. Such a breakpoint is matched against each file as it is compiled "
+"and each function or method when it is first entered, so it costs no more per opcode than any "
+"other breakpoint. Globs ignore case for functions and methods, a relative file glob matches the "
+"trailing components of a path. A file which exists as written is never taken for a glob. Globs "
+"need fnmatch(), where it is missing they are refused." CR CR
+"**Break trace** turns an existing breakpoint into a tracepoint: instead of stopping, every hit "
+"logs its location, hit count and the values of the given expressions, then execution goes on. "
+"Expressions are separated by spaces and so may not contain any. The log goes to the console "
+"unless **set trace** names a file." CR CR
+"**Break commands** reads the lines following it, up to a line saying just **end**, as commands to run "
+"whenever the breakpoint is hit, before the prompt. Each line is parsed once, when it is read; the output "
+"of the whole list is sent at once. A list ending in **continue** (or **step**, **until**, **finish**, **leave**) resumes "
+"execution without a prompt at all. An empty list removes the commands of a breakpoint." CR CR
+
 "**Examples**" CR CR
 "    $P break test.php:100" CR
 "    $P b test.php:100" CR
@@ -558,11 +595,34 @@ phpdbg_help_text_t phpdbg_help_text[] = {
 "    $P break ZEND_ADD" CR
 "    $P b ZEND_ADD" CR
 "    Break on any occurrence of the opcode ZEND_ADD" CR CR
+"    $P break src/Controller/*.php:10" CR
+"    Break execution at line 10 of every PHP file in a src/Controller directory" CR CR
+
+"    $P break App\\\\Service\\\\*::handle" CR
+"    Break execution on entry to the handle method of any class in App\\\\Service" CR CR
+
+"    $P break /^test_/" CR
+"    Break execution on entry to any function whose name starts with test_" CR CR
 
 "    $P break del 2" CR
 "    $P b ~ 2" CR
 "    Remove breakpoint 2" CR CR
 
+"    $P break import routes.bps" CR
+"    $P b < routes.bps" CR
+"    Add all breakpoints listed in routes.bps" CR CR
+
+"    $P break trace 2 $i $user->name" CR
+"    $P b % 2 $i $user->name" CR
+"    Log $i and $user->name at each hit of breakpoint 2 without stopping" CR CR
+
+"    $P break commands 2" CR
+"    info vars" CR
+"    back" CR
+"    continue" CR
+"    end" CR
+"    Show the variables and a backtrace at each hit of breakpoint 2, then carry on" CR CR
+
 "Note: Conditional breaks are costly in terms of runtime overhead. Use them only when required "
 "as they significantly slow execution." CR CR
 
@@ -663,7 +723,11 @@ phpdbg_help_text_t phpdbg_help_text[] = {
 "  **vars**       **v**      show active variables" CR
 "  **globals**    **g**      show superglobal variables" CR
 "  **literal**    **l**      show active literal constants" CR
-"  **memory**     **m**      show memory manager stats"
+"  **memory**     **m**      show memory manager stats" CR
+"  **io**         **i**      show output statistics" CR CR
+
+"**info io** shows the bytes and write calls spent on output by the previous command and by the "
+"whole session.  Stalls count how often phpdbg had to wait for a slow remote client."
 },
 
 // ******** same issue about breakpoints in called frames
@@ -748,7 +812,11 @@ phpdbg_help_text_t phpdbg_help_text[] = {
 "  **class**   **c**      print out the instructions in the specified class" CR
 "  **method**  **m**      print out the instructions in the specified method" CR
 "  **func**    **f**      print out the instructions in the specified function" CR
-"  **stack**   **s**      print out the instructions in the current stack" CR CR
+"  **stack**   **s**      print out the instructions in the current stack" CR
+"  **children** **h**     print out more children of a variable handle" CR CR
+
+"Large arrays and objects are only printed partially, they are then given a handle. "
+"**print children** takes a handle, an optional offset and an optional count." CR CR
 
 "**Examples**" CR CR
 "    $P print class \\\\my\\\\class" CR
@@ -778,7 +846,11 @@ phpdbg_help_text_t phpdbg_help_text[] = {
 
 "    $P print stack" CR
 "    $P p s" CR
-"    Print the instructions for the current stack"
+"    Print the instructions for the current stack" CR CR
+
+"    $P print children 3 256 100" CR
+"    $P p h 3 256 100" CR
+"    Print the children 256 to 355 of the variable with handle 3"
 },
 
 {"register",
@@ -793,6 +865,23 @@ phpdbg_help_text_t phpdbg_help_text[] = {
 "Note: arguments passed as strings, return (if present) print_r'd on console"
 },
 
+{"replay",
+"Runs the requests captured by the phpdbg webhelper extension into the **phpdbg.capture_file** "
+"ini setting one after another, each with its own environment, and reports how long each took. "
+"An optional range selects requests by their number in the file. Breakpoints and ^C stop as "
+"usual; **replay** without arguments ends the replay after the current request." CR CR
+
+"The webhelper captures every request that matches **phpdbg.capture_uri** (a glob on the "
+"request URI) and **phpdbg.capture_header** (a header name, optionally followed by : and the "
+"required value), and of those only every **phpdbg.capture_sample**th one." CR CR
+
+"**Examples**" CR CR
+"    $P replay /tmp/capture.pwc" CR
+"    Replays all captured requests" CR CR
+"    $P replay /tmp/capture.pwc 10 20" CR
+"    Replays the requests 10 to 20" CR
+},
+
 {"run",
 "Enter the vm, startinging execution. Execution will then continue until the next breakpoint "
 "or completion of the script. Add parameters you want to use as $argv"
@@ -823,7 +912,11 @@ phpdbg_help_text_t phpdbg_help_text[] = {
 "   **breaks**     **B**     set breaks [<on|off>]" CR
 "   **quiet**      **q**     set quiet [<on|off>]" CR
 "   **stepping**   **s**     set stepping [<opcode|line>]" CR
-"   **refcount**   **r**     set refcount [<on|off>] " CR CR
+"   **refcount**   **r**     set refcount [<on|off>] " CR
+"   **depth**      **d**     set depth [<levels>]" CR
+"   **children**   **h**     set children [<count>]" CR
+"   **sources**    **S**     set sources [<kilobytes>]" CR
+"   **trace**      **T**     set trace [<output>|-]" CR CR
 
 "Valid colors are **none**, **white**, **red**, **green**, **yellow**, **blue**, **purple**, "
 "**cyan** and **black**.  All colours except **none** can be followed by an optional "
@@ -831,6 +924,9 @@ phpdbg_help_text_t phpdbg_help_text[] = {
 
 "Color elements can be one of **prompt**, **notice**, or **error**." CR CR
 
+"Files are read again from disk when listed; **sources** limits how much of them is kept in memory "
+"between listings." CR CR
+
 "**Examples**" CR CR
 "     $P S C on" CR
 "     Set colors on" CR CR
@@ -901,6 +997,22 @@ phpdbg_help_text_t phpdbg_help_text[] = {
 "Note **until** will trigger a \"not executing\" error if not executing."
 
 },
+{"wait",
+"Waits for a request captured by the phpdbg webhelper extension on the socket given by the "
+"**phpdbg.path** ini setting and imports its environment, stopping before execution. Passing a "
+"number starts that many workers instead: each one is forked from the current state (breakpoints "
+"and the compiled script included), takes one request, runs it and is replaced by a fresh worker. "
+"A worker takes over the console when it stops, others wait until it is done. Press ^C to stop "
+"the workers." CR CR
+
+"**Examples**" CR CR
+"    $P wait" CR
+"    $P W" CR
+"    Waits up to 60 seconds for a single request" CR CR
+"    $P wait 8" CR
+"    Keeps 8 workers accepting requests until ^C" CR
+},
+
 {"watch",
 "Sets watchpoints on variables as long as they are defined" CR
 "Passing no parameter to **watch**, lists all actually active watchpoints" CR CR
@@ -24,6 +24,7 @@
 #include "phpdbg_info.h"
 #include "phpdbg_bp.h"
 #include "phpdbg_prompt.h"
+#include "phpdbg_io.h"
 
 ZEND_EXTERN_MODULE_GLOBALS(phpdbg);
 
@@ -41,6 +42,7 @@ const phpdbg_command_t phpdbg_info_commands[] = {
 	PHPDBG_INFO_COMMAND_D(globals,   "show superglobals",             'g', info_globals,   NULL, 0, PHPDBG_ASYNC_SAFE),
 	PHPDBG_INFO_COMMAND_D(literal,   "show active literal constants", 'l', info_literal,   NULL, 0, PHPDBG_ASYNC_SAFE),
 	PHPDBG_INFO_COMMAND_D(memory,    "show memory manager stats",     'm', info_memory,    NULL, 0, PHPDBG_ASYNC_SAFE),
+	PHPDBG_INFO_COMMAND_D(io,        "show output statistics",        'i', info_io,        NULL, 0, PHPDBG_ASYNC_SAFE),
 	PHPDBG_END_COMMAND
 };
 
@@ -55,6 +57,9 @@ PHPDBG_INFO(break) /* {{{ */
 	phpdbg_print_breakpoints(PHPDBG_BREAK_METHOD_OPLINE TSRMLS_CC);
 	phpdbg_print_breakpoints(PHPDBG_BREAK_COND TSRMLS_CC);
 	phpdbg_print_breakpoints(PHPDBG_BREAK_OPCODE TSRMLS_CC);
+	phpdbg_print_breakpoints(PHPDBG_BREAK_PATTERN TSRMLS_CC);
+	phpdbg_print_tracepoints(TSRMLS_C);
+	phpdbg_print_breakcmds(TSRMLS_C);
 
 	return SUCCESS;
 } /* }}} */
@@ -378,6 +383,25 @@ PHPDBG_INFO(memory) /* {{{ */
 	return SUCCESS;
 } /* }}} */
 
+PHPDBG_INFO(io) /* {{{ */
+{
+	phpdbg_notice("ioinfo", "", "Output Information");
+	phpdbg_writeln("last", "bytes=\"%lu\" syscalls=\"%lu\" stalls=\"%lu\"", "|-------> Last command:\t%lu bytes in %lu writes, %lu stalls",
+		PHPDBG_G(io_stats)[PHPDBG_IO_STATS_LAST].bytes,
+		PHPDBG_G(io_stats)[PHPDBG_IO_STATS_LAST].syscalls,
+		PHPDBG_G(io_stats)[PHPDBG_IO_STATS_LAST].stalls);
+	phpdbg_writeln("total", "bytes=\"%lu\" syscalls=\"%lu\" stalls=\"%lu\"", "|-------> Session:\t%lu bytes in %lu writes, %lu stalls",
+		PHPDBG_G(io_stats)[PHPDBG_IO_STATS_TOTAL].bytes,
+		PHPDBG_G(io_stats)[PHPDBG_IO_STATS_TOTAL].syscalls,
+		PHPDBG_G(io_stats)[PHPDBG_IO_STATS_TOTAL].stalls);
+	phpdbg_writeln("pending", "bytes=\"%lu\"", "|-------> Pending:\t%lu bytes", (zend_ulong) PHPDBG_G(out_buf).len);
+	if (PHPDBG_G(flags) & PHPDBG_IS_REMOTE) {
+		phpdbg_writeln("observers", "num=\"%d\"", "|-------> Observers:\t%d", PHPDBG_G(observers).num);
+	}
+
+	return SUCCESS;
+} /* }}} */
+
 static inline void phpdbg_print_class_name(zend_class_entry **ce TSRMLS_DC) /* {{{ */
 {
 	phpdbg_writeln("class", "type=\"%s\" flags=\"%s\" name=\"%s\" methodcount=\"%d\"", "%s %s %s (%d)",
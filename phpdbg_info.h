@@ -35,6 +35,7 @@ PHPDBG_INFO(vars);
 PHPDBG_INFO(globals);
 PHPDBG_INFO(literal);
 PHPDBG_INFO(memory);
+PHPDBG_INFO(io);
 
 extern const phpdbg_command_t phpdbg_info_commands[];
 
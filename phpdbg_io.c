@@ -21,6 +21,9 @@
 #endif
 
 #include "phpdbg_io.h"
+#include "phpdbg_observe.h"
+#include "phpdbg_iothread.h"
+#include "phpdbg_wait.h"
 
 #ifdef PHP_WIN32
 #undef UNICODE
@@ -36,6 +39,8 @@
 #include <sys/types.h>
 #endif
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #if HAVE_ARPA_INET_H
 #include <arpa/inet.h>
@@ -47,62 +52,169 @@
 
 ZEND_EXTERN_MODULE_GLOBALS(phpdbg);
 
-/* is easy to generalize ... but not needed for now */
-PHPDBG_API int phpdbg_consume_stdin_line(char *buf TSRMLS_DC) {
-	int bytes = PHPDBG_G(input_buflen), len = 0;
+/* {{{ console input
+ * Input is read in large chunks into PHPDBG_G(input) and handed out line by line
+ * without copying: lines are NUL terminated in place and stay valid until the next
+ * call. Consumed space is reclaimed once the buffer is drained or when there is
+ * no more room to read into, so a client may pipeline any number of commands and
+ * a single line may be longer than PHPDBG_MAX_CMD. */
+#define PHPDBG_INPUT_CHUNK 8192
 
-	if (PHPDBG_G(input_buflen)) {
-		memcpy(buf, PHPDBG_G(input_buffer), bytes);
+/* returns the newline ending the first pending line, if it has arrived yet */
+static inline char *phpdbg_input_newline(TSRMLS_D) {
+	char *nl;
+
+	if (PHPDBG_G(input).scan == PHPDBG_G(input).end) {
+		return NULL;
+	}
+
+	if (!(nl = memchr(PHPDBG_G(input).buf + PHPDBG_G(input).scan, '\n', PHPDBG_G(input).end - PHPDBG_G(input).scan))) {
+		/* everything up to here has been looked at already */
+		PHPDBG_G(input).scan = PHPDBG_G(input).end;
+	}
+
+	return nl;
+}
+
+/* reads whatever is available (tmo as for phpdbg_mixed_read) */
+static int phpdbg_input_fill(int tmo TSRMLS_DC) {
+	int bytes;
+
+	if (PHPDBG_G(input).size - PHPDBG_G(input).end < PHPDBG_MAX_CMD) {
+		if (PHPDBG_G(input).start) {
+			/* only the incomplete line is moved */
+			memmove(PHPDBG_G(input).buf, PHPDBG_G(input).buf + PHPDBG_G(input).start, PHPDBG_G(input).end - PHPDBG_G(input).start);
+			PHPDBG_G(input).end -= PHPDBG_G(input).start;
+			PHPDBG_G(input).scan = PHPDBG_G(input).end;
+			PHPDBG_G(input).start = 0;
+		}
+		if (PHPDBG_G(input).size - PHPDBG_G(input).end < PHPDBG_MAX_CMD) {
+			PHPDBG_G(input).size = PHPDBG_G(input).size ? PHPDBG_G(input).size * 2 : PHPDBG_INPUT_CHUNK;
+			PHPDBG_G(input).buf = perealloc(PHPDBG_G(input).buf, PHPDBG_G(input).size, 1);
+		}
 	}
 
+	bytes = phpdbg_mixed_read(PHPDBG_G(io)[PHPDBG_STDIN].fd, PHPDBG_G(input).buf + PHPDBG_G(input).end, PHPDBG_G(input).size - PHPDBG_G(input).end, tmo TSRMLS_CC);
+
+	if (bytes > 0) {
+		PHPDBG_G(input).end += bytes;
+	}
+
+	return bytes;
+}
+
+PHPDBG_API char *phpdbg_consume_stdin_line(size_t *len TSRMLS_DC) {
+	char *line, *nl;
+
+	PHPDBG_POOL_CONSOLE();
+
+	/* we are going to wait for the user, everything pending must be out now */
+	phpdbg_flush_output(TSRMLS_C);
+
 	PHPDBG_G(last_was_newline) = 1;
+	PHPDBG_G(input).held = 0;
 
-	do {
-		int i;
-		if (bytes <= 0) { 
-			continue;
+	/* the previous line is gone now, start over if nothing else is pending */
+	if (PHPDBG_G(input).start == PHPDBG_G(input).end) {
+		PHPDBG_G(input).start = PHPDBG_G(input).end = PHPDBG_G(input).scan = 0;
+	}
+
+	while (!(nl = phpdbg_input_newline(TSRMLS_C))) {
+		if (phpdbg_input_fill(-1 TSRMLS_CC) <= 0) {
+			PHPDBG_G(flags) |= PHPDBG_IS_QUITTING | PHPDBG_IS_DISCONNECTED;
+			zend_bailout();
+			return NULL;
 		}
+	}
 
-		for (i = len; i < len + bytes; i++) {
-			if (buf[i] == '\x03') {
-				if (i != len + bytes - 1) {
-					memmove(buf + i, buf + i + 1, len + bytes - i - 1);
-				}
-				len--;
-				i--;
-				continue;
-			}
-			if (buf[i] == '\n') {
-				PHPDBG_G(input_buflen) = len + bytes - 1 - i;
-				if (PHPDBG_G(input_buflen)) {
-					memcpy(PHPDBG_G(input_buffer), buf + i + 1, PHPDBG_G(input_buflen));
-				}
-				if (i != PHPDBG_MAX_CMD - 1) {
-					buf[i + 1] = 0;
-				}
-				return i;
+	line = PHPDBG_G(input).buf + PHPDBG_G(input).start;
+	*len = nl - line;
+	PHPDBG_G(input).start = PHPDBG_G(input).scan = PHPDBG_G(input).start + *len + 1;
+
+	if (*len && line[*len - 1] == '\r') {
+		--*len;
+	}
+	line[*len] = 0;
+
+	/* ^C is an interrupt request (see phpdbg_sigio_handler), never part of a command */
+	if (memchr(line, '\x03', *len)) {
+		char *src, *dst;
+
+		for (src = dst = line; src < line + *len; src++) {
+			if (*src != '\x03') {
+				*dst++ = *src;
 			}
 		}
+		*dst = 0;
+		*len = dst - line;
+	}
+
+	return line;
+}
+
+/* puts the line just returned by phpdbg_consume_stdin_line back in front of the input,
+ * it is stored where it was read from, so this never allocates */
+PHPDBG_API void phpdbg_unconsume_stdin_line(char *line, size_t len TSRMLS_DC) {
+	PHPDBG_G(input).start -= len + 1;
+	memmove(PHPDBG_G(input).buf + PHPDBG_G(input).start, line, len);
+	PHPDBG_G(input).buf[PHPDBG_G(input).start + len] = '\n';
+	PHPDBG_G(input).scan = PHPDBG_G(input).start;
+}
+
+/* tells without blocking whether a complete line is pending, reads what has arrived if needed */
+PHPDBG_API zend_bool phpdbg_stdin_line_ready(TSRMLS_D) {
+	if (phpdbg_input_newline(TSRMLS_C)) {
+		return 1;
+	}
+
+	if (phpdbg_iothread_owns(PHPDBG_G(io)[PHPDBG_STDIN].fd TSRMLS_CC)) {
+		if (phpdbg_input_fill(0 TSRMLS_CC) <= 0) {
+			return 0;
+		}
+	} else {
+#ifndef PHP_WIN32
+		struct pollfd pfd;
 
-		len += bytes;
-	} while ((bytes = phpdbg_mixed_read(PHPDBG_G(io)[PHPDBG_STDIN].fd, buf + len, PHPDBG_MAX_CMD - len, -1 TSRMLS_CC)) > 0);
+		pfd.fd = PHPDBG_G(io)[PHPDBG_STDIN].fd;
+		pfd.events = POLLIN;
 
-	if (bytes <= 0) {
-		PHPDBG_G(flags) |= PHPDBG_IS_QUITTING | PHPDBG_IS_DISCONNECTED;
-		zend_bailout();
+		/* once readable, a read does not block; EOF is left to the prompt */
+		if (poll(&pfd, 1, 0) <= 0 || phpdbg_input_fill(-1 TSRMLS_CC) <= 0) {
+			return 0;
+		}
+#else
 		return 0;
+#endif
 	}
 
-	return bytes;
+	return phpdbg_input_newline(TSRMLS_C) != NULL;
+}
+
+/* drops pending input, e.g. when a new client connects */
+PHPDBG_API void phpdbg_clear_input(TSRMLS_D) {
+	PHPDBG_G(input).start = PHPDBG_G(input).end = PHPDBG_G(input).scan = 0;
 }
 
+PHPDBG_API void phpdbg_free_input(TSRMLS_D) {
+	if (PHPDBG_G(input).buf) {
+		pefree(PHPDBG_G(input).buf, 1);
+	}
+	memset(&PHPDBG_G(input), 0, sizeof(PHPDBG_G(input)));
+} /* }}} */
+
 PHPDBG_API int phpdbg_consume_bytes(int sock, char *ptr, int len, int tmo TSRMLS_DC) {
 	int got_now, i = len, j;
 	char *p = ptr;
 #ifndef PHP_WIN32
 	struct pollfd pfd;
 
-	if (tmo < 0) goto recv_once;
+	if (tmo < 0) {
+		/* serve observers while waiting for the controlling client */
+		if ((PHPDBG_G(flags) & PHPDBG_IS_REMOTE) && sock == PHPDBG_G(io)[PHPDBG_STDIN].fd && phpdbg_observe_wait(sock, -1 TSRMLS_CC) < 0) {
+			return -1;
+		}
+		goto recv_once;
+	}
 	pfd.fd = sock;
 	pfd.events = POLLIN;
 
@@ -178,6 +290,10 @@ PHPDBG_API int phpdbg_send_bytes(int sock, const char *ptr, int len) {
 
 
 PHPDBG_API int phpdbg_mixed_read(int sock, char *ptr, int len, int tmo TSRMLS_DC) {
+	if (phpdbg_iothread_owns(sock TSRMLS_CC)) {
+		return phpdbg_iothread_read(ptr, len, tmo TSRMLS_CC);
+	}
+
 	if (PHPDBG_G(flags) & PHPDBG_IS_REMOTE) {
 		return phpdbg_consume_bytes(sock, ptr, len, tmo TSRMLS_CC);
 	}
@@ -195,9 +311,197 @@ PHPDBG_API int phpdbg_mixed_write(int sock, const char *ptr, int len TSRMLS_DC)
 }
 
 
+PHPDBG_API int phpdbg_mixed_writev_ex(int sock, struct iovec *iov, int iovcnt, zend_bool block TSRMLS_DC) {
+	int total = 0;
+#ifdef PHP_WIN32
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		PHPDBG_G(io_stats)[PHPDBG_IO_STATS_TOTAL].syscalls++;
+		if (phpdbg_mixed_write(sock, iov[i].iov_base, iov[i].iov_len TSRMLS_CC) == -1) {
+			return -1;
+		}
+		total += iov[i].iov_len;
+	}
+#else
+	/* only remote sockets are written without blocking, local consoles behave as usual */
+	block = block || !(PHPDBG_G(flags) & PHPDBG_IS_REMOTE);
+
+	while (iovcnt > 0) {
+		ssize_t wrote;
+
+		if (block) {
+			wrote = writev(sock, iov, iovcnt);
+		} else {
+			struct msghdr msg;
+
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = iov;
+			msg.msg_iovlen = iovcnt;
+			wrote = sendmsg(sock, &msg, MSG_DONTWAIT);
+		}
+		PHPDBG_G(io_stats)[PHPDBG_IO_STATS_TOTAL].syscalls++;
+
+		if (wrote == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				struct pollfd pfd;
+
+				if (!block) {
+					break;
+				}
+
+				/* the descriptor may have been made non-blocking by the SIGIO handler */
+				pfd.fd = sock;
+				pfd.events = POLLOUT;
+				poll(&pfd, 1, -1);
+				continue;
+			}
+			return -1;
+		}
+		total += wrote;
+
+		/* partial write: skip what went out and retry with the rest */
+		while (iovcnt > 0 && (size_t) wrote >= iov->iov_len) {
+			wrote -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iov->iov_base = (char *) iov->iov_base + wrote;
+			iov->iov_len -= wrote;
+		}
+	}
+#endif
+
+	PHPDBG_G(io_stats)[PHPDBG_IO_STATS_TOTAL].bytes += total;
+
+	return total;
+}
+
+PHPDBG_API int phpdbg_mixed_writev(int sock, struct iovec *iov, int iovcnt TSRMLS_DC) {
+	return phpdbg_mixed_writev_ex(sock, iov, iovcnt, 1 TSRMLS_CC);
+}
+
+PHPDBG_API void phpdbg_io_stats_mark(TSRMLS_D) {
+	PHPDBG_G(io_stats)[PHPDBG_IO_STATS_LAST].bytes = PHPDBG_G(io_stats)[PHPDBG_IO_STATS_TOTAL].bytes - PHPDBG_G(io_stats)[PHPDBG_IO_STATS_MARK].bytes;
+	PHPDBG_G(io_stats)[PHPDBG_IO_STATS_LAST].syscalls = PHPDBG_G(io_stats)[PHPDBG_IO_STATS_TOTAL].syscalls - PHPDBG_G(io_stats)[PHPDBG_IO_STATS_MARK].syscalls;
+	PHPDBG_G(io_stats)[PHPDBG_IO_STATS_LAST].stalls = PHPDBG_G(io_stats)[PHPDBG_IO_STATS_TOTAL].stalls - PHPDBG_G(io_stats)[PHPDBG_IO_STATS_MARK].stalls;
+
+	PHPDBG_G(io_stats)[PHPDBG_IO_STATS_MARK] = PHPDBG_G(io_stats)[PHPDBG_IO_STATS_TOTAL];
+}
+
+
+#ifndef _WIN32
+static int phpdbg_open_unix_socket(const char *path TSRMLS_DC) {
+	struct sockaddr_un sa;
+	struct stat sb;
+	mode_t mask;
+	int fd, bound;
+
+	if (strlen(path) >= sizeof(sa.sun_path)) {
+		phpdbg_rlog(PHPDBG_G(io)[PHPDBG_STDERR].fd, "Socket path '%s' is too long", path);
+		return -1;
+	}
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+		phpdbg_rlog(PHPDBG_G(io)[PHPDBG_STDERR].fd, "Unable to create socket");
+		return -1;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strcpy(sa.sun_path, path);
+
+	/* a socket file left over by a previous instance would make bind() fail, anything else stays */
+	if (lstat(path, &sb) == 0) {
+		if (!S_ISSOCK(sb.st_mode)) {
+			phpdbg_rlog(PHPDBG_G(io)[PHPDBG_STDERR].fd, "'%s' exists and is not a socket", path);
+			phpdbg_close_socket(fd);
+			return -4;
+		}
+		unlink(path);
+	}
+
+	/* unlike the loopback interface, this can be restricted to the owner, from the start */
+	mask = umask(0077);
+	bound = bind(fd, (struct sockaddr *) &sa, sizeof(sa));
+	umask(mask);
+
+	if (bound == -1) {
+		phpdbg_close_socket(fd);
+		return -4;
+	}
+
+	listen(fd, 5);
+
+	return fd;
+}
+
+/* a listening socket passed by a service manager (LISTEN_FDS/LISTEN_PID), -1 if none */
+PHPDBG_API int phpdbg_inherited_socket(void) {
+	char *pid = getenv("LISTEN_PID"), *fds = getenv("LISTEN_FDS");
+	struct stat sb;
+#ifdef SO_ACCEPTCONN
+	int accepting = 0;
+	socklen_t len = sizeof(accepting);
+#endif
+
+	if (!pid || !fds || atol(pid) != (long) getpid() || atoi(fds) < 1) {
+		return -1;
+	}
+
+	/* not meant for our children */
+	unsetenv("LISTEN_PID");
+	unsetenv("LISTEN_FDS");
+	unsetenv("LISTEN_FDNAMES");
+
+	/* the environment may be stale or forged, only a listening socket will do */
+	if (fstat(PHPDBG_INHERITED_SOCKET, &sb) == -1 || !S_ISSOCK(sb.st_mode)) {
+		phpdbg_rlog(fileno(stderr), "Ignoring inherited descriptor %d, it is not a socket", PHPDBG_INHERITED_SOCKET);
+		return -1;
+	}
+#ifdef SO_ACCEPTCONN
+	if (getsockopt(PHPDBG_INHERITED_SOCKET, SOL_SOCKET, SO_ACCEPTCONN, (char *) &accepting, &len) == -1 || !accepting) {
+		phpdbg_rlog(fileno(stderr), "Ignoring inherited socket %d, it is not listening", PHPDBG_INHERITED_SOCKET);
+		return -1;
+	}
+#endif
+
+	fcntl(PHPDBG_INHERITED_SOCKET, F_SETFD, FD_CLOEXEC);
+
+	return PHPDBG_INHERITED_SOCKET;
+}
+
+/* removes the socket file bound by phpdbg_open_socket() for a unix:// interface */
+PHPDBG_API void phpdbg_remove_unix_socket(const char *interface) {
+	struct stat sb;
+
+	if (strncmp(interface, PHPDBG_UNIX_SOCKET_PREFIX, sizeof(PHPDBG_UNIX_SOCKET_PREFIX) - 1)) {
+		return;
+	}
+
+	interface += sizeof(PHPDBG_UNIX_SOCKET_PREFIX) - 1;
+
+	if (lstat(interface, &sb) == 0 && S_ISSOCK(sb.st_mode)) {
+		unlink(interface);
+	}
+}
+#endif
+
 PHPDBG_API int phpdbg_open_socket(const char *interface, unsigned short port TSRMLS_DC) {
 	struct addrinfo res;
-	int fd = phpdbg_create_listenable_socket(interface, port, &res TSRMLS_CC);
+	int fd;
+
+#ifndef _WIN32
+	if (!strncmp(interface, PHPDBG_UNIX_SOCKET_PREFIX, sizeof(PHPDBG_UNIX_SOCKET_PREFIX) - 1)) {
+		return phpdbg_open_unix_socket(interface + sizeof(PHPDBG_UNIX_SOCKET_PREFIX) - 1 TSRMLS_CC);
+	}
+#endif
+
+	fd = phpdbg_create_listenable_socket(interface, port, &res TSRMLS_CC);
 
 	if (fd == -1) {
 		return -1;
@@ -21,15 +21,46 @@
 
 #include "phpdbg.h"
 
-PHPDBG_API int phpdbg_consume_stdin_line(char *buf TSRMLS_DC);
+#ifdef PHP_WIN32
+struct iovec {
+	void *iov_base;
+	size_t iov_len;
+};
+#else
+#	include <sys/uio.h>
+#endif
+
+PHPDBG_API char *phpdbg_consume_stdin_line(size_t *len TSRMLS_DC);
+PHPDBG_API void phpdbg_unconsume_stdin_line(char *line, size_t len TSRMLS_DC);
+PHPDBG_API zend_bool phpdbg_stdin_line_ready(TSRMLS_D);
+PHPDBG_API void phpdbg_clear_input(TSRMLS_D);
+PHPDBG_API void phpdbg_free_input(TSRMLS_D);
 
 PHPDBG_API int phpdbg_consume_bytes(int sock, char *ptr, int len, int tmo TSRMLS_DC);
 PHPDBG_API int phpdbg_send_bytes(int sock, const char *ptr, int len);
 PHPDBG_API int phpdbg_mixed_read(int sock, char *ptr, int len, int tmo TSRMLS_DC);
 PHPDBG_API int phpdbg_mixed_write(int sock, const char *ptr, int len TSRMLS_DC);
+PHPDBG_API int phpdbg_mixed_writev(int sock, struct iovec *iov, int iovcnt TSRMLS_DC);
+PHPDBG_API int phpdbg_mixed_writev_ex(int sock, struct iovec *iov, int iovcnt, zend_bool block TSRMLS_DC);
+
+/* {{{ output statistics, see info io */
+#define PHPDBG_IO_STATS_TOTAL 0 /* whole session */
+#define PHPDBG_IO_STATS_MARK  1 /* totals when the current command was read */
+#define PHPDBG_IO_STATS_LAST  2 /* previous command */
+
+PHPDBG_API void phpdbg_io_stats_mark(TSRMLS_D); /* }}} */
+
+/* interfaces starting with this are paths of UNIX domain sockets, the port is ignored then */
+#define PHPDBG_UNIX_SOCKET_PREFIX "unix://"
+/* first descriptor passed by socket activation (SD_LISTEN_FDS_START) */
+#define PHPDBG_INHERITED_SOCKET 3
 
 PHPDBG_API int phpdbg_create_listenable_socket(const char *addr, unsigned short port, struct addrinfo *res TSRMLS_DC);
 PHPDBG_API int phpdbg_open_socket(const char *interface, unsigned short port TSRMLS_DC);
+#ifndef _WIN32
+PHPDBG_API int phpdbg_inherited_socket(void);
+PHPDBG_API void phpdbg_remove_unix_socket(const char *interface);
+#endif
 PHPDBG_API void phpdbg_close_socket(int sock);
 
 #endif /* PHPDBG_IO_H */
@@ -0,0 +1,245 @@
+/*
+   +----------------------------------------------------------------------+
+   | PHP Version 5                                                        |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 1997-2014 The PHP Group                                |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,	  |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+   | Authors: Felipe Pena <felipe@php.net>                                |
+   | Authors: Joe Watkins <joe.watkins@live.co.uk>                        |
+   | Authors: Bob Weinand <bwoebi@php.net>                                |
+   +----------------------------------------------------------------------+
+*/
+
+#include "phpdbg.h"
+#include "phpdbg_io.h"
+#include "phpdbg_observe.h"
+#include "phpdbg_iothread.h"
+
+#if !defined(_WIN32) && defined(HAVE_PHPDBG_IOTHREAD)
+#	include <pthread.h>
+#	include <sys/socket.h>
+#	include <unistd.h>
+#	include <fcntl.h>
+#	include <poll.h>
+#endif
+
+ZEND_EXTERN_MODULE_GLOBALS(phpdbg);
+
+#if !defined(_WIN32) && defined(HAVE_PHPDBG_IOTHREAD)
+volatile int phpdbg_iothread_interrupt = 0;
+volatile int phpdbg_iothread_input = 0;
+
+/* single producer (the io thread), single consumer (the executor thread);
+ * head and tail only ever grow, each is written by one side only */
+static struct {
+	char buf[PHPDBG_IOTHREAD_QUEUE];
+	volatile size_t head;
+	volatile size_t tail;
+	volatile int closed;
+	int sock;
+	int wake[2];     /* the io thread writes a byte whenever data or EOF arrived */
+	pthread_t thread;
+	zend_bool running;
+} phpdbg_iothread;
+
+/* a single byte in the pipe wakes the executor; when the pipe is full (EAGAIN) it is awake anyway,
+ * and a one byte write is never short */
+static void phpdbg_iothread_wake(void) {
+	ssize_t sent;
+
+	do {
+		sent = write(phpdbg_iothread.wake[1], "", 1);
+	} while (sent == -1 && errno == EINTR);
+}
+
+static void *phpdbg_iothread_main(void *arg) {
+	for (;;) {
+		size_t head = phpdbg_iothread.head, room, i, j;
+		ssize_t got;
+		char *start;
+
+		__sync_synchronize();
+		room = PHPDBG_IOTHREAD_QUEUE - (head - phpdbg_iothread.tail);
+		/* the consumer is done with the slots up to tail before they are written again */
+		__sync_synchronize();
+		if (!room) {
+			/* the console doesn't keep up with the client, give it a moment */
+			usleep(1000);
+			continue;
+		}
+
+		/* only receive into the contiguous part, the rest on the next round */
+		start = phpdbg_iothread.buf + (head & (PHPDBG_IOTHREAD_QUEUE - 1));
+		if (room > PHPDBG_IOTHREAD_QUEUE - (head & (PHPDBG_IOTHREAD_QUEUE - 1))) {
+			room = PHPDBG_IOTHREAD_QUEUE - (head & (PHPDBG_IOTHREAD_QUEUE - 1));
+		}
+
+		do {
+			got = recv(phpdbg_iothread.sock, start, room, 0);
+		} while (got == -1 && errno == EINTR);
+
+		if (got <= 0) {
+			phpdbg_iothread.closed = 1;
+			__sync_synchronize();
+			phpdbg_iothread_wake();
+			break;
+		}
+
+		/* ^C never reaches the console, it interrupts the executor instead */
+		for (i = j = 0; i < (size_t) got; i++) {
+			if (start[i] == '\x03') {
+				__sync_lock_test_and_set(&phpdbg_iothread_interrupt, 1);
+			} else {
+				start[j++] = start[i];
+			}
+		}
+
+		if (j) {
+			__sync_synchronize();
+			phpdbg_iothread.head = head + j;
+			__sync_lock_test_and_set(&phpdbg_iothread_input, 1);
+			phpdbg_iothread_wake();
+		}
+	}
+
+	return NULL;
+}
+
+static int phpdbg_iothread_wait(int tmo TSRMLS_DC) {
+	char drain[64];
+	int ready;
+
+	if (PHPDBG_G(observers).server >= 0) {
+		ready = phpdbg_observe_wait(phpdbg_iothread.wake[0], tmo TSRMLS_CC);
+	} else {
+		struct pollfd pfd;
+
+		pfd.fd = phpdbg_iothread.wake[0];
+		pfd.events = POLLIN;
+		do {
+			ready = poll(&pfd, 1, tmo);
+		} while (ready == -1 && errno == EINTR);
+	}
+
+	while (read(phpdbg_iothread.wake[0], drain, sizeof(drain)) > 0);
+
+	return ready;
+}
+#endif
+
+PHPDBG_API int phpdbg_iothread_start(int sock TSRMLS_DC) /* {{{ */
+{
+#if !defined(_WIN32) && defined(HAVE_PHPDBG_IOTHREAD)
+	phpdbg_iothread_stop(TSRMLS_C);
+
+	if (pipe(phpdbg_iothread.wake) == -1) {
+		return FAILURE;
+	}
+	fcntl(phpdbg_iothread.wake[0], F_SETFL, O_NONBLOCK);
+	fcntl(phpdbg_iothread.wake[1], F_SETFL, O_NONBLOCK);
+	fcntl(phpdbg_iothread.wake[0], F_SETFD, FD_CLOEXEC);
+	fcntl(phpdbg_iothread.wake[1], F_SETFD, FD_CLOEXEC);
+
+	phpdbg_iothread.sock = sock;
+	phpdbg_iothread.head = phpdbg_iothread.tail = 0;
+	phpdbg_iothread.closed = 0;
+	phpdbg_iothread_interrupt = 0;
+	phpdbg_iothread_input = 0;
+
+	if (pthread_create(&phpdbg_iothread.thread, NULL, phpdbg_iothread_main, NULL) != 0) {
+		close(phpdbg_iothread.wake[0]);
+		close(phpdbg_iothread.wake[1]);
+		return FAILURE;
+	}
+	phpdbg_iothread.running = 1;
+
+	return SUCCESS;
+#else
+	return FAILURE;
+#endif
+} /* }}} */
+
+/* must only be called once the socket is closed (or shut down), that ends the thread */
+PHPDBG_API void phpdbg_iothread_stop(TSRMLS_D) /* {{{ */
+{
+#if !defined(_WIN32) && defined(HAVE_PHPDBG_IOTHREAD)
+	if (!phpdbg_iothread.running) {
+		return;
+	}
+
+	shutdown(phpdbg_iothread.sock, SHUT_RD);
+	pthread_join(phpdbg_iothread.thread, NULL);
+	close(phpdbg_iothread.wake[0]);
+	close(phpdbg_iothread.wake[1]);
+	phpdbg_iothread.running = 0;
+#endif
+} /* }}} */
+
+PHPDBG_API zend_bool phpdbg_iothread_owns(int sock TSRMLS_DC) /* {{{ */
+{
+#if !defined(_WIN32) && defined(HAVE_PHPDBG_IOTHREAD)
+	/* the console reads the socket through stdin, which is a dup2() of it */
+	return phpdbg_iothread.running && sock == PHPDBG_G(io)[PHPDBG_STDIN].fd;
+#else
+	return 0;
+#endif
+} /* }}} */
+
+/* returns what is queued (at most len bytes), 0 on EOF and -1 on timeout, tmo in ms or -1 */
+PHPDBG_API int phpdbg_iothread_read(char *ptr, int len, int tmo TSRMLS_DC) /* {{{ */
+{
+#if !defined(_WIN32) && defined(HAVE_PHPDBG_IOTHREAD)
+	for (;;) {
+		size_t tail = phpdbg_iothread.tail, avail, off, part;
+		int closed = phpdbg_iothread.closed;
+
+		/* head is published after the data, and closed after the last head */
+		__sync_synchronize();
+		avail = phpdbg_iothread.head - tail;
+		/* so the slots up to head are only read after head */
+		__sync_synchronize();
+
+		if (avail) {
+			if (avail > (size_t) len) {
+				avail = len;
+			}
+
+			off = tail & (PHPDBG_IOTHREAD_QUEUE - 1);
+			part = MIN(avail, PHPDBG_IOTHREAD_QUEUE - off);
+			memcpy(ptr, phpdbg_iothread.buf + off, part);
+			memcpy(ptr + part, phpdbg_iothread.buf, avail - part);
+
+			__sync_synchronize();
+			phpdbg_iothread.tail = tail + avail;
+
+			return avail;
+		}
+
+		if (closed) {
+			return 0;
+		}
+
+		if (phpdbg_iothread_wait(tmo TSRMLS_CC) <= 0 && tmo >= 0) {
+			return -1;
+		}
+	}
+#else
+	return -1;
+#endif
+} /* }}} */
+
+/* ^C typed while the console is interactive means nothing */
+PHPDBG_API void phpdbg_iothread_clear_interrupt(TSRMLS_D) /* {{{ */
+{
+#if !defined(_WIN32) && defined(HAVE_PHPDBG_IOTHREAD)
+	phpdbg_iothread_interrupt = 0;
+#endif
+} /* }}} */
@@ -0,0 +1,52 @@
+/*
+   +----------------------------------------------------------------------+
+   | PHP Version 5                                                        |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 1997-2014 The PHP Group                                |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,	  |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+   | Authors: Felipe Pena <felipe@php.net>                                |
+   | Authors: Joe Watkins <joe.watkins@live.co.uk>                        |
+   | Authors: Bob Weinand <bwoebi@php.net>                                |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef PHPDBG_IOTHREAD_H
+#define PHPDBG_IOTHREAD_H
+
+#include "phpdbg.h"
+
+/* {{{ io thread
+ * With -t the remote console is read by a thread of its own instead of
+ * relying on SIGIO. The thread queues everything it receives for the
+ * console and raises an interrupt flag for every ^C, which the executor
+ * checks once per opline, as well as an input flag for anything else. */
+#if !defined(_WIN32) && defined(HAVE_PHPDBG_IOTHREAD)
+#	define PHPDBG_IOTHREAD_QUEUE (1 << 16) /* power of two */
+
+extern volatile int phpdbg_iothread_interrupt;
+extern volatile int phpdbg_iothread_input;
+
+#	define PHPDBG_IOTHREAD_INTERRUPTED() \
+		(phpdbg_iothread_interrupt && __sync_lock_test_and_set(&phpdbg_iothread_interrupt, 0))
+#	define PHPDBG_IOTHREAD_HAS_INPUT() \
+		(phpdbg_iothread_input && __sync_lock_test_and_set(&phpdbg_iothread_input, 0))
+#else
+#	define PHPDBG_IOTHREAD_INTERRUPTED() 0
+#	define PHPDBG_IOTHREAD_HAS_INPUT() 0
+#endif
+
+PHPDBG_API int phpdbg_iothread_start(int sock TSRMLS_DC);
+PHPDBG_API void phpdbg_iothread_stop(TSRMLS_D);
+PHPDBG_API zend_bool phpdbg_iothread_owns(int sock TSRMLS_DC);
+PHPDBG_API int phpdbg_iothread_read(char *ptr, int len, int tmo TSRMLS_DC);
+PHPDBG_API void phpdbg_iothread_clear_interrupt(TSRMLS_D); /* }}} */
+
+#endif /* PHPDBG_IOTHREAD_H */
@@ -128,6 +128,7 @@ void phpdbg_list_file(const char *filename, uint count, int offset, uint highlig
 {
 	uint line, lastline;
 	phpdbg_file_source **data;
+	const char *buf;
 	char resolved_path_buf[MAXPATHLEN];
 
 	if (VCWD_REALPATH(filename, resolved_path_buf)) {
@@ -139,6 +140,10 @@ void phpdbg_list_file(const char *filename, uint count, int offset, uint highlig
 		return;
 	}
 
+	if (!(buf = phpdbg_file_source_buf(*data TSRMLS_CC))) {
+		return;
+	}
+
 	if (offset < 0) {
 		count += offset;
 		offset = 0;
@@ -155,7 +160,7 @@ void phpdbg_list_file(const char *filename, uint count, int offset, uint highlig
 	for (line = offset; line < lastline;) {
 		uint linestart = (*data)->line[line++];
 		uint linelen = (*data)->line[line] - linestart;
-		char *buffer = (*data)->buf + linestart;
+		const char *buffer = buf + linestart;
 
 		if (!highlight) {
 			phpdbg_write("line", "line=\"%u\" code=\"%.*s\"", " %05u: %.*s", line, linelen, buffer);
@@ -230,6 +235,8 @@ void phpdbg_list_function_byname(const char *str, size_t len TSRMLS_DC) /* {{{ *
 	efree(func_name);
 } /* }}} */
 
+static void phpdbg_free_file_buf(phpdbg_file_source *data);
+
 zend_op_array *phpdbg_compile_file(zend_file_handle *file, int type TSRMLS_DC) {
 	phpdbg_file_source data, *dataptr;
 	zend_file_handle fake = {0};
@@ -238,11 +245,17 @@ zend_op_array *phpdbg_compile_file(zend_file_handle *file, int type TSRMLS_DC) {
 	uint line;
 	char *bufptr, *endptr;
 	char resolved_path_buf[MAXPATHLEN];
+	struct stat sb;
 
 	zend_stream_fixup(file, &data.buf, &data.len TSRMLS_CC);
 
 	data.filename = filename;
+	data.path = NULL;
+	data.prev = data.next = NULL;
 	data.line[0] = 0;
+#if HAVE_MMAP
+	data.map = NULL;
+#endif
 
 	if (file->handle.stream.mmap.old_closer) {
 		/* do not unmap */
@@ -263,45 +276,153 @@ zend_op_array *phpdbg_compile_file(zend_file_handle *file, int type TSRMLS_DC) {
 	fake.filename = filename;
 	fake.opened_path = file->opened_path;
 
-	*(dataptr = emalloc(sizeof(phpdbg_file_source) + sizeof(uint) * data.len)) = data;
-	if (VCWD_REALPATH(filename, resolved_path_buf)) {
-		filename = resolved_path_buf;
+	/* count the lines first, the line table is then allocated at its final size */
+	endptr = data.buf + data.len;
+	for (line = 0, bufptr = data.buf; data.len && (bufptr = memchr(bufptr, '\n', endptr - bufptr)); bufptr++) {
+		line++;
 	}
-	zend_hash_add(&PHPDBG_G(file_sources), filename, strlen(filename), &dataptr, sizeof(phpdbg_file_source *), NULL);
 
-	for (line = 0, bufptr = data.buf - 1, endptr = data.buf + data.len; ++bufptr < endptr;) {
-		if (*bufptr == '\n') {
-			dataptr->line[++line] = (uint)(bufptr - data.buf) + 1;
-		}
+	*(dataptr = emalloc(sizeof(phpdbg_file_source) + sizeof(uint) * (line + 1))) = data;
+	for (line = 0, bufptr = data.buf; data.len && (bufptr = memchr(bufptr, '\n', endptr - bufptr));) {
+		dataptr->line[++line] = (uint)(++bufptr - data.buf);
 	}
 	dataptr->lines = ++line;
 	dataptr->line[line] = endptr - data.buf;
-	dataptr = erealloc(dataptr, sizeof(phpdbg_file_source) + sizeof(uint) * line);
+
+	if (VCWD_REALPATH(filename, resolved_path_buf)) {
+		filename = resolved_path_buf;
+
+		/* a plain file which can be read back as is does not need its source kept around */
+		if (VCWD_STAT(filename, &sb) == 0 && S_ISREG(sb.st_mode) && (size_t) sb.st_size == data.len) {
+			dataptr->path = estrdup(filename);
+			dataptr->mtime = sb.st_mtime;
+		}
+	}
+	zend_hash_add(&PHPDBG_G(file_sources), filename, strlen(filename), &dataptr, sizeof(phpdbg_file_source *), NULL);
 
 	phpdbg_resolve_pending_file_break(filename TSRMLS_CC);
+	phpdbg_resolve_pattern_file_break(filename TSRMLS_CC);
 
 	ret = PHPDBG_G(compile_file)(&fake, type TSRMLS_CC);
 
 	fake.opened_path = NULL;
 	zend_file_handle_dtor(&fake TSRMLS_CC);
 
+	if (dataptr->path) {
+		phpdbg_free_file_buf(dataptr);
+	}
+
 	return ret;
 }
 
-void phpdbg_free_file_source(phpdbg_file_source *data) {
+static void phpdbg_free_file_buf(phpdbg_file_source *data) /* {{{ */
+{
 #if HAVE_MMAP
 	if (data->map) {
 		munmap(data->map, data->len + ZEND_MMAP_AHEAD);
+		data->map = NULL;
 	} else
 #endif
 	if (data->buf) {
 		efree(data->buf);
 	}
 
+	data->buf = NULL;
+} /* }}} */
+
+static void phpdbg_unlink_file_source(phpdbg_file_source *data TSRMLS_DC) /* {{{ */
+{
+	if (data->prev) {
+		data->prev->next = data->next;
+	} else {
+		PHPDBG_G(source_cache).head = data->next;
+	}
+	if (data->next) {
+		data->next->prev = data->prev;
+	} else {
+		PHPDBG_G(source_cache).tail = data->prev;
+	}
+
+	data->prev = data->next = NULL;
+} /* }}} */
+
+/* drops the least recently listed sources until the cache fits its budget */
+void phpdbg_trim_source_cache(TSRMLS_D) /* {{{ */
+{
+	while (PHPDBG_G(source_cache).used > PHPDBG_G(source_cache).budget && PHPDBG_G(source_cache).tail) {
+		phpdbg_file_source *evict = PHPDBG_G(source_cache).tail;
+
+		phpdbg_unlink_file_source(evict TSRMLS_CC);
+		PHPDBG_G(source_cache).used -= evict->len;
+		phpdbg_free_file_buf(evict);
+	}
+} /* }}} */
+
+/* returns the source of a compiled file, reading lazy sources back and evicting the least recently listed ones over budget */
+const char *phpdbg_file_source_buf(phpdbg_file_source *data TSRMLS_DC) /* {{{ */
+{
+	php_stream *stream;
+	php_stream_statbuf ssb;
+	char *buf = NULL;
+	size_t len = 0;
+
+	if (!data->path) {
+		return data->buf;
+	}
+
+	if (data->buf) {
+		if (PHPDBG_G(source_cache).head != data) {
+			phpdbg_unlink_file_source(data TSRMLS_CC);
+			goto link;
+		}
+		return data->buf;
+	}
+
+	if ((stream = php_stream_open_wrapper(data->path, "rb", 0, NULL))) {
+		if (php_stream_stat(stream, &ssb) == 0 && (size_t) ssb.sb.st_size == data->len && ssb.sb.st_mtime == data->mtime) {
+			len = php_stream_copy_to_mem(stream, &buf, PHP_STREAM_COPY_ALL, 0);
+		}
+		php_stream_close(stream);
+	}
+
+	if (!buf || len != data->len) {
+		if (buf) {
+			efree(buf);
+		}
+		phpdbg_error("list", "type=\"changed\" file=\"%s\"", "The file %s changed since it was compiled", data->path);
+		return NULL;
+	}
+
+	data->buf = buf;
+	PHPDBG_G(source_cache).used += len;
+
+	/* the file just listed is not linked yet, it is kept even if it exceeds the budget alone */
+	phpdbg_trim_source_cache(TSRMLS_C);
+
+link:
+	if ((data->next = PHPDBG_G(source_cache).head)) {
+		data->next->prev = data;
+	} else {
+		PHPDBG_G(source_cache).tail = data;
+	}
+	PHPDBG_G(source_cache).head = data;
+
+	return data->buf;
+} /* }}} */
+
+void phpdbg_free_file_source(phpdbg_file_source *data) {
+	phpdbg_free_file_buf(data);
+
+	if (data->path) {
+		efree(data->path);
+	}
+
 	efree(data);
 }
 
 void phpdbg_init_list(TSRMLS_D) {
+	PHPDBG_G(source_cache).used = 0;
+	PHPDBG_G(source_cache).head = PHPDBG_G(source_cache).tail = NULL;
 	PHPDBG_G(compile_file) = zend_compile_file;
 	zend_hash_init(&PHPDBG_G(file_sources), 1, NULL, (dtor_func_t) phpdbg_free_file_source, 0);
 	zend_compile_file = phpdbg_compile_file;
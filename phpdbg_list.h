@@ -40,15 +40,25 @@ extern const phpdbg_command_t phpdbg_list_commands[];
 
 void phpdbg_init_list(TSRMLS_D);
 
-typedef struct {
+/* {{{ compiled sources
+ * A file still found on disk as it was compiled does not keep its buffer (path is set):
+ * it is read again when listed and then kept in an LRU, under PHPDBG_G(source_cache).budget.
+ * Everything else (stream wrappers, changed files) keeps the compiled buffer. */
+typedef struct _phpdbg_file_source {
 	char *filename;
 	char *buf;
 	size_t len;
 #if HAVE_MMAP
 	void *map;
 #endif
+	char *path;                              /* resolved path of a lazily loaded source, else NULL */
+	time_t mtime;                            /* modification time the source was compiled at */
+	struct _phpdbg_file_source *prev, *next; /* LRU of loaded lazy sources */
 	uint lines;
 	uint line[1];
-} phpdbg_file_source;
+} phpdbg_file_source; /* }}} */
+
+const char *phpdbg_file_source_buf(phpdbg_file_source *data TSRMLS_DC);
+void phpdbg_trim_source_cache(TSRMLS_D);
 
 #endif /* PHPDBG_LIST_H */
@@ -0,0 +1,365 @@
+/*
+   +----------------------------------------------------------------------+
+   | PHP Version 5                                                        |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 1997-2014 The PHP Group                                |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,	  |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+   | Authors: Felipe Pena <felipe@php.net>                                |
+   | Authors: Joe Watkins <joe.watkins@live.co.uk>                        |
+   | Authors: Bob Weinand <bwoebi@php.net>                                |
+   +----------------------------------------------------------------------+
+*/
+
+#include "phpdbg.h"
+#include "phpdbg_io.h"
+#include "phpdbg_observe.h"
+
+#ifndef _WIN32
+#	include <sys/socket.h>
+#	include <unistd.h>
+#	include <fcntl.h>
+#	include <poll.h>
+#	ifdef HAVE_SYS_EPOLL_H
+#		include <sys/epoll.h>
+#	endif
+#endif
+
+ZEND_EXTERN_MODULE_GLOBALS(phpdbg);
+
+#ifndef _WIN32
+struct _phpdbg_observer {
+	int fd;
+	char *buf;   /* what the observer couldn't take yet */
+	size_t len;
+};
+
+#ifndef MSG_NOSIGNAL
+#	define MSG_NOSIGNAL 0
+#endif
+
+static void phpdbg_observe_watch(int fd, zend_bool add TSRMLS_DC) {
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event ev;
+
+	if (PHPDBG_G(observers).loop < 0) {
+		return;
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	epoll_ctl(PHPDBG_G(observers).loop, add ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, fd, &ev);
+#endif
+}
+
+static void phpdbg_observe_drop(int i, const char *reason TSRMLS_DC) {
+	struct _phpdbg_observer *observer = &PHPDBG_G(observers).list[i];
+
+	phpdbg_rlog(fileno(stderr), "observer %d %s", observer->fd, reason);
+
+	phpdbg_observe_watch(observer->fd, 0 TSRMLS_CC);
+	phpdbg_close_socket(observer->fd);
+	if (observer->buf) {
+		pefree(observer->buf, 1);
+	}
+
+	*observer = PHPDBG_G(observers).list[--PHPDBG_G(observers).num];
+}
+
+static void phpdbg_observe_accept(TSRMLS_D) {
+	int fd, flags = fcntl(PHPDBG_G(observers).server, F_GETFL, 0);
+
+	/* readiness may be stale, never block in accept() here */
+	fcntl(PHPDBG_G(observers).server, F_SETFL, flags | O_NONBLOCK);
+
+	while ((fd = accept(PHPDBG_G(observers).server, NULL, NULL)) >= 0) {
+		if (PHPDBG_G(observers).num == PHPDBG_OBSERVERS_MAX) {
+			phpdbg_rlog(fileno(stderr), "too many observers, refusing connection");
+			phpdbg_close_socket(fd);
+			continue;
+		}
+
+		if (!PHPDBG_G(observers).list) {
+			PHPDBG_G(observers).list = pemalloc(sizeof(struct _phpdbg_observer) * PHPDBG_OBSERVERS_MAX, 1);
+		}
+
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+		PHPDBG_G(observers).list[PHPDBG_G(observers).num].fd = fd;
+		PHPDBG_G(observers).list[PHPDBG_G(observers).num].buf = NULL;
+		PHPDBG_G(observers).list[PHPDBG_G(observers).num].len = 0;
+		PHPDBG_G(observers).num++;
+
+		phpdbg_observe_watch(fd, 1 TSRMLS_CC);
+
+		phpdbg_rlog(fileno(stderr), "observer %d connected", fd);
+	}
+
+	fcntl(PHPDBG_G(observers).server, F_SETFL, flags);
+}
+
+/* observers can't issue commands, anything they send is thrown away */
+static void phpdbg_observe_discard(int i TSRMLS_DC) {
+	char buf[512];
+	int got;
+
+	while ((got = recv(PHPDBG_G(observers).list[i].fd, buf, sizeof(buf), 0)) > 0);
+
+	if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+		phpdbg_observe_drop(i, "disconnected" TSRMLS_CC);
+	}
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+static int phpdbg_observe_find(int fd TSRMLS_DC) {
+	int i;
+
+	for (i = 0; i < PHPDBG_G(observers).num; i++) {
+		if (PHPDBG_G(observers).list[i].fd == fd) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+#endif
+
+/* makes sure sock is watched as the controlling client, it changes on reconnects */
+static void phpdbg_observe_controller(int sock TSRMLS_DC) {
+	if (PHPDBG_G(observers).controller != sock) {
+		if (PHPDBG_G(observers).controller >= 0) {
+			phpdbg_observe_watch(PHPDBG_G(observers).controller, 0 TSRMLS_CC);
+		}
+		PHPDBG_G(observers).controller = sock;
+		phpdbg_observe_watch(sock, 1 TSRMLS_CC);
+	}
+}
+
+/* one round of the event loop; returns 1 if sock became readable, 0 on timeout, -1 on error */
+static int phpdbg_observe_dispatch(int sock, int tmo TSRMLS_DC) {
+	int ready = 0, n, i;
+#ifdef HAVE_SYS_EPOLL_H
+	struct epoll_event events[16];
+
+	n = epoll_wait(PHPDBG_G(observers).loop, events, sizeof(events) / sizeof(*events), tmo);
+	for (i = 0; i < n; i++) {
+		int fd = events[i].data.fd, observer;
+
+		if (fd == PHPDBG_G(observers).server) {
+			phpdbg_observe_accept(TSRMLS_C);
+		} else if (fd == sock) {
+			ready = 1;
+		} else if ((observer = phpdbg_observe_find(fd TSRMLS_CC)) >= 0) {
+			phpdbg_observe_discard(observer TSRMLS_CC);
+		}
+	}
+#else
+	struct pollfd fds[PHPDBG_OBSERVERS_MAX + 2];
+	int nfds = 0, base;
+
+	fds[nfds].fd = PHPDBG_G(observers).server;
+	fds[nfds++].events = POLLIN;
+	if (sock >= 0) {
+		fds[nfds].fd = sock;
+		fds[nfds++].events = POLLIN;
+	}
+	base = nfds;
+	for (i = 0; i < PHPDBG_G(observers).num; i++) {
+		fds[nfds].fd = PHPDBG_G(observers).list[i].fd;
+		fds[nfds++].events = POLLIN;
+	}
+
+	n = poll(fds, nfds, tmo);
+	if (n > 0) {
+		/* backwards, dropping an observer moves the last one into its slot */
+		for (i = nfds; --i >= base;) {
+			if (fds[i].revents) {
+				phpdbg_observe_discard(i - base TSRMLS_CC);
+			}
+		}
+		if (sock >= 0 && fds[1].revents) {
+			ready = 1;
+		}
+		if (fds[0].revents & POLLIN) {
+			phpdbg_observe_accept(TSRMLS_C);
+		}
+	}
+#endif
+
+	if (n < 0) {
+		return errno == EINTR ? 0 : -1;
+	}
+
+	return ready;
+}
+#endif
+
+PHPDBG_API void phpdbg_observe_init(int server TSRMLS_DC) /* {{{ */
+{
+#ifndef _WIN32
+	PHPDBG_G(observers).server = server;
+	PHPDBG_G(observers).controller = -1;
+#ifdef HAVE_SYS_EPOLL_H
+	PHPDBG_G(observers).loop = epoll_create(PHPDBG_OBSERVERS_MAX + 2);
+	if (PHPDBG_G(observers).loop < 0) {
+		phpdbg_rlog(fileno(stderr), "epoll_create() failed, observers are disabled");
+		PHPDBG_G(observers).server = -1;
+		return;
+	}
+	fcntl(PHPDBG_G(observers).loop, F_SETFD, FD_CLOEXEC);
+#endif
+	phpdbg_observe_watch(server, 1 TSRMLS_CC);
+#endif
+} /* }}} */
+
+/* the controlling client was replaced, its descriptor number may be reused */
+PHPDBG_API void phpdbg_observe_reconnect(TSRMLS_D) /* {{{ */
+{
+#ifndef _WIN32
+	PHPDBG_G(observers).controller = -1;
+#endif
+} /* }}} */
+
+/* accepts new observers and discards their input, never blocks */
+PHPDBG_API void phpdbg_observe_poll(TSRMLS_D) /* {{{ */
+{
+#ifndef _WIN32
+	if (PHPDBG_G(observers).server >= 0) {
+		phpdbg_observe_dispatch(-1, 0 TSRMLS_CC);
+	}
+#endif
+} /* }}} */
+
+/* waits for sock to become readable (tmo in ms, -1 for no limit) while serving observers */
+PHPDBG_API int phpdbg_observe_wait(int sock, int tmo TSRMLS_DC) /* {{{ */
+{
+#ifndef _WIN32
+	int ready;
+
+	if (PHPDBG_G(observers).server < 0) {
+		return 1;
+	}
+
+	phpdbg_observe_controller(sock TSRMLS_CC);
+
+	do {
+		ready = phpdbg_observe_dispatch(sock, tmo TSRMLS_CC);
+	} while (ready == 0 && tmo < 0);
+
+	return ready;
+#else
+	return 1;
+#endif
+} /* }}} */
+
+/* sends the same bytes the controlling client gets to every observer: buf first, then ptr */
+PHPDBG_API void phpdbg_observe_write(const char *buf, size_t buflen, const char *ptr, size_t len TSRMLS_DC) /* {{{ */
+{
+#ifndef _WIN32
+	int i;
+
+	if (!PHPDBG_G(observers).num) {
+		return;
+	}
+
+	for (i = PHPDBG_G(observers).num; --i >= 0;) {
+		struct _phpdbg_observer *observer = &PHPDBG_G(observers).list[i];
+		struct iovec iov[3];
+		struct msghdr msg;
+		size_t total = observer->len + buflen + len, skip;
+		ssize_t sent;
+		int iovcnt = 0, fresh, j;
+
+		if (observer->len) {
+			iov[iovcnt].iov_base = observer->buf;
+			iov[iovcnt++].iov_len = observer->len;
+		}
+		fresh = iovcnt;
+		if (buflen) {
+			iov[iovcnt].iov_base = (char *) buf;
+			iov[iovcnt++].iov_len = buflen;
+		}
+		if (len) {
+			iov[iovcnt].iov_base = (char *) ptr;
+			iov[iovcnt++].iov_len = len;
+		}
+		if (!iovcnt) {
+			continue;
+		}
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = iovcnt;
+
+		do {
+			sent = sendmsg(observer->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+		} while (sent == -1 && errno == EINTR);
+
+		if (sent == -1) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				phpdbg_observe_drop(i, "disconnected" TSRMLS_CC);
+				continue;
+			}
+			sent = 0;
+		}
+
+		if ((size_t) sent == total) {
+			observer->len = 0;
+			continue;
+		}
+
+		if (total - sent > PHPDBG_OBSERVER_BACKLOG) {
+			phpdbg_observe_drop(i, "is too slow, dropped" TSRMLS_CC);
+			continue;
+		}
+
+		/* keep what the observer couldn't take */
+		if (!observer->buf) {
+			observer->buf = pemalloc(PHPDBG_OBSERVER_BACKLOG, 1);
+		}
+		if ((size_t) sent < observer->len) {
+			memmove(observer->buf, observer->buf + sent, observer->len - sent);
+			observer->len -= sent;
+			skip = 0;
+		} else {
+			skip = sent - observer->len;
+			observer->len = 0;
+		}
+		for (j = fresh; j < iovcnt; j++) {
+			if (skip >= iov[j].iov_len) {
+				skip -= iov[j].iov_len;
+				continue;
+			}
+			memcpy(observer->buf + observer->len, (char *) iov[j].iov_base + skip, iov[j].iov_len - skip);
+			observer->len += iov[j].iov_len - skip;
+			skip = 0;
+		}
+	}
+#endif
+} /* }}} */
+
+PHPDBG_API void phpdbg_observe_shutdown(TSRMLS_D) /* {{{ */
+{
+#ifndef _WIN32
+	while (PHPDBG_G(observers).num) {
+		phpdbg_observe_drop(PHPDBG_G(observers).num - 1, "closed" TSRMLS_CC);
+	}
+	if (PHPDBG_G(observers).list) {
+		pefree(PHPDBG_G(observers).list, 1);
+		PHPDBG_G(observers).list = NULL;
+	}
+	if (PHPDBG_G(observers).loop >= 0) {
+		close(PHPDBG_G(observers).loop);
+		PHPDBG_G(observers).loop = -1;
+	}
+	PHPDBG_G(observers).server = -1;
+#endif
+} /* }}} */
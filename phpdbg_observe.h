@@ -0,0 +1,40 @@
+/*
+   +----------------------------------------------------------------------+
+   | PHP Version 5                                                        |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 1997-2014 The PHP Group                                |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,	  |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+   | Authors: Felipe Pena <felipe@php.net>                                |
+   | Authors: Joe Watkins <joe.watkins@live.co.uk>                        |
+   | Authors: Bob Weinand <bwoebi@php.net>                                |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef PHPDBG_OBSERVE_H
+#define PHPDBG_OBSERVE_H
+
+#include "phpdbg.h"
+
+/* {{{ observers
+ * Connections accepted on the listening socket while a remote console is
+ * attached are observers: they receive everything sent to the controlling
+ * client, but whatever they send is discarded. */
+#define PHPDBG_OBSERVERS_MAX 64
+#define PHPDBG_OBSERVER_BACKLOG (1 << 20) /* observers lagging further behind are dropped */
+
+PHPDBG_API void phpdbg_observe_init(int server TSRMLS_DC);
+PHPDBG_API void phpdbg_observe_reconnect(TSRMLS_D);
+PHPDBG_API void phpdbg_observe_poll(TSRMLS_D);
+PHPDBG_API int phpdbg_observe_wait(int sock, int tmo TSRMLS_DC);
+PHPDBG_API void phpdbg_observe_write(const char *buf, size_t buflen, const char *ptr, size_t len TSRMLS_DC);
+PHPDBG_API void phpdbg_observe_shutdown(TSRMLS_D); /* }}} */
+
+#endif /* PHPDBG_OBSERVE_H */
@@ -21,6 +21,7 @@
 #include "phpdbg.h"
 #include "zend_vm_opcodes.h"
 #include "zend_compile.h"
+#include "ext/standard/php_smart_str.h"
 #include "phpdbg_opcode.h"
 #include "phpdbg_utils.h"
 
@@ -40,13 +41,12 @@ static inline zend_uint phpdbg_decode_literal(zend_op_array *ops, zend_literal *
 	return 0;
 } /* }}} */
 
-static inline char *phpdbg_decode_op(zend_op_array *ops, znode_op *op, zend_uint type, HashTable *vars TSRMLS_DC) /* {{{ */
+static inline void phpdbg_decode_op(zend_op_array *ops, znode_op *op, zend_uint type, HashTable *vars, smart_str *buf TSRMLS_DC) /* {{{ */
 {
-	char *decode = NULL;
-
 	switch (type &~ EXT_TYPE_UNUSED) {
 		case IS_CV:
-			asprintf(&decode, "$%s", ops->vars[op->var].name);
+			smart_str_appendc(buf, '$');
+			smart_str_appendl(buf, ops->vars[op->var].name, ops->vars[op->var].name_len);
 		break;
 
 		case IS_VAR:
@@ -61,23 +61,35 @@ static inline char *phpdbg_decode_op(zend_op_array *ops, znode_op *op, zend_uint
 						sizeof(zend_ulong), NULL);
 				} else id = *pid;
 			}
-			asprintf(&decode, "@%lu", id);
+			smart_str_appendc(buf, '@');
+			smart_str_append_unsigned(buf, id);
 		} break;
 
 		case IS_CONST:
-			asprintf(&decode, "C%u", phpdbg_decode_literal(ops, op->literal TSRMLS_CC));
+			smart_str_appendc(buf, 'C');
+			smart_str_append_unsigned(buf, phpdbg_decode_literal(ops, op->literal TSRMLS_CC));
 		break;
 
 		case IS_UNUSED:
-			asprintf(&decode, "<unused>");
+			smart_str_appends(buf, "<unused>");
 		break;
 	}
-	return decode;
 } /* }}} */
 
-char *phpdbg_decode_opline(zend_op_array *ops, zend_op *op, HashTable *vars TSRMLS_DC) /*{{{ */
+/* pads the column which began at *start to its width and begins the next one */
+static inline void phpdbg_decode_column(smart_str *buf, size_t *start) /* {{{ */
+{
+	while (buf->len < *start + PHPDBG_DECODE_OP_WIDTH) {
+		smart_str_appendc(buf, ' ');
+	}
+
+	smart_str_appendc(buf, ' ');
+	*start = buf->len;
+} /* }}} */
+
+void phpdbg_decode_opline(zend_op_array *ops, zend_op *op, HashTable *vars, smart_str *buf TSRMLS_DC) /*{{{ */
 {
-	char *decode[4] = {NULL, NULL, NULL, NULL};
+	size_t start = buf->len;
 
 	switch (op->opcode) {
 	case ZEND_JMP:
@@ -87,12 +99,19 @@ char *phpdbg_decode_opline(zend_op_array *ops, zend_op *op, HashTable *vars TSRM
 #ifdef ZEND_FAST_CALL
 	case ZEND_FAST_CALL:
 #endif
-			asprintf(&decode[1], "J%ld", op->op1.jmp_addr - ops->opcodes);
+			smart_str_appendc(buf, 'J');
+			smart_str_append_long(buf, op->op1.jmp_addr - ops->opcodes);
+			phpdbg_decode_column(buf, &start);
+			phpdbg_decode_column(buf, &start);
 		goto format;
 
 	case ZEND_JMPZNZ:
-			decode[1] = phpdbg_decode_op(ops, &op->op1, op->op1_type, vars TSRMLS_CC);
-			asprintf(&decode[2], "J%u or J%lu", op->op2.opline_num, op->extended_value);
+			phpdbg_decode_op(ops, &op->op1, op->op1_type, vars, buf TSRMLS_CC);
+			phpdbg_decode_column(buf, &start);
+			smart_str_appendc(buf, 'J');
+			smart_str_append_unsigned(buf, op->op2.opline_num);
+			smart_str_appends(buf, " or J");
+			smart_str_append_unsigned(buf, op->extended_value);
 		goto result;
 
 	case ZEND_JMPZ:
@@ -103,38 +122,105 @@ char *phpdbg_decode_opline(zend_op_array *ops, zend_op *op, HashTable *vars TSRM
 #ifdef ZEND_JMP_SET
 	case ZEND_JMP_SET:
 #endif
-		decode[1] = phpdbg_decode_op(ops, &op->op1, op->op1_type, vars TSRMLS_CC);
-		asprintf(&decode[2], "J%ld", op->op2.jmp_addr - ops->opcodes);
+		phpdbg_decode_op(ops, &op->op1, op->op1_type, vars, buf TSRMLS_CC);
+		phpdbg_decode_column(buf, &start);
+		smart_str_appendc(buf, 'J');
+		smart_str_append_long(buf, op->op2.jmp_addr - ops->opcodes);
 	goto result;
 
 	case ZEND_RECV_INIT:
+		phpdbg_decode_column(buf, &start);
 		goto result;
 
 		default: {
-			decode[1] = phpdbg_decode_op(ops, &op->op1, op->op1_type, vars TSRMLS_CC);
-			decode[2] = phpdbg_decode_op(ops, &op->op2, op->op2_type, vars TSRMLS_CC);
+			phpdbg_decode_op(ops, &op->op1, op->op1_type, vars, buf TSRMLS_CC);
+			phpdbg_decode_column(buf, &start);
+			phpdbg_decode_op(ops, &op->op2, op->op2_type, vars, buf TSRMLS_CC);
 result:
-			decode[3] = phpdbg_decode_op(ops, &op->result, op->result_type, vars TSRMLS_CC);
+			phpdbg_decode_column(buf, &start);
+			phpdbg_decode_op(ops, &op->result, op->result_type, vars, buf TSRMLS_CC);
 format:
-			asprintf(&decode[0],
-				"%-20s %-20s %-20s",
-				decode[1] ? decode[1] : "",
-				decode[2] ? decode[2] : "",
-				decode[3] ? decode[3] : "");
+			while (buf->len < start + PHPDBG_DECODE_OP_WIDTH) {
+				smart_str_appendc(buf, ' ');
+			}
 		}
 	}
 
-	if (decode[1])
-		free(decode[1]);
-	if (decode[2])
-		free(decode[2]);
-	if (decode[3])
-		free(decode[3]);
+	smart_str_0(buf);
+} /* }}} */
+
+/* An op_array is decoded at once the first time one of its oplines is shown, so temporaries
+ * are numbered the same however it is looked at. The strings live in a single block kept in
+ * PHPDBG_G(decode_cache), keyed by the opcodes, which closures and inherited methods share
+ * with the op_array they were copied from; the cache is dropped at the end of the request. */
+typedef struct {
+	zend_uint last;
+	zend_compiled_variable *vars;
+	zend_literal *literals;
+	char *strings;
+	zend_uint offset[1];
+} phpdbg_decode_cache;
+
+static void phpdbg_decode_cache_dtor(void *data) /* {{{ */
+{
+	phpdbg_decode_cache *cache = *(phpdbg_decode_cache **) data;
+
+	if (cache->strings) {
+		efree(cache->strings);
+	}
+	efree(cache);
+} /* }}} */
 
-	return decode[0];
+void phpdbg_init_decode_cache(TSRMLS_D) /* {{{ */
+{
+	zend_hash_init(&PHPDBG_G(decode_cache), 8, NULL, phpdbg_decode_cache_dtor, 0);
 } /* }}} */
 
-void phpdbg_print_opline_ex(zend_execute_data *execute_data, HashTable *vars, zend_bool ignore_flags TSRMLS_DC) /* {{{ */
+void phpdbg_destroy_decode_cache(TSRMLS_D) /* {{{ */
+{
+	zend_hash_destroy(&PHPDBG_G(decode_cache));
+} /* }}} */
+
+/* an opline which cannot be cached is decoded into buf, which the caller frees */
+const char *phpdbg_decode_opline_cached(zend_op_array *ops, zend_op *op, smart_str *buf TSRMLS_DC) /* {{{ */
+{
+	phpdbg_decode_cache *cache, **pcache;
+
+	if (op < ops->opcodes || op >= ops->opcodes + ops->last) {
+		phpdbg_decode_opline(ops, op, NULL, buf TSRMLS_CC);
+		return buf->c;
+	}
+
+	/* the opcodes of an op_array freed during the request (eval) may be reused by another one */
+	if (zend_hash_index_find(&PHPDBG_G(decode_cache), (zend_ulong) ops->opcodes, (void **) &pcache) == SUCCESS
+	 && (*pcache)->last == ops->last && (*pcache)->vars == ops->vars && (*pcache)->literals == ops->literals) {
+		cache = *pcache;
+	} else {
+		smart_str strings = {0};
+		HashTable vars;
+		zend_uint i;
+
+		cache = emalloc(sizeof(phpdbg_decode_cache) + sizeof(zend_uint) * ops->last);
+		cache->last = ops->last;
+		cache->vars = ops->vars;
+		cache->literals = ops->literals;
+
+		zend_hash_init(&vars, ops->last, NULL, NULL, 0);
+		for (i = 0; i < ops->last; i++) {
+			cache->offset[i] = strings.len;
+			phpdbg_decode_opline(ops, &ops->opcodes[i], &vars, &strings TSRMLS_CC);
+			smart_str_appendc(&strings, '\0');
+		}
+		zend_hash_destroy(&vars);
+
+		cache->strings = strings.c;
+		zend_hash_index_update(&PHPDBG_G(decode_cache), (zend_ulong) ops->opcodes, &cache, sizeof(phpdbg_decode_cache *), NULL);
+	}
+
+	return cache->strings + cache->offset[op - ops->opcodes];
+} /* }}} */
+
+void phpdbg_print_opline_ex(zend_execute_data *execute_data, zend_bool ignore_flags TSRMLS_DC) /* {{{ */
 {
 	/* force out a line while stepping so the user knows what is happening */
 	if (ignore_flags ||
@@ -143,7 +229,8 @@ void phpdbg_print_opline_ex(zend_execute_data *execute_data, HashTable *vars, ze
 		(PHPDBG_G(oplog)))) {
 
 		zend_op *opline = execute_data->opline;
-		char *decode = phpdbg_decode_opline(execute_data->op_array, opline, vars TSRMLS_CC);
+		smart_str buf = {0};
+		const char *decode = phpdbg_decode_opline_cached(execute_data->op_array, opline, &buf TSRMLS_CC);
 
 		if (ignore_flags || (!(PHPDBG_G(flags) & PHPDBG_IS_QUIET) || (PHPDBG_G(flags) & PHPDBG_IS_STEPPING))) {
 			/* output line info */
@@ -164,15 +251,13 @@ void phpdbg_print_opline_ex(zend_execute_data *execute_data, HashTable *vars, ze
 				execute_data->op_array->filename ? execute_data->op_array->filename : "unknown");
 		}
 
-		if (decode) {
-			free(decode);
-		}
+		smart_str_free(&buf);
 	}
 } /* }}} */
 
 void phpdbg_print_opline(zend_execute_data *execute_data, zend_bool ignore_flags TSRMLS_DC) /* {{{ */
 {
-	phpdbg_print_opline_ex(execute_data, NULL, ignore_flags TSRMLS_CC);
+	phpdbg_print_opline_ex(execute_data, ignore_flags TSRMLS_CC);
 } /* }}} */
 
 const char *phpdbg_decode_opcode(zend_uchar opcode) /* {{{ */
@@ -22,10 +22,17 @@
 #define PHPDBG_OPCODE_H
 
 #include "zend_types.h"
+#include "ext/standard/php_smart_str_public.h"
+
+/* operands of a decoded opline are padded to this width */
+#define PHPDBG_DECODE_OP_WIDTH 20
 
 const char *phpdbg_decode_opcode(zend_uchar);
-char *phpdbg_decode_opline(zend_op_array *ops, zend_op *op, HashTable *vars TSRMLS_DC);
+void phpdbg_decode_opline(zend_op_array *ops, zend_op *op, HashTable *vars, smart_str *buf TSRMLS_DC);
+const char *phpdbg_decode_opline_cached(zend_op_array *ops, zend_op *op, smart_str *buf TSRMLS_DC);
+void phpdbg_init_decode_cache(TSRMLS_D);
+void phpdbg_destroy_decode_cache(TSRMLS_D);
 void phpdbg_print_opline(zend_execute_data *execute_data, zend_bool ignore_flags TSRMLS_DC);
-void phpdbg_print_opline_ex(zend_execute_data *execute_data, HashTable *vars, zend_bool ignore_flags TSRMLS_DC);
+void phpdbg_print_opline_ex(zend_execute_data *execute_data, zend_bool ignore_flags TSRMLS_DC);
 
 #endif /* PHPDBG_OPCODE_H */
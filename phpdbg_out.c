@@ -23,8 +23,11 @@
 #include "spprintf.h"
 #include "phpdbg.h"
 #include "phpdbg_io.h"
+#include "phpdbg_observe.h"
 #include "phpdbg_eol.h"
-#include "ext/standard/html.h"
+#include "phpdbg_escape.h"
+#include "phpdbg_wait.h"
+#include "ext/standard/php_smart_str.h"
 
 #ifdef _WIN32
 #	include "win32/time.h"
@@ -894,67 +897,441 @@ PHPDBG_API int _phpdbg_asprintf(char **buf TSRMLS_DC, const char *format, ...) {
 	return ret;
 }
 
-static int phpdbg_encode_xml(char **buf, char *msg, int msglen, int from, char *to) {
-	int i;
-	int tolen = to ? strlen(to) : 5;
-	char *tmp = *buf = emalloc(msglen * tolen);
-	for (i = 0; i++ < msglen; msg++) {
-		if (*msg == '&') {
-			memcpy(tmp, ZEND_STRL("&amp;"));
-			tmp += sizeof("&amp;") - 1;
-		} else if (*msg == '<') {
-			memcpy(tmp, ZEND_STRL("&lt;"));
-			tmp += sizeof("&lt;") - 1;
-		} else if (((int) *msg) == from) {
-			memcpy(tmp, to, tolen);
-			tmp += tolen;
+/* {{{ output buffer
+ * Everything phpdbg prints is escaped straight into one growable buffer and
+ * only handed to the kernel when phpdbg is about to wait for input, when
+ * script output has to go out, or when PHPDBG_OUTBUF_FLUSH bytes are pending.
+ * Remote consoles are written without blocking while the script runs; what the
+ * peer can't take yet stays buffered until PHPDBG_OUTBUF_MAX is reached. */
+#define PHPDBG_OUTBUF_INIT  8192
+#define PHPDBG_OUTBUF_FLUSH 65536
+#define PHPDBG_OUTBUF_MAX   (1 << 20)
+#define PHPDBG_OUTBUF_CHUNK (PHPDBG_OUTBUF_FLUSH / PHPDBG_ESCAPE_MAX_EXPANSION)
+#define PHPDBG_OUTBUF_STACK_CHUNK 256
+
+static inline zend_bool phpdbg_out_is_buffered(TSRMLS_D) {
+	/* the buffer is plain malloc'ed memory, don't touch it from inside a signal handler */
+	return !phpdbg_active_sigsafe_mem(TSRMLS_C);
+}
+
+static void phpdbg_out_grow(size_t len TSRMLS_DC) {
+	if (PHPDBG_G(out_buf).len + len > PHPDBG_G(out_buf).size) {
+		size_t size = PHPDBG_G(out_buf).size ? PHPDBG_G(out_buf).size : PHPDBG_OUTBUF_INIT;
+
+		while (size < PHPDBG_G(out_buf).len + len) {
+			size <<= 1;
+		}
+
+		PHPDBG_G(out_buf).buf = perealloc(PHPDBG_G(out_buf).buf, size, 1);
+		PHPDBG_G(out_buf).size = size;
+	}
+}
+
+/* writes out pending output (if any), followed by ptr (if any), using a single writev() where possible */
+static int phpdbg_out_flush_ex(int fd, const char *ptr, int len, zend_bool block TSRMLS_DC) {
+	struct iovec iov[2];
+	int iovcnt = 0, wrote;
+
+	if (fd == PHPDBG_G(io)[PHPDBG_STDOUT].fd) {
+		PHPDBG_POOL_CONSOLE();
+	}
+
+	if (!phpdbg_out_is_buffered(TSRMLS_C)) {
+		return len > 0 ? phpdbg_mixed_write(fd, ptr, len TSRMLS_CC) : 0;
+	}
+
+	if (PHPDBG_G(out_buf).len && fd != PHPDBG_G(out_buf).fd) {
+		/* never reorder output going to different descriptors */
+		phpdbg_out_flush_ex(PHPDBG_G(out_buf).fd, NULL, 0, 1 TSRMLS_CC);
+	}
+
+	if (PHPDBG_G(out_buf).len) {
+		iov[iovcnt].iov_base = PHPDBG_G(out_buf).buf;
+		iov[iovcnt].iov_len = PHPDBG_G(out_buf).len;
+		iovcnt++;
+	}
+	if (len > 0) {
+		iov[iovcnt].iov_base = (char *) ptr;
+		iov[iovcnt].iov_len = len;
+		iovcnt++;
+	} else {
+		len = 0;
+	}
+	if (!iovcnt) {
+		return 0;
+	}
+
+	if (!block && PHPDBG_G(out_buf).len + len > PHPDBG_OUTBUF_MAX) {
+		/* the peer doesn't keep up, wait for it */
+		PHPDBG_G(io_stats)[PHPDBG_IO_STATS_TOTAL].stalls++;
+		block = 1;
+	}
+
+	if ((PHPDBG_G(flags) & PHPDBG_IS_REMOTE) && fd == PHPDBG_G(io)[PHPDBG_STDOUT].fd) {
+		/* observers get the very same bytes, only the part they haven't seen yet */
+		phpdbg_observe_poll(TSRMLS_C);
+		phpdbg_observe_write(PHPDBG_G(out_buf).buf + PHPDBG_G(out_buf).observed, PHPDBG_G(out_buf).len - PHPDBG_G(out_buf).observed, ptr, len TSRMLS_CC);
+	}
+
+	wrote = phpdbg_mixed_writev_ex(fd, iov, iovcnt, block TSRMLS_CC);
+
+	if (wrote == -1) {
+		/* nobody is listening anymore, there's no point in keeping anything */
+		PHPDBG_G(out_buf).len = 0;
+		PHPDBG_G(out_buf).observed = 0;
+		PHPDBG_G(out_buf).limit = PHPDBG_OUTBUF_FLUSH;
+		return -1;
+	}
+
+	/* keep whatever couldn't be written for the next attempt */
+	if ((size_t) wrote < PHPDBG_G(out_buf).len) {
+		memmove(PHPDBG_G(out_buf).buf, PHPDBG_G(out_buf).buf + wrote, PHPDBG_G(out_buf).len - wrote);
+		PHPDBG_G(out_buf).len -= wrote;
+		wrote = 0;
+	} else {
+		wrote -= PHPDBG_G(out_buf).len;
+		PHPDBG_G(out_buf).len = 0;
+	}
+	if (wrote < len) {
+		PHPDBG_G(out_buf).fd = fd;
+		phpdbg_out_grow(len - wrote TSRMLS_CC);
+		memcpy(PHPDBG_G(out_buf).buf + PHPDBG_G(out_buf).len, ptr + wrote, len - wrote);
+		PHPDBG_G(out_buf).len += len - wrote;
+	}
+
+	/* don't retry a stalled peer on every single message */
+	PHPDBG_G(out_buf).limit = PHPDBG_G(out_buf).len + PHPDBG_OUTBUF_FLUSH;
+	PHPDBG_G(out_buf).observed = PHPDBG_G(out_buf).len;
+
+	return len;
+}
+
+static inline int phpdbg_out_flush(int fd, const char *ptr, int len TSRMLS_DC) {
+	return phpdbg_out_flush_ex(fd, ptr, len, 0 TSRMLS_CC);
+}
+
+PHPDBG_API void phpdbg_flush_output(TSRMLS_D) {
+	if (PHPDBG_G(out_buf).len) {
+		phpdbg_out_flush_ex(PHPDBG_G(out_buf).fd, NULL, 0, 1 TSRMLS_CC);
+	}
+}
+
+PHPDBG_API void phpdbg_free_output_buffer(TSRMLS_D) {
+	phpdbg_flush_output(TSRMLS_C);
+
+	if (PHPDBG_G(out_buf).buf) {
+		pefree(PHPDBG_G(out_buf).buf, 1);
+	}
+	memset(&PHPDBG_G(out_buf), 0, sizeof(PHPDBG_G(out_buf)));
+
+	if (PHPDBG_G(json_tag).buf) {
+		pefree(PHPDBG_G(json_tag).buf, 1);
+	}
+	memset(&PHPDBG_G(json_tag), 0, sizeof(PHPDBG_G(json_tag)));
+}
+
+/* returns room for at least len bytes at the end of the buffer; commit by increasing out_buf.len */
+static char *phpdbg_out_reserve(int fd, size_t len TSRMLS_DC) {
+	if (PHPDBG_G(out_buf).len) {
+		if (fd != PHPDBG_G(out_buf).fd) {
+			phpdbg_flush_output(TSRMLS_C);
+		} else if (PHPDBG_G(out_buf).len + len > (PHPDBG_G(out_buf).limit ? PHPDBG_G(out_buf).limit : PHPDBG_OUTBUF_FLUSH)) {
+			phpdbg_out_flush(fd, NULL, 0 TSRMLS_CC);
+		}
+	}
+
+	PHPDBG_G(out_buf).fd = fd;
+	phpdbg_out_grow(len TSRMLS_CC);
+
+	return PHPDBG_G(out_buf).buf + PHPDBG_G(out_buf).len;
+}
+
+static void phpdbg_out_append(int fd, const char *str, int len TSRMLS_DC) {
+	if (!phpdbg_out_is_buffered(TSRMLS_C)) {
+		phpdbg_mixed_write(fd, str, len TSRMLS_CC);
+		return;
+	}
+
+	if (len >= PHPDBG_OUTBUF_FLUSH) {
+		phpdbg_out_flush(fd, str, len TSRMLS_CC);
+		return;
+	}
+
+	memcpy(phpdbg_out_reserve(fd, len TSRMLS_CC), str, len);
+	PHPDBG_G(out_buf).len += len;
+}
+
+/* escapes msg directly into the output buffer */
+static void phpdbg_out_encode(int fd, const char *msg, int msglen, int mode TSRMLS_DC) {
+	const char *end = msg + msglen, *eol = NULL;
+	size_t eol_len = 0;
+
+	if (!(mode & PHPDBG_ESCAPE_EOL) || !(PHPDBG_G(flags) & PHPDBG_IS_REMOTE) || !(eol = phpdbg_eol_rep(PHPDBG_G(eol)))) {
+		mode &= ~PHPDBG_ESCAPE_EOL;
+	} else {
+		eol_len = strlen(eol);
+	}
+
+	if (!mode) {
+		phpdbg_out_append(fd, msg, msglen TSRMLS_CC);
+		return;
+	}
+
+	while (msg < end) {
+		const char *stop = msg + MIN(end - msg, phpdbg_out_is_buffered(TSRMLS_C) ? PHPDBG_OUTBUF_CHUNK : PHPDBG_OUTBUF_STACK_CHUNK);
+
+		/* keep \r\n together, it's a single line ending */
+		if (stop < end && stop[-1] == '\r') {
+			stop++;
+		}
+
+		if (phpdbg_out_is_buffered(TSRMLS_C)) {
+			char *out = phpdbg_out_reserve(fd, (stop - msg) * PHPDBG_ESCAPE_MAX_EXPANSION TSRMLS_CC);
+
+			PHPDBG_G(out_buf).len += phpdbg_escape(out, msg, stop - msg, mode, eol, eol_len);
 		} else {
-			*tmp++ = *msg;
+			/* only the stack may be used here */
+			char tmp[(PHPDBG_OUTBUF_STACK_CHUNK + 1) * PHPDBG_ESCAPE_MAX_EXPANSION];
+
+			phpdbg_mixed_write(fd, tmp, phpdbg_escape(tmp, msg, stop - msg, mode, eol, eol_len) TSRMLS_CC);
+		}
+
+		msg = stop;
+	}
+} /* }}} */
+
+/* {{{ json frames
+ * With -j every message is sent as a netstring ("<length>:<json>,") instead of
+ * an xml element. The bodies are produced from the very same xml fragments,
+ * attributes become a flat object and msgout is only sent with -jj:
+ *  {"tag":"...","severity":"...","req":N,"attrs":{...},"msg":"..."}
+ *  {"open":"...","attrs":{...}} ... {"close":"..."}
+ *  {"stream":"stdout","data":"..."}
+ *  {"out":"..."} */
+static void phpdbg_json_append_string(smart_str *buf, const char *str, size_t len, zend_bool xml_decoded) {
+	const char *end = str + len;
+
+	smart_str_appendc(buf, '"');
+	while (str < end) {
+		unsigned char c = *str++;
+
+		if (c == '&' && xml_decoded) {
+			/* values passed through format_converter are xml escaped, undo that */
+			const char *semi = memchr(str, ';', MIN(end - str, 8));
+
+			if (semi) {
+				size_t elen = semi - str;
+
+				if (elen == 3 && !memcmp(str, "amp", 3)) {
+					c = '&';
+				} else if (elen == 4 && !memcmp(str, "quot", 4)) {
+					c = '"';
+				} else if (elen == 2 && !memcmp(str, "lt", 2)) {
+					c = '<';
+				} else if (elen == 2 && !memcmp(str, "gt", 2)) {
+					c = '>';
+				} else if (elen == 4 && !memcmp(str, "apos", 4)) {
+					c = '\'';
+				} else {
+					semi = NULL;
+				}
+				if (semi) {
+					str = semi + 1;
+				}
+			}
+		}
+
+		switch (c) {
+			case '"':  smart_str_appendl(buf, "\\\"", 2); break;
+			case '\\': smart_str_appendl(buf, "\\\\", 2); break;
+			case '\n': smart_str_appendl(buf, "\\n", 2); break;
+			case '\r': smart_str_appendl(buf, "\\r", 2); break;
+			case '\t': smart_str_appendl(buf, "\\t", 2); break;
+
+			default:
+				if (c < 0x20 || c == 0x7f) {
+					char hex[sizeof("\\u0000")];
+					smart_str_appendl(buf, hex, snprintf(hex, sizeof(hex), "\\u%04x", c));
+				} else {
+					smart_str_appendc(buf, c);
+				}
 		}
 	}
+	smart_str_appendc(buf, '"');
+}
 
-	{
-		int len = tmp - *buf;
-		*buf = erealloc(*buf, len + 1);
-		return len;
+/* translates the key="value" pairs of an xml tag into "attrs":{...} */
+static void phpdbg_json_append_attrs(smart_str *buf, const char *xml, size_t len) {
+	const char *end = xml + len;
+	zend_bool first = 1;
+
+	smart_str_appendl(buf, ",\"attrs\":{", sizeof(",\"attrs\":{") - 1);
+	while (xml < end) {
+		const char *key, *eq, *val, *quot;
+
+		while (xml < end && (*xml == ' ' || *xml == '\t' || *xml == '\n' || *xml == '\r' || *xml == '/')) {
+			xml++;
+		}
+		if (xml >= end || !(eq = memchr(xml, '=', end - xml)) || eq + 1 >= end || eq[1] != '"') {
+			break;
+		}
+		key = xml;
+		val = eq + 2;
+		if (!(quot = memchr(val, '"', end - val))) {
+			quot = end;
+		}
+
+		if (!first) {
+			smart_str_appendc(buf, ',');
+		}
+		first = 0;
+		phpdbg_json_append_string(buf, key, eq - key, 0);
+		smart_str_appendc(buf, ':');
+		phpdbg_json_append_string(buf, val, quot - val, 1);
+
+		xml = quot + 1;
 	}
+	smart_str_appendc(buf, '}');
 }
 
-static void phpdbg_encode_ctrl_chars(char **buf, int *buflen) {
-	char *tmp, *tmpptr;
-	int len;
-	int i;
+static void phpdbg_json_frame(int fd, smart_str *body TSRMLS_DC) {
+	char len[MAX_LENGTH_OF_LONG + sizeof(":")];
+
+	smart_str_appendc(body, '}');
+	phpdbg_out_append(fd, len, snprintf(len, sizeof(len), "%lu:", (unsigned long) body->len) TSRMLS_CC);
+	phpdbg_out_append(fd, body->c, body->len TSRMLS_CC);
+	phpdbg_out_append(fd, ZEND_STRL(",") TSRMLS_CC);
+	smart_str_free(body);
+}
 
-	tmp = tmpptr = emalloc(*buflen * 5);
+/* tag is a complete "<...>" as written by phpdbg_xml() */
+static void phpdbg_json_tag(int fd, const char *tag, size_t len TSRMLS_DC) {
+	smart_str body = {0};
+	const char *name, *end = tag + len - 1;
+	size_t namelen;
+	zend_bool leaf = 0, close = 0;
 
-	for (i = 0; i < *buflen; i++) {
-		if ((*buf)[i] < 0x20) {
-			*tmpptr++ = '&';
-			*tmpptr++ = '#';
-			if ((unsigned int) ((*buf)[i]) > 9) {
-				*tmpptr++ = ((*buf)[i] / 10) + '0';
+	tag++;
+	if (*tag == '?' || *tag == '!') {
+		return;
+	}
+	if (*tag == '/') {
+		close = 1;
+		tag++;
+	}
+	if (end > tag && end[-1] == '/') {
+		leaf = 1;
+		end--;
+	}
+
+	name = tag;
+	namelen = strcspn(name, " \t\r\n/>");
+	if (namelen > (size_t) (end - name)) {
+		namelen = end - name;
+	}
+
+	smart_str_appends(&body, close ? "{\"close\":" : leaf ? "{\"tag\":" : "{\"open\":");
+	phpdbg_json_append_string(&body, name, namelen, 0);
+	if (!close) {
+		phpdbg_json_append_attrs(&body, name + namelen, end - name - namelen);
+	}
+	phpdbg_json_frame(fd, &body TSRMLS_CC);
+}
+
+/* phpdbg_xml() is called with arbitrary pieces of tags, only complete tags become frames */
+static void phpdbg_json_xml(int fd, const char *xml, size_t len TSRMLS_DC) {
+	const char *end = xml + len;
+
+	while (xml < end) {
+		const char *start = xml;
+
+		if (!PHPDBG_G(json_tag).in_tag) {
+			if (!(start = memchr(xml, '<', end - xml))) {
+				/* text between tags carries no information */
+				return;
 			}
-			*tmpptr++ = ((*buf)[i] % 10) + '0';
-			*tmpptr++ = ';';
-		} else {
-			*tmpptr++ = (*buf)[i];
+			PHPDBG_G(json_tag).in_tag = 1;
+			PHPDBG_G(json_tag).in_quote = 0;
+			PHPDBG_G(json_tag).len = 0;
+		}
+
+		for (xml = start; xml < end; xml++) {
+			if (*xml == '"') {
+				PHPDBG_G(json_tag).in_quote = !PHPDBG_G(json_tag).in_quote;
+			} else if (*xml == '>' && !PHPDBG_G(json_tag).in_quote) {
+				break;
+			}
+		}
+
+		if (xml < end) {
+			xml++;
+		}
+
+		if (PHPDBG_G(json_tag).len + (xml - start) > PHPDBG_G(json_tag).size) {
+			PHPDBG_G(json_tag).size = PHPDBG_G(json_tag).len + (xml - start) + 256;
+			PHPDBG_G(json_tag).buf = perealloc(PHPDBG_G(json_tag).buf, PHPDBG_G(json_tag).size, 1);
+		}
+		memcpy(PHPDBG_G(json_tag).buf + PHPDBG_G(json_tag).len, start, xml - start);
+		PHPDBG_G(json_tag).len += xml - start;
+
+		if (xml[-1] == '>' && !PHPDBG_G(json_tag).in_quote) {
+			PHPDBG_G(json_tag).in_tag = 0;
+			phpdbg_json_tag(fd, PHPDBG_G(json_tag).buf, PHPDBG_G(json_tag).len TSRMLS_CC);
 		}
 	}
+}
 
-	len = tmpptr - tmp;
+static void phpdbg_json_message(int fd, const char *tag, const char *severity, const char *xml, int xmllen, const char *pre, int prelen, const char *msg, int msglen, const char *post, int postlen TSRMLS_DC) {
+	smart_str body = {0};
+
+	smart_str_appendl(&body, "{\"tag\":", sizeof("{\"tag\":") - 1);
+	phpdbg_json_append_string(&body, tag, strlen(tag), 0);
+	smart_str_appendl(&body, ",\"severity\":\"", sizeof(",\"severity\":\"") - 1);
+	smart_str_appends(&body, severity);
+	smart_str_appendc(&body, '"');
+	if (PHPDBG_G(req_id)) {
+		smart_str_appendl(&body, ",\"req\":", sizeof(",\"req\":") - 1);
+		smart_str_append_unsigned(&body, PHPDBG_G(req_id));
+	}
+	phpdbg_json_append_attrs(&body, xml, xmllen);
+	if (pre && (PHPDBG_G(flags) & PHPDBG_JSON_MSGOUT)) {
+		char *out = emalloc(prelen + msglen + postlen);
 
-	efree(*buf);
-	*buf = erealloc(tmp, len + 1);
-	*buflen = len;
+		memcpy(out, pre, prelen);
+		if (msglen) {
+			memcpy(out + prelen, msg, msglen);
+		}
+		memcpy(out + prelen + msglen, post, postlen);
+		smart_str_appendl(&body, ",\"msg\":", sizeof(",\"msg\":") - 1);
+		phpdbg_json_append_string(&body, out, prelen + msglen + postlen, 0);
+		efree(out);
+	}
+	phpdbg_json_frame(fd, &body TSRMLS_CC);
 }
 
+static void phpdbg_json_text(int fd, const char *key, const char *value, const char *text, int textlen TSRMLS_DC) {
+	smart_str body = {0};
+
+	smart_str_appendc(&body, '{');
+	phpdbg_json_append_string(&body, key, strlen(key), 0);
+	if (value) {
+		smart_str_appendc(&body, ':');
+		phpdbg_json_append_string(&body, value, strlen(value), 0);
+		smart_str_appendl(&body, ",\"data\"", sizeof(",\"data\"") - 1);
+	}
+	smart_str_appendc(&body, ':');
+	phpdbg_json_append_string(&body, text, textlen, 0);
+	phpdbg_json_frame(fd, &body TSRMLS_CC);
+} /* }}} */
+
 static int phpdbg_process_print(int fd, int type, const char *tag, const char *msg, int msglen, const char *xml, int xmllen TSRMLS_DC) {
-	char *msgout = NULL, *buf;
-	int msgoutlen, xmloutlen, buflen;
+	char prefix[PHPDBG_COLOR_LEN + sizeof("\033[m[")], *logprefix = NULL;
+	const char *pre = NULL, *post = "";
+	int prelen = 0, postlen = 0;
 	const char *severity;
 
 	if ((PHPDBG_G(flags) & PHPDBG_WRITE_XML) && PHPDBG_G(in_script_xml) && PHPDBG_G(in_script_xml) != type) {
-		phpdbg_mixed_write(fd, ZEND_STRL("</stream>") TSRMLS_CC);
+		phpdbg_out_append(fd, ZEND_STRL("</stream>") TSRMLS_CC);
 		PHPDBG_G(in_script_xml) = 0;
 	}
 
@@ -962,86 +1339,88 @@ static int phpdbg_process_print(int fd, int type, const char *tag, const char *m
 		case P_ERROR:
 			severity = "error";
 			if (!PHPDBG_G(last_was_newline)) {
-				if (PHPDBG_G(flags) & PHPDBG_WRITE_XML) {
-					phpdbg_mixed_write(fd, ZEND_STRL("<phpdbg>\n" "</phpdbg>") TSRMLS_CC);
+				if (PHPDBG_G(flags) & PHPDBG_WRITE_JSON) {
+					/* nothing, frames need no separation */
+				} else if (PHPDBG_G(flags) & PHPDBG_WRITE_XML) {
+					phpdbg_out_append(fd, ZEND_STRL("<phpdbg>\n" "</phpdbg>") TSRMLS_CC);
 				} else {
-					phpdbg_mixed_write(fd, ZEND_STRL("\n") TSRMLS_CC);
+					phpdbg_out_append(fd, ZEND_STRL("\n") TSRMLS_CC);
 				}
 				PHPDBG_G(last_was_newline) = 1;
 			}
 			if (PHPDBG_G(flags) & PHPDBG_IS_COLOURED) {
-				msgoutlen = phpdbg_asprintf(&msgout, "\033[%sm[%.*s]\033[0m\n", PHPDBG_G(colors)[PHPDBG_COLOR_ERROR]->code, msglen, msg);
+				prelen = snprintf(prefix, sizeof(prefix), "\033[%sm[", PHPDBG_G(colors)[PHPDBG_COLOR_ERROR]->code);
+				pre = prefix;
+				post = "]\033[0m\n";
 			} else {
-				msgoutlen = phpdbg_asprintf(&msgout, "[%.*s]\n", msglen, msg);
+				pre = "[";
+				post = "]\n";
 			}
 			break;
 
 		case P_NOTICE:
 			severity = "notice";
 			if (!PHPDBG_G(last_was_newline)) {
-				if (PHPDBG_G(flags) & PHPDBG_WRITE_XML) {
-					phpdbg_mixed_write(fd, ZEND_STRL("<phpdbg>\n" "</phpdbg>") TSRMLS_CC);
+				if (PHPDBG_G(flags) & PHPDBG_WRITE_JSON) {
+					/* nothing, frames need no separation */
+				} else if (PHPDBG_G(flags) & PHPDBG_WRITE_XML) {
+					phpdbg_out_append(fd, ZEND_STRL("<phpdbg>\n" "</phpdbg>") TSRMLS_CC);
 				} else {
-					phpdbg_mixed_write(fd, ZEND_STRL("\n") TSRMLS_CC);
+					phpdbg_out_append(fd, ZEND_STRL("\n") TSRMLS_CC);
 				}
 				PHPDBG_G(last_was_newline) = 1;
 			}
 			if (PHPDBG_G(flags) & PHPDBG_IS_COLOURED) {
-				msgoutlen = phpdbg_asprintf(&msgout, "\033[%sm[%.*s]\033[0m\n", PHPDBG_G(colors)[PHPDBG_COLOR_NOTICE]->code, msglen, msg);
+				prelen = snprintf(prefix, sizeof(prefix), "\033[%sm[", PHPDBG_G(colors)[PHPDBG_COLOR_NOTICE]->code);
+				pre = prefix;
+				post = "]\033[0m\n";
 			} else {
-				msgoutlen = phpdbg_asprintf(&msgout, "[%.*s]\n", msglen, msg);
+				pre = "[";
+				post = "]\n";
 			}
 			break;
 
 		case P_WRITELN:
 			severity = "normal";
-			if (msg) {
-				msgoutlen = phpdbg_asprintf(&msgout, "%.*s\n", msglen, msg);
-			} else {
-				msgoutlen = 1;
-				msgout = estrdup("\n");
-			}
+			pre = "";
+			post = "\n";
 			PHPDBG_G(last_was_newline) = 1;
 			break;
 
 		case P_WRITE:
 			severity = "normal";
-			if (msg) {
-				msgout = estrndup(msg, msglen);
-				msgoutlen = msglen;
+			pre = "";
+			if (msg && msglen) {
 				PHPDBG_G(last_was_newline) = msg[msglen - 1] == '\n';
-			} else {
-				msgoutlen = 0;
-				msgout = estrdup("");
 			}
 			break;
 
 		case P_STDOUT:
 		case P_STDERR:
-			if (msg) {
-				PHPDBG_G(last_was_newline) = msg[msglen - 1] == '\n';
-				if (PHPDBG_G(flags) & PHPDBG_WRITE_XML) {
-					if (PHPDBG_G(in_script_xml) != type) {
-						char *stream_buf;
-						int stream_buflen = phpdbg_asprintf(&stream_buf, "<stream type=\"%s\">", type == P_STDERR ? "stderr" : "stdout");
-						phpdbg_mixed_write(fd, stream_buf, stream_buflen TSRMLS_CC);
-						efree(stream_buf);
-						PHPDBG_G(in_script_xml) = type;
+			if (!msg || !msglen) {
+				return 0;
+			}
+
+			PHPDBG_G(last_was_newline) = msg[msglen - 1] == '\n';
+			if (PHPDBG_G(flags) & PHPDBG_WRITE_JSON) {
+				phpdbg_json_text(fd, "stream", type == P_STDERR ? "stderr" : "stdout", msg, msglen TSRMLS_CC);
+				phpdbg_out_flush(fd, NULL, 0 TSRMLS_CC);
+			} else if (PHPDBG_G(flags) & PHPDBG_WRITE_XML) {
+				if (PHPDBG_G(in_script_xml) != type) {
+					if (type == P_STDERR) {
+						phpdbg_out_append(fd, ZEND_STRL("<stream type=\"stderr\">") TSRMLS_CC);
+					} else {
+						phpdbg_out_append(fd, ZEND_STRL("<stream type=\"stdout\">") TSRMLS_CC);
 					}
-#if PHP_VERSION_ID >= 50600
-					buf = php_escape_html_entities((unsigned char *) msg, msglen, (size_t *) &buflen, 0, ENT_NOQUOTES, PG(internal_encoding) && PG(internal_encoding)[0] ? PG(internal_encoding) : (SG(default_charset) ? SG(default_charset) : "UTF-8") TSRMLS_CC);
-#else
-					buf = php_escape_html_entities((unsigned char *) msg, msglen, (size_t *) &buflen, 0, ENT_NOQUOTES, SG(default_charset) ? SG(default_charset) : "UTF-8" TSRMLS_CC);
-#endif
-					phpdbg_encode_ctrl_chars(&buf, &buflen);
-					phpdbg_mixed_write(fd, buf, buflen TSRMLS_CC);
-					efree(buf);
-				} else {
-					phpdbg_mixed_write(fd, msg, msglen TSRMLS_CC);
+					PHPDBG_G(in_script_xml) = type;
 				}
-				return msglen;
+				phpdbg_out_encode(fd, msg, msglen, PHPDBG_ESCAPE_XML | PHPDBG_ESCAPE_CTRL TSRMLS_CC);
+				phpdbg_out_flush(fd, NULL, 0 TSRMLS_CC);
+			} else {
+				/* script output must not be delayed: pending output and msg go out together */
+				phpdbg_out_flush(fd, msg, msglen TSRMLS_CC);
 			}
-		break;
+			return msglen;
 
 		/* no formatting on logging output */
 		case P_LOG:
@@ -1049,49 +1428,60 @@ static int phpdbg_process_print(int fd, int type, const char *tag, const char *m
 			if (msg) {
 				struct timeval tp;
 				if (gettimeofday(&tp, NULL) == SUCCESS) {
-					msgoutlen = phpdbg_asprintf(&msgout, "[%ld %.8F]: %.*s\n", tp.tv_sec, tp.tv_usec / 1000000., msglen, msg);
-				} else {
-					msgoutlen = FAILURE;
+					prelen = phpdbg_asprintf(&logprefix, "[%ld %.8F]: ", tp.tv_sec, tp.tv_usec / 1000000.);
+					pre = logprefix;
+					post = "\n";
 				}
 			}
 			break;
+
+		default:
+			return 0;
 	}
 
-	if (PHPDBG_G(flags) & PHPDBG_WRITE_XML) {
-		char *xmlout;
+	if (pre) {
+		if (!prelen) {
+			prelen = strlen(pre);
+		}
+		postlen = strlen(post);
+		if (!msg) {
+			msglen = 0;
+		}
+	}
+
+	if (PHPDBG_G(flags) & PHPDBG_WRITE_JSON) {
+		phpdbg_json_message(fd, tag, severity, xml, xmllen, pre, prelen, msg, msglen, post, postlen TSRMLS_CC);
+	} else if (PHPDBG_G(flags) & PHPDBG_WRITE_XML) {
+		phpdbg_out_append(fd, ZEND_STRL("<") TSRMLS_CC);
+		phpdbg_out_append(fd, tag, strlen(tag) TSRMLS_CC);
+		phpdbg_out_append(fd, ZEND_STRL(" severity=\"") TSRMLS_CC);
+		phpdbg_out_append(fd, severity, strlen(severity) TSRMLS_CC);
+		phpdbg_out_append(fd, ZEND_STRL("\" ") TSRMLS_CC);
 
 		if (PHPDBG_G(req_id)) {
-			char *xmlbuf = NULL;
-			xmllen = phpdbg_asprintf(&xmlbuf, "req=\"%lu\" %.*s", PHPDBG_G(req_id), xmllen, xml);
-			xml = xmlbuf;
+			char req[sizeof("req=\"\" ") + MAX_LENGTH_OF_LONG];
+			phpdbg_out_append(fd, req, snprintf(req, sizeof(req), "req=\"%lu\" ", PHPDBG_G(req_id)) TSRMLS_CC);
 		}
-		if (msgout) {
-			buflen = phpdbg_encode_xml(&buf, msgout, msgoutlen, '"', "&quot;");
-			xmloutlen = phpdbg_asprintf(&xmlout, "<%s severity=\"%s\" %.*s msgout=\"%.*s\" />", tag, severity, xmllen, xml, buflen, buf);
 
-			efree(buf);
-		} else {
-			xmloutlen = phpdbg_asprintf(&xmlout, "<%s severity=\"%s\" %.*s msgout=\"\" />", tag, severity, xmllen, xml);
+		phpdbg_out_encode(fd, xml, xmllen, PHPDBG_ESCAPE_CTRL TSRMLS_CC);
+		phpdbg_out_append(fd, ZEND_STRL(" msgout=\"") TSRMLS_CC);
+		if (pre) {
+			phpdbg_out_encode(fd, pre, prelen, PHPDBG_ESCAPE_XML | PHPDBG_ESCAPE_QUOT | PHPDBG_ESCAPE_CTRL TSRMLS_CC);
+			phpdbg_out_encode(fd, msg, msglen, PHPDBG_ESCAPE_XML | PHPDBG_ESCAPE_QUOT | PHPDBG_ESCAPE_CTRL TSRMLS_CC);
+			phpdbg_out_encode(fd, post, postlen, PHPDBG_ESCAPE_XML | PHPDBG_ESCAPE_QUOT | PHPDBG_ESCAPE_CTRL TSRMLS_CC);
 		}
-
-		phpdbg_encode_ctrl_chars(&xmlout, &xmloutlen);
-		phpdbg_eol_convert(&xmlout, &xmloutlen TSRMLS_CC);
-		phpdbg_mixed_write(fd, xmlout, xmloutlen TSRMLS_CC);
-		efree(xmlout);
-	} else if (msgout) {
-		phpdbg_eol_convert(&msgout, &msgoutlen TSRMLS_CC);
-		phpdbg_mixed_write(fd, msgout, msgoutlen TSRMLS_CC);
+		phpdbg_out_append(fd, ZEND_STRL("\" />") TSRMLS_CC);
+	} else if (pre) {
+		phpdbg_out_encode(fd, pre, prelen, PHPDBG_ESCAPE_EOL TSRMLS_CC);
+		phpdbg_out_encode(fd, msg, msglen, PHPDBG_ESCAPE_EOL TSRMLS_CC);
+		phpdbg_out_encode(fd, post, postlen, PHPDBG_ESCAPE_EOL TSRMLS_CC);
 	}
 
-	if (PHPDBG_G(req_id) && (PHPDBG_G(flags) & PHPDBG_WRITE_XML)) {
-		efree((char *) xml);
+	if (logprefix) {
+		efree(logprefix);
 	}
 
-	if (msgout) {
-		efree(msgout);
-	}
-
-	return msgout ? msgoutlen : xmloutlen;
+	return pre ? prelen + msglen + postlen : xmllen;
 } /* }}} */
 
 PHPDBG_API int phpdbg_vprint(int type TSRMLS_DC, int fd, const char *tag, const char *xmlfmt, const char *strfmt, va_list args) {
@@ -1219,14 +1609,17 @@ PHPDBG_API int phpdbg_xml_internal(int fd TSRMLS_DC, const char *fmt, ...) {
 		buflen = phpdbg_xml_vasprintf(&buffer, fmt, 1, args TSRMLS_CC);
 		va_end(args);
 
-		phpdbg_encode_ctrl_chars(&buffer, &buflen);
-
 		if (PHPDBG_G(in_script_xml)) {
-			phpdbg_mixed_write(fd, ZEND_STRL("</stream>") TSRMLS_CC);
+			phpdbg_out_append(fd, ZEND_STRL("</stream>") TSRMLS_CC);
 			PHPDBG_G(in_script_xml) = 0;
 		}
 
-		len = phpdbg_mixed_write(fd, buffer, buflen TSRMLS_CC);
+		if (PHPDBG_G(flags) & PHPDBG_WRITE_JSON) {
+			phpdbg_json_xml(fd, buffer, buflen TSRMLS_CC);
+		} else {
+			phpdbg_out_encode(fd, buffer, buflen, PHPDBG_ESCAPE_CTRL TSRMLS_CC);
+		}
+		len = buflen;
 		efree(buffer);
 	}
 
@@ -1243,7 +1636,7 @@ PHPDBG_API int phpdbg_log_internal(int fd TSRMLS_DC, const char *fmt, ...) {
 	buflen = phpdbg_xml_vasprintf(&buffer, fmt, 0, args TSRMLS_CC);
 	va_end(args);
 
-	len = phpdbg_mixed_write(fd, buffer, buflen TSRMLS_CC);
+	len = phpdbg_out_flush(fd, buffer, buflen TSRMLS_CC);
 	efree(buffer);
 
 	return len;
@@ -1263,27 +1656,24 @@ PHPDBG_API int phpdbg_out_internal(int fd TSRMLS_DC, const char *fmt, ...) {
 	buflen = phpdbg_xml_vasprintf(&buffer, fmt, 0, args TSRMLS_CC);
 	va_end(args);
 
-	if (PHPDBG_G(flags) & PHPDBG_WRITE_XML) {
-		char *msg;
-		int msglen;
-
-		msglen = phpdbg_encode_xml(&msg, buffer, buflen, 256, NULL);
-		phpdbg_encode_ctrl_chars(&msg, &msglen);
-		phpdbg_eol_convert(&msg, &msglen TSRMLS_CC);
-
+	if (PHPDBG_G(flags) & PHPDBG_WRITE_JSON) {
+		phpdbg_json_text(fd, "out", NULL, buffer, buflen TSRMLS_CC);
+	} else if (PHPDBG_G(flags) & PHPDBG_WRITE_XML) {
 		if (PHPDBG_G(in_script_xml)) {
-			phpdbg_mixed_write(fd, ZEND_STRL("</stream>") TSRMLS_CC);
+			phpdbg_out_append(fd, ZEND_STRL("</stream>") TSRMLS_CC);
 			PHPDBG_G(in_script_xml) = 0;
 		}
 
-		phpdbg_mixed_write(fd, ZEND_STRL("<phpdbg>") TSRMLS_CC);
-		len = phpdbg_mixed_write(fd, msg, msglen TSRMLS_CC);
-		phpdbg_mixed_write(fd, ZEND_STRL("</phpdbg>") TSRMLS_CC);
+		phpdbg_out_append(fd, ZEND_STRL("<phpdbg>") TSRMLS_CC);
+		phpdbg_out_encode(fd, buffer, buflen, PHPDBG_ESCAPE_XML | PHPDBG_ESCAPE_CTRL TSRMLS_CC);
+		phpdbg_out_append(fd, ZEND_STRL("</phpdbg>") TSRMLS_CC);
 	} else {
-		phpdbg_eol_convert(&buffer, &buflen TSRMLS_CC);
-		len = phpdbg_mixed_write(fd, buffer, buflen TSRMLS_CC);
+		phpdbg_out_encode(fd, buffer, buflen, PHPDBG_ESCAPE_EOL TSRMLS_CC);
 	}
 
+	len = buflen;
+	efree(buffer);
+
 	return len;
 }
 
@@ -1310,7 +1700,7 @@ PHPDBG_API int phpdbg_rlog_internal(int fd TSRMLS_DC, const char *fmt, ...) { /*
 		rc = phpdbg_xml_vasprintf(&outbuf, format, 0, args TSRMLS_CC);
 
 		if (outbuf) {
-			rc = phpdbg_mixed_write(fd, outbuf, rc TSRMLS_CC);
+			rc = phpdbg_out_flush_ex(fd, outbuf, rc, 1 TSRMLS_CC);
 			efree(outbuf);
 		}
 
@@ -86,6 +86,9 @@ PHPDBG_API void phpdbg_free_err_buf(TSRMLS_D);
 PHPDBG_API void phpdbg_activate_err_buf(zend_bool active TSRMLS_DC);
 PHPDBG_API int phpdbg_output_err_buf(const char *tag, const char *xmlfmt, const char *strfmt TSRMLS_DC, ...);
 
+PHPDBG_API void phpdbg_flush_output(TSRMLS_D);
+PHPDBG_API void phpdbg_free_output_buffer(TSRMLS_D);
+
 
 /* {{{ For separation */
 #define SEPARATE "------------------------------------------------" /* }}} */
@@ -36,6 +36,7 @@ const phpdbg_command_t phpdbg_print_commands[] = {
 	PHPDBG_PRINT_COMMAND_D(method,     "print out the instructions in the specified method",   'm', print_method, NULL, "m", PHPDBG_ASYNC_SAFE),
 	PHPDBG_PRINT_COMMAND_D(func,       "print out the instructions in the specified function", 'f', print_func,   NULL, "s", PHPDBG_ASYNC_SAFE),
 	PHPDBG_PRINT_COMMAND_D(stack,      "print out the instructions in the current stack",      's', print_stack,  NULL, 0, PHPDBG_ASYNC_SAFE),
+	PHPDBG_PRINT_COMMAND_D(children,   "print out more children of a variable handle",         'h', print_children, NULL, "n|nn", 0),
 	PHPDBG_END_COMMAND
 };
 
@@ -55,7 +56,6 @@ static inline void phpdbg_print_function_helper(zend_function *method TSRMLS_DC)
 	switch (method->type) {
 		case ZEND_USER_FUNCTION: {
 			zend_op_array* op_array = &(method->op_array);
-			HashTable vars;
 
 			if (op_array) {
 				zend_op *opline = &(op_array->opcodes[0]);
@@ -77,22 +77,17 @@ static inline void phpdbg_print_function_helper(zend_function *method TSRMLS_DC)
 						op_array->filename ? op_array->filename : "unknown");
 				}
 
-				zend_hash_init(&vars, op_array->last, NULL, NULL, 0);
 				do {
-					char *decode = phpdbg_decode_opline(op_array, opline, &vars TSRMLS_CC);
-					if (decode != NULL) {
-						phpdbg_writeln("print", "line=\"%u\" opline=\"%p\" opcode=\"%s\" op=\"%s\"", "\t\tL%u\t%p %-30s %s",
-							opline->lineno,
-							opline,
-							phpdbg_decode_opcode(opline->opcode),
-							decode);
-						free(decode);
-					} else {
-						phpdbg_error("print", "type=\"decodefailure\" opline=\"%16p\"", "\tFailed to decode opline %16p", opline);
-					}
+					smart_str buf = {0};
+
+					phpdbg_writeln("print", "line=\"%u\" opline=\"%p\" opcode=\"%s\" op=\"%s\"", "\t\tL%u\t%p %-30s %s",
+						opline->lineno,
+						opline,
+						phpdbg_decode_opcode(opline->opcode),
+						phpdbg_decode_opline_cached(op_array, opline, &buf TSRMLS_CC));
+					smart_str_free(&buf);
 					opline++;
 				} while (opcode++ < end);
-				zend_hash_destroy(&vars);
 			}
 		} break;
 
@@ -262,3 +257,25 @@ PHPDBG_PRINT(func) /* {{{ */
 
 	return SUCCESS;
 } /* }}} */
+
+PHPDBG_PRINT(children) /* {{{ */
+{
+	zval **zv;
+	long offset = 0, count = PHPDBG_G(var_children);
+
+	if (param->next) {
+		offset = param->next->num;
+		if (param->next->next) {
+			count = param->next->next->num;
+		}
+	}
+
+	if (zend_hash_index_find(&PHPDBG_G(var_handles), param->num, (void **) &zv) == FAILURE) {
+		phpdbg_error("children", "type=\"nohandle\" handle=\"%ld\"", "Handle %ld is unknown, handles are released when execution continues", param->num);
+		return SUCCESS;
+	}
+
+	phpdbg_print_var_children(*zv, param->num, offset, count TSRMLS_CC);
+
+	return SUCCESS;
+} /* }}} */
@@ -34,6 +34,7 @@ PHPDBG_PRINT(class);
 PHPDBG_PRINT(method);
 PHPDBG_PRINT(func);
 PHPDBG_PRINT(stack);
+PHPDBG_PRINT(children);
 
 extern const phpdbg_command_t phpdbg_print_commands[];
 
@@ -39,6 +39,8 @@
 #include "phpdbg_parser.h"
 #include "phpdbg_wait.h"
 #include "phpdbg_eol.h"
+#include "phpdbg_io.h"
+#include "phpdbg_iothread.h"
 
 ZEND_EXTERN_MODULE_GLOBALS(phpdbg);
 extern int phpdbg_startup_run;
@@ -64,8 +66,8 @@ ZEND_EXTERN_MODULE_GLOBALS(output);
 /* {{{ command declarations */
 const phpdbg_command_t phpdbg_prompt_commands[] = {
 	PHPDBG_COMMAND_D(exec,    "set execution context",                    'e', NULL, "s", 0),
-	PHPDBG_COMMAND_D(step,    "step through execution",                   's', NULL, 0, PHPDBG_ASYNC_SAFE),
-	PHPDBG_COMMAND_D(continue,"continue execution",                       'c', NULL, 0, PHPDBG_ASYNC_SAFE),
+	PHPDBG_COMMAND_D(step,    "step through execution",                   's', NULL, 0, PHPDBG_ASYNC_SAFE | PHPDBG_PROMPT_ONLY),
+	PHPDBG_COMMAND_D(continue,"continue execution",                       'c', NULL, 0, PHPDBG_ASYNC_SAFE | PHPDBG_PROMPT_ONLY),
 	PHPDBG_COMMAND_D(run,     "attempt execution",                        'r', NULL, "|s", 0),
 	PHPDBG_COMMAND_D(ev,      "evaluate some code",                        0 , NULL, "i", PHPDBG_ASYNC_SAFE), /* restricted ASYNC_SAFE */
 	PHPDBG_COMMAND_D(until,   "continue past the current line",           'u', NULL, 0, 0),
@@ -85,10 +87,11 @@ const phpdbg_command_t phpdbg_prompt_commands[] = {
 	PHPDBG_COMMAND_D(source,  "execute a phpdbginit",                     '<', NULL, "s", 0),
 	PHPDBG_COMMAND_D(export,  "export breaks to a .phpdbginit script",    '>', NULL, "s", PHPDBG_ASYNC_SAFE),
 	PHPDBG_COMMAND_D(sh,   	  "shell a command",                           0 , NULL, "i", 0),
-	PHPDBG_COMMAND_D(quit,    "exit phpdbg",                              'q', NULL, 0, PHPDBG_ASYNC_SAFE),
-	PHPDBG_COMMAND_D(wait,    "wait for other process",                   'W', NULL, 0, 0),
+	PHPDBG_COMMAND_D(quit,    "exit phpdbg",                              'q', NULL, 0, PHPDBG_ASYNC_SAFE | PHPDBG_PROMPT_ONLY),
+	PHPDBG_COMMAND_D(wait,    "wait for other process",                   'W', NULL, "|n", 0),
 	PHPDBG_COMMAND_D(watch,   "set watchpoint",                           'w', phpdbg_watch_commands, "|ss", 0),
 	PHPDBG_COMMAND_D(eol,     "set EOL",                                  'E', NULL, "|s", 0),
+	PHPDBG_COMMAND_D(replay,  "replay captured requests",                  0 , NULL, "|snn", 0),
 	PHPDBG_END_COMMAND
 }; /* }}} */
 
@@ -262,6 +265,11 @@ static void phpdbg_line_init(char *cmd, struct phpdbg_init_state *state TSRMLS_D
 			return;
 		}
 
+		if (PHPDBG_G(breakcmds_def)) {
+			phpdbg_define_breakcmd(cmd TSRMLS_CC);
+			return;
+		}
+
 		zend_try {
 			char *input = phpdbg_read_input(cmd TSRMLS_CC);
 			phpdbg_param_t stack;
@@ -313,6 +321,11 @@ void phpdbg_string_init(char *buffer TSRMLS_DC) {
 	if (state.code) {
 		free(state.code);
 	}
+
+	if (PHPDBG_G(breakcmds_def)) {
+		phpdbg_error("initfailure", "type=\"unterminatedcommands\"", "Command list without \"end\", discarded");
+		phpdbg_discard_breakcmds(TSRMLS_C);
+	}
 }
 
 void phpdbg_try_file_init(char *init_file, size_t init_file_len, zend_bool free_init TSRMLS_DC) /* {{{ */
@@ -335,6 +348,11 @@ void phpdbg_try_file_init(char *init_file, size_t init_file_len, zend_bool free_
 				free(state.code);
 			}
 
+			if (PHPDBG_G(breakcmds_def)) {
+				phpdbg_error("initfailure", "type=\"unterminatedcommands\" file=\"%s\"", "Command list without \"end\" in %s, discarded", init_file);
+				phpdbg_discard_breakcmds(TSRMLS_C);
+			}
+
 			fclose(fp);
 		} else {
 			phpdbg_error("initfailure", "type=\"openfile\" file=\"%s\"", "Failed to open %s for initialization", init_file);
@@ -772,15 +790,20 @@ PHPDBG_COMMAND(ev) /* {{{ */
 	PHPDBG_G(flags) |= PHPDBG_IN_EVAL;
 	zend_try {
 		if (zend_eval_stringl(param->str, param->len,&retval, "eval()'d code" TSRMLS_CC) == SUCCESS) {
+			/* handles to the result may outlive this command */
+			zval *zvp;
+			ALLOC_ZVAL(zvp);
+			INIT_PZVAL_COPY(zvp, &retval);
+
 			phpdbg_xml("<eval %r>");
 			if (PHPDBG_G(flags) & PHPDBG_WRITE_XML) {
-				zval *zvp = &retval;
 				phpdbg_xml_var_dump(&zvp TSRMLS_CC);
+			} else {
+				phpdbg_print_var(zvp TSRMLS_CC);
 			}
-			zend_print_zval_r(&retval, 0 TSRMLS_CC);
 			phpdbg_xml("</eval>");
 			phpdbg_out("\n");
-			zval_dtor(&retval);
+			zval_ptr_dtor(&zvp);
 		}
 	} zend_catch {
 		EG(active_op_array) = orig_op_array;
@@ -1225,6 +1248,7 @@ PHPDBG_COMMAND(clear) /* {{{ */
 	phpdbg_writeln("clear", "functionoplines=\"%d\"", "Function oplines  %d", zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_FUNCTION_OPLINE]));
 	phpdbg_writeln("clear", "methodoplines=\"%d\"", "Method oplines    %d", zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_METHOD_OPLINE]));
 	phpdbg_writeln("clear", "eval=\"%d\"", "Conditionals      %d", zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_COND]));
+	phpdbg_writeln("clear", "patterns=\"%d\"", "Patterns          %d", zend_hash_num_elements(&PHPDBG_G(bp)[PHPDBG_BREAK_PATTERN]));
 
 	phpdbg_clear_breakpoints(TSRMLS_C);
 
@@ -1282,6 +1306,15 @@ int phpdbg_interactive(zend_bool allow_async_unsafe TSRMLS_DC) /* {{{ */
 
 	PHPDBG_G(flags) |= PHPDBG_IS_INTERACTIVE;
 
+	phpdbg_iothread_clear_interrupt(TSRMLS_C);
+
+	phpdbg_replay_pause(1 TSRMLS_CC);
+
+	/* traces logged so far can be looked at while stopped */
+	if (PHPDBG_G(tracelog)) {
+		fflush(PHPDBG_G(tracelog));
+	}
+
 	while (ret == SUCCESS || ret == FAILURE) {
 		if ((PHPDBG_G(flags) & (PHPDBG_IS_STOPPING | PHPDBG_IS_RUNNING)) == PHPDBG_IS_STOPPING) {
 			zend_bailout();
@@ -1291,6 +1324,16 @@ int phpdbg_interactive(zend_bool allow_async_unsafe TSRMLS_DC) /* {{{ */
 			break;
 		}
 
+		phpdbg_io_stats_mark(TSRMLS_C);
+
+		/* lines of a command list are only parsed to be kept, see phpdbg_define_breakcmd() */
+		if (PHPDBG_G(breakcmds_def)) {
+			phpdbg_define_breakcmd(input TSRMLS_CC);
+			phpdbg_destroy_input(&input TSRMLS_CC);
+			PHPDBG_G(req_id) = 0;
+			input = NULL;
+			continue;
+		}
 
 		phpdbg_init_param(&stack, STACK_PARAM);
 
@@ -1353,11 +1396,133 @@ int phpdbg_interactive(zend_bool allow_async_unsafe TSRMLS_DC) /* {{{ */
 
 	PHPDBG_G(flags) &= ~PHPDBG_IS_INTERACTIVE;
 
+	phpdbg_replay_pause(0 TSRMLS_CC);
+
+	/* the client may have sent more than this prompt consumed */
+	if (PHPDBG_G(input).start != PHPDBG_G(input).end) {
+		PHPDBG_G(flags) |= PHPDBG_HAS_PENDING_INPUT;
+	}
+
+	/* values may change from here on, handed out handles would lie */
+	phpdbg_clear_var_handles(TSRMLS_C);
+
 	phpdbg_print_changed_zvals(TSRMLS_C);
 
 	return ret;
 } /* }}} */
 
+/* {{{ answers pipelined commands while the script is running
+ * Called between two oplines whenever input arrived. Commands are taken in order
+ * for as long as they may run ahead of the prompt (see phpdbg_stack_pipelinable),
+ * the first one which may not is left in place for the next prompt. */
+void phpdbg_serve_pipelined(TSRMLS_D) {
+	char *line, *input;
+	size_t len;
+	phpdbg_param_t stack;
+
+	while (!PHPDBG_G(input).held && phpdbg_stdin_line_ready(TSRMLS_C)) {
+		line = phpdbg_consume_stdin_line(&len TSRMLS_CC);
+		input = estrndup(line, len);
+
+		phpdbg_init_param(&stack, STACK_PARAM);
+
+		/* errors are reported once the prompt gets to the command */
+		phpdbg_activate_err_buf(1 TSRMLS_CC);
+		if (phpdbg_do_parse(&stack, input TSRMLS_CC) > 0 || !phpdbg_stack_pipelinable(&stack TSRMLS_CC)) {
+			phpdbg_activate_err_buf(0 TSRMLS_CC);
+			phpdbg_free_err_buf(TSRMLS_C);
+			phpdbg_stack_free(&stack);
+			efree(input);
+			PHPDBG_G(req_id) = 0;
+
+			phpdbg_unconsume_stdin_line(line, len TSRMLS_CC);
+			PHPDBG_G(input).held = 1;
+			break;
+		}
+		phpdbg_free_err_buf(TSRMLS_C);
+
+		phpdbg_io_stats_mark(TSRMLS_C);
+
+		if (phpdbg_stack_execute(&stack, 0 TSRMLS_CC) == FAILURE) {
+			phpdbg_output_err_buf(NULL, "%b", "%b" TSRMLS_CC);
+		}
+
+		phpdbg_activate_err_buf(0 TSRMLS_CC);
+		phpdbg_free_err_buf(TSRMLS_C);
+
+		phpdbg_stack_free(&stack);
+		efree(input);
+		PHPDBG_G(req_id) = 0;
+	}
+
+	if (EG(in_execution)) {
+		phpdbg_restore_frame(TSRMLS_C);
+	}
+
+	/* values may change from here on, handed out handles would lie */
+	phpdbg_clear_var_handles(TSRMLS_C);
+
+	phpdbg_flush_output(TSRMLS_C);
+} /* }}} */
+
+/* {{{ runs the command list of a breakpoint which was hit
+ * The commands were parsed when the list was defined, their output stays buffered until the
+ * list is done. Returns what the command resuming execution (continue, step, ...) returned,
+ * otherwise SUCCESS, or FAILURE when a command failed, and the prompt is entered as usual. */
+static int phpdbg_run_breakcmds(phpdbg_breakbase_t *brake TSRMLS_DC) {
+	phpdbg_breakcmds_t *cmds, *current;
+	/* a command of the list may free brake ("break del", "clear"), so only its id is kept */
+	zend_ulong id = brake->id;
+	int i, ret = SUCCESS;
+
+	if (zend_hash_index_find(&PHPDBG_G(breakcmds), id, (void **) &cmds) == FAILURE) {
+		return SUCCESS;
+	}
+
+	/* the commands run as if they were typed at the prompt */
+	PHPDBG_G(flags) |= PHPDBG_IS_INTERACTIVE;
+
+	for (i = 0; i < cmds->count && ret == SUCCESS; i++) {
+		phpdbg_activate_err_buf(1 TSRMLS_CC);
+
+		if ((ret = phpdbg_stack_execute(&cmds->stacks[i], 1 TSRMLS_CC)) == FAILURE && !(PHPDBG_G(flags) & PHPDBG_IS_STOPPING)) {
+			if (phpdbg_call_register(&cmds->stacks[i] TSRMLS_CC) == SUCCESS) {
+				ret = SUCCESS;
+			} else {
+				phpdbg_output_err_buf(NULL, "%b", "%b" TSRMLS_CC);
+			}
+		}
+
+		phpdbg_activate_err_buf(0 TSRMLS_CC);
+		phpdbg_free_err_buf(TSRMLS_C);
+
+		/* the list may have deleted its own breakpoint, or all of them */
+		if (zend_hash_index_find(&PHPDBG_G(breakcmds), id, (void **) &current) == FAILURE || current != cmds) {
+			break;
+		}
+	}
+
+	PHPDBG_G(flags) &= ~PHPDBG_IS_INTERACTIVE;
+
+	switch (ret) {
+		case PHPDBG_LEAVE:
+		case PHPDBG_FINISH:
+		case PHPDBG_UNTIL:
+		case PHPDBG_NEXT:
+			if (EG(in_execution)) {
+				phpdbg_restore_frame(TSRMLS_C);
+			}
+
+			phpdbg_clear_var_handles(TSRMLS_C);
+
+			phpdbg_print_changed_zvals(TSRMLS_C);
+
+			phpdbg_flush_output(TSRMLS_C);
+	}
+
+	return ret;
+} /* }}} */
+
 void phpdbg_clean(zend_bool full TSRMLS_DC) /* {{{ */
 {
 	/* this is implicitly required */
@@ -1468,7 +1633,6 @@ void phpdbg_execute_ex(zend_op_array *op_array TSRMLS_DC) /* {{{ */
 	zend_bool nested = 0;
 #endif
 	zend_bool original_in_execution = EG(in_execution);
-	HashTable vars;
 
 #if PHP_VERSION_ID < 50500
 	if (EG(exception)) {
@@ -1487,12 +1651,10 @@ void phpdbg_execute_ex(zend_op_array *op_array TSRMLS_DC) /* {{{ */
 zend_vm_enter:
 		execute_data = phpdbg_create_execute_data(EG(active_op_array), 1 TSRMLS_CC);
 	}
-	zend_hash_init(&vars, EG(active_op_array)->last, NULL, NULL, 0);
 #else
 zend_vm_enter:
 	execute_data = phpdbg_create_execute_data(op_array, nested TSRMLS_CC);
 	nested = 1;
-	zend_hash_init(&vars, EG(active_op_array)->last, NULL, NULL, 0);
 #endif
 
 	while (1) {
@@ -1559,7 +1721,7 @@ zend_vm_enter:
 		}
 
 		/* not while in conditionals */
-		phpdbg_print_opline_ex(execute_data, &vars, 0 TSRMLS_CC);
+		phpdbg_print_opline_ex(execute_data, 0 TSRMLS_CC);
 
 		if (PHPDBG_G(flags) & PHPDBG_IS_STEPPING && (PHPDBG_G(flags) & PHPDBG_STEP_OPCODE || execute_data->opline->lineno != PHPDBG_G(last_line))) {
 			PHPDBG_G(flags) &= ~PHPDBG_IS_STEPPING;
@@ -1579,12 +1741,32 @@ zend_vm_enter:
 
 			if ((PHPDBG_G(flags) & PHPDBG_BP_MASK)
 			    && (brake = phpdbg_find_breakpoint(execute_data TSRMLS_CC))
-			    && (brake->type != PHPDBG_BREAK_FILE || execute_data->opline->lineno != PHPDBG_G(last_line))) {
-				phpdbg_hit_breakpoint(brake, 1 TSRMLS_CC);
-				DO_INTERACTIVE(1);
+			    && ((brake->type != PHPDBG_BREAK_FILE && (brake->type != PHPDBG_BREAK_PATTERN || ((phpdbg_breakpattern_t *) brake)->kind != PHPDBG_PATTERN_FILE))
+			     || execute_data->opline->lineno != PHPDBG_G(last_line))) {
+				/* tracepoints log and carry on */
+				if (!zend_hash_num_elements(&PHPDBG_G(tracepoints)) || phpdbg_trace_breakpoint(brake TSRMLS_CC) == FAILURE) {
+					phpdbg_hit_breakpoint(brake, 1 TSRMLS_CC);
+
+					/* command lists ending in continue (or step, until, ...) carry on without a prompt */
+					if (zend_hash_num_elements(&PHPDBG_G(breakcmds))) {
+						switch (phpdbg_run_breakcmds(brake TSRMLS_CC)) {
+							case PHPDBG_LEAVE:
+							case PHPDBG_FINISH:
+							case PHPDBG_UNTIL:
+							case PHPDBG_NEXT:
+								goto next;
+						}
+					}
+
+					DO_INTERACTIVE(1);
+				}
 			}
 		}
 
+		if (PHPDBG_IOTHREAD_INTERRUPTED()) {
+			PHPDBG_G(flags) |= PHPDBG_IS_SIGNALED;
+		}
+
 		if (PHPDBG_G(flags) & PHPDBG_IS_SIGNALED) {
 			PHPDBG_G(flags) &= ~PHPDBG_IS_SIGNALED;
 
@@ -1593,6 +1775,15 @@ zend_vm_enter:
 			DO_INTERACTIVE(1);
 		}
 
+		if (PHPDBG_IOTHREAD_HAS_INPUT()) {
+			PHPDBG_G(flags) |= PHPDBG_HAS_PENDING_INPUT;
+		}
+
+		if (PHPDBG_G(flags) & PHPDBG_HAS_PENDING_INPUT) {
+			PHPDBG_G(flags) &= ~PHPDBG_HAS_PENDING_INPUT;
+			phpdbg_serve_pipelined(TSRMLS_C);
+		}
+
 next:
 
 		PHPDBG_G(last_line) = execute_data->opline->lineno;
@@ -1634,13 +1825,11 @@ next:
 			switch (PHPDBG_G(vmret)) {
 				case 1:
 					EG(in_execution) = original_in_execution;
-					zend_hash_destroy(&vars);
 					return;
 				case 2:
 #if PHP_VERSION_ID < 50500
 					op_array = EG(active_op_array);
 #endif
-					zend_hash_destroy(&vars);
 					goto zend_vm_enter;
 					break;
 				case 3:
@@ -19,16 +19,194 @@
 #include "phpdbg_rinit_hook.h"
 #include "php_ini.h"
 #include "ext/standard/file.h"
+#include "ext/standard/md5.h"
+#include "ext/standard/php_string.h"
+#include "ext/standard/flock_compat.h"
+
+#ifdef HAVE_FNMATCH
+#	include <fnmatch.h>
+#endif
+
+#ifndef _WIN32
+#	include <sys/socket.h>
+#endif
 
 ZEND_DECLARE_MODULE_GLOBALS(phpdbg_webhelper);
 
 PHP_INI_BEGIN()
 	STD_PHP_INI_ENTRY("phpdbg.auth", "", PHP_INI_SYSTEM | PHP_INI_PERDIR, OnUpdateString, auth, zend_phpdbg_webhelper_globals, phpdbg_webhelper_globals)
 	STD_PHP_INI_ENTRY("phpdbg.path", "", PHP_INI_SYSTEM | PHP_INI_PERDIR, OnUpdateString, path, zend_phpdbg_webhelper_globals, phpdbg_webhelper_globals)
+	STD_PHP_INI_ENTRY("phpdbg.capture_file", "", PHP_INI_SYSTEM | PHP_INI_PERDIR, OnUpdateString, capture_file, zend_phpdbg_webhelper_globals, phpdbg_webhelper_globals)
+	STD_PHP_INI_ENTRY("phpdbg.capture_sample", "1", PHP_INI_SYSTEM | PHP_INI_PERDIR, OnUpdateLong, capture_sample, zend_phpdbg_webhelper_globals, phpdbg_webhelper_globals)
+	STD_PHP_INI_ENTRY("phpdbg.capture_uri", "", PHP_INI_SYSTEM | PHP_INI_PERDIR, OnUpdateString, capture_uri, zend_phpdbg_webhelper_globals, phpdbg_webhelper_globals)
+	STD_PHP_INI_ENTRY("phpdbg.capture_header", "", PHP_INI_SYSTEM | PHP_INI_PERDIR, OnUpdateString, capture_header, zend_phpdbg_webhelper_globals, phpdbg_webhelper_globals)
 PHP_INI_END()
 
 static inline void php_phpdbg_webhelper_globals_ctor(zend_phpdbg_webhelper_globals *pg) /* {{{ */
 {
+	pg->static_msg = NULL;
+	pg->static_len = 0;
+	pg->capture_count = 0;
+	pg->capture_ino = -1;
+} /* }}} */
+
+static inline void php_phpdbg_webhelper_globals_dtor(zend_phpdbg_webhelper_globals *pg) /* {{{ */
+{
+	if (pg->static_msg) {
+		pefree(pg->static_msg, 1);
+	}
+} /* }}} */
+
+static void phpdbg_webhelper_write_msg(php_stream *stream, const char *msg, int len TSRMLS_DC) /* {{{ */
+{
+	php_stream_write(stream, (const char *) &len, 4);
+	php_stream_write(stream, msg, len);
+} /* }}} */
+
+#ifdef SCM_RIGHTS
+/* passes fd along a single byte, the peer must not read ahead of it */
+static int phpdbg_webhelper_send_fd(php_stream *stream, int fd TSRMLS_DC) /* {{{ */
+{
+	int sock;
+	char byte = 0, control[CMSG_SPACE(sizeof(int))];
+	struct iovec iov;
+	struct msghdr msg = {0};
+	struct cmsghdr *cmsg;
+
+	if (php_stream_cast(stream, PHP_STREAM_AS_SOCKETD, (void **) &sock, 0) == FAILURE) {
+		return FAILURE;
+	}
+
+	iov.iov_base = &byte;
+	iov.iov_len = 1;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+	return sendmsg(sock, &msg, 0) == 1 ? SUCCESS : FAILURE;
+} /* }}} */
+#endif
+
+/* modules, extensions and system ini don't change within a process */
+static void phpdbg_webhelper_build_static(TSRMLS_D) /* {{{ */
+{
+	smart_str msg = {0};
+	PHP_MD5_CTX context;
+
+	if (PHPDBG_WG(static_msg)) {
+		return;
+	}
+
+	phpdbg_webdata_compress_static(&msg TSRMLS_CC);
+
+	PHP_MD5Init(&context);
+	PHP_MD5Update(&context, (unsigned char *) msg.c, msg.len);
+	PHP_MD5Final(PHPDBG_WG(static_hash), &context);
+
+	PHPDBG_WG(static_msg) = pemalloc(msg.len, 1);
+	memcpy(PHPDBG_WG(static_msg), msg.c, msg.len);
+	PHPDBG_WG(static_len) = msg.len;
+	smart_str_free(&msg);
+} /* }}} */
+
+/* cheapest filters first, the counter only sees requests matching the others */
+static zend_bool phpdbg_webhelper_sample(TSRMLS_D) /* {{{ */
+{
+	if (*PHPDBG_WG(capture_uri)) {
+		const char *uri = SG(request_info).request_uri;
+
+		if (!uri) {
+			return 0;
+		}
+#ifdef HAVE_FNMATCH
+		if (fnmatch(PHPDBG_WG(capture_uri), uri, 0)) {
+#else
+		if (!strstr(uri, PHPDBG_WG(capture_uri))) {
+#endif
+			return 0;
+		}
+	}
+
+	/* "Name" requires the header, "Name: value" also its value */
+	if (*PHPDBG_WG(capture_header)) {
+		char *name, *value, *c;
+		zval *server, **header;
+		int found;
+
+		value = strchr(PHPDBG_WG(capture_header), ':');
+		spprintf(&name, 0, "HTTP_%.*s", value ? (int) (value - PHPDBG_WG(capture_header)) : (int) strlen(PHPDBG_WG(capture_header)), PHPDBG_WG(capture_header));
+		for (c = name; *c; c++) {
+			if (*c == '-') {
+				*c = '_';
+			}
+		}
+		php_strtoupper(name, strlen(name));
+		if (value) {
+			while (*++value == ' ');
+		}
+
+		zend_is_auto_global(ZEND_STRL("_SERVER") TSRMLS_CC);
+		server = PG(http_globals)[TRACK_VARS_SERVER];
+		found = server && zend_hash_find(Z_ARRVAL_P(server), name, strlen(name) + 1, (void **) &header) == SUCCESS && Z_TYPE_PP(header) == IS_STRING && (!value || !strcmp(Z_STRVAL_PP(header), value));
+		efree(name);
+
+		if (!found) {
+			return 0;
+		}
+	}
+
+	return PHPDBG_WG(capture_sample) <= 1 || ++PHPDBG_WG(capture_count) % PHPDBG_WG(capture_sample) == 0;
+} /* }}} */
+
+static void phpdbg_webhelper_write_record(php_stream *stream, char type, const char *msg, int len TSRMLS_DC) /* {{{ */
+{
+	php_stream_write(stream, &type, 1);
+	php_stream_write(stream, (const char *) PHPDBG_WG(static_hash), PHPDBG_WEBDATA_HASH_LEN);
+	phpdbg_webhelper_write_msg(stream, msg, len TSRMLS_CC);
+} /* }}} */
+
+/* appends the request to phpdbg.capture_file, the request itself goes on normally */
+static void phpdbg_webhelper_capture(TSRMLS_D) /* {{{ */
+{
+	php_stream *stream;
+	php_stream_statbuf ssb;
+	smart_str msg = {0};
+
+	phpdbg_webhelper_build_static(TSRMLS_C);
+	phpdbg_webdata_compress_request(&msg, NULL TSRMLS_CC);
+
+	stream = php_stream_open_wrapper(PHPDBG_WG(capture_file), "ab", REPORT_ERRORS, NULL);
+	if (stream == NULL) {
+		smart_str_free(&msg);
+		return;
+	}
+
+	/* other processes append to the same file */
+	php_stream_lock(stream, LOCK_EX);
+
+	if (php_stream_stat(stream, &ssb) == 0) {
+		if (ssb.sb.st_size == 0) {
+			php_stream_write(stream, PHPDBG_WEBDATA_CAPTURE_MAGIC, PHPDBG_WEBDATA_MAGIC_LEN);
+			PHPDBG_WG(capture_ino) = -1;
+		}
+		/* the file may have been rotated since the static record was written */
+		if (PHPDBG_WG(capture_ino) != (long) ssb.sb.st_ino) {
+			phpdbg_webhelper_write_record(stream, PHPDBG_WEBDATA_RECORD_STATIC, PHPDBG_WG(static_msg), PHPDBG_WG(static_len) TSRMLS_CC);
+			PHPDBG_WG(capture_ino) = (long) ssb.sb.st_ino;
+		}
+		phpdbg_webhelper_write_record(stream, PHPDBG_WEBDATA_RECORD_REQUEST, msg.c, msg.len TSRMLS_CC);
+	}
+
+	php_stream_lock(stream, LOCK_UN);
+	php_stream_close(stream);
+	smart_str_free(&msg);
 } /* }}} */
 
 static PHP_MINIT_FUNCTION(phpdbg_webhelper) /* {{{ */
@@ -37,7 +215,7 @@ static PHP_MINIT_FUNCTION(phpdbg_webhelper) /* {{{ */
 		return SUCCESS;
 	}
 
-	ZEND_INIT_MODULE_GLOBALS(phpdbg_webhelper, php_phpdbg_webhelper_globals_ctor, NULL);
+	ZEND_INIT_MODULE_GLOBALS(phpdbg_webhelper, php_phpdbg_webhelper_globals_ctor, php_phpdbg_webhelper_globals_dtor);
 	REGISTER_INI_ENTRIES();
 
 	return SUCCESS;
@@ -49,6 +227,10 @@ static PHP_RINIT_FUNCTION(phpdbg_webhelper) /* {{{ */
 	zval **auth;
 
 	if (!cookies || zend_hash_find(Z_ARRVAL_P(cookies), PHPDBG_NAME "_AUTH_COOKIE", sizeof(PHPDBG_NAME "_AUTH_COOKIE"), (void **) &auth) == FAILURE || Z_STRLEN_PP(auth) != strlen(PHPDBG_WG(auth)) || strcmp(Z_STRVAL_PP(auth), PHPDBG_WG(auth))) {
+		if (*PHPDBG_WG(capture_file) && phpdbg_webhelper_sample(TSRMLS_C)) {
+			phpdbg_webhelper_capture(TSRMLS_C);
+		}
+
 		return SUCCESS;
 	}
 
@@ -60,8 +242,8 @@ static PHP_RINIT_FUNCTION(phpdbg_webhelper) /* {{{ */
 		int err;
 		char *errstr = NULL;
 
-		char *msg = NULL;
-		char msglen[5] = {0};
+		smart_str msg = {0};
+		char hello[PHPDBG_WEBDATA_MAGIC_LEN + PHPDBG_WEBDATA_HASH_LEN], reply;
 
 		tv.tv_sec = 60;
 		tv.tv_usec = 0;
@@ -73,10 +255,43 @@ static PHP_RINIT_FUNCTION(phpdbg_webhelper) /* {{{ */
 			return SUCCESS;
 		}
 
-		phpdbg_webdata_compress(&msg, (int *) msglen TSRMLS_CC);
+		phpdbg_webhelper_build_static(TSRMLS_C);
+
+		memcpy(hello, PHPDBG_WEBDATA_MAGIC, PHPDBG_WEBDATA_MAGIC_LEN);
+		memcpy(hello + PHPDBG_WEBDATA_MAGIC_LEN, PHPDBG_WG(static_hash), PHPDBG_WEBDATA_HASH_LEN);
+		phpdbg_webhelper_write_msg(stream, hello, sizeof(hello) TSRMLS_CC);
+
+		if (php_stream_read(stream, &reply, 1) != 1) {
+			php_stream_close(stream);
+			return SUCCESS;
+		}
+
+		if (reply == PHPDBG_WEBDATA_SEND_STATIC) {
+			phpdbg_webhelper_write_msg(stream, PHPDBG_WG(static_msg), PHPDBG_WG(static_len) TSRMLS_CC);
+		}
 
-		php_stream_write(stream, msglen, 4);
-		php_stream_write(stream, msg, *(int *) msglen);
+#ifdef SCM_RIGHTS
+		/* large bodies are handed over as a descriptor instead of being copied */
+		if (host_len > 7 && !memcmp(host, "unix://", 7)) {
+			int body_fd;
+
+			phpdbg_webdata_compress_request(&msg, &body_fd TSRMLS_CC);
+			phpdbg_webhelper_write_msg(stream, msg.c, msg.len TSRMLS_CC);
+			smart_str_free(&msg);
+
+			if (body_fd != -1) {
+				if (php_stream_read(stream, &reply, 1) != 1 || reply != PHPDBG_WEBDATA_SEND_FD || phpdbg_webhelper_send_fd(stream, body_fd TSRMLS_CC) == FAILURE) {
+					php_stream_close(stream);
+					return SUCCESS;
+				}
+			}
+		} else
+#endif
+		{
+			phpdbg_webdata_compress_request(&msg, NULL TSRMLS_CC);
+			phpdbg_webhelper_write_msg(stream, msg.c, msg.len TSRMLS_CC);
+			smart_str_free(&msg);
+		}
 
 		php_stream_passthru(stream);
 		php_stream_close(stream);
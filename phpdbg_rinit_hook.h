@@ -36,6 +36,15 @@ extern zend_module_entry phpdbg_webhelper_module_entry;
 ZEND_BEGIN_MODULE_GLOBALS(phpdbg_webhelper)
 	char *auth;
 	char *path;
+	char *static_msg;                              /* static part of the request data, built once */
+	int static_len;
+	unsigned char static_hash[PHPDBG_WEBDATA_HASH_LEN];
+	char *capture_file;
+	long capture_sample;
+	char *capture_uri;
+	char *capture_header;
+	long capture_count;                            /* requests matching the filters so far */
+	long capture_ino;                              /* capture file the static record went to, -1 for none */
 ZEND_END_MODULE_GLOBALS(phpdbg_webhelper) /* }}} */
 
 #endif /* PHPDBG_WEBHELPER_H */
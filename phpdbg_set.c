@@ -24,6 +24,7 @@
 #include "phpdbg_utils.h"
 #include "phpdbg_bp.h"
 #include "phpdbg_prompt.h"
+#include "phpdbg_list.h"
 
 ZEND_EXTERN_MODULE_GLOBALS(phpdbg);
 
@@ -37,11 +38,15 @@ const phpdbg_command_t phpdbg_set_commands[] = {
 	PHPDBG_SET_COMMAND_D(colors,       "usage: set colors [<on|off>]",            'C', set_colors,       NULL, "|b", PHPDBG_ASYNC_SAFE),
 #endif
 	PHPDBG_SET_COMMAND_D(oplog,        "usage: set oplog  [<output>]",            'O', set_oplog,        NULL, "|s", 0),
+	PHPDBG_SET_COMMAND_D(trace,        "usage: set trace  [<output>|-]",          'T', set_trace,        NULL, "|s", 0),
 	PHPDBG_SET_COMMAND_D(break,        "usage: set break id [<on|off>]",          'b', set_break,        NULL, "l|b", PHPDBG_ASYNC_SAFE),
 	PHPDBG_SET_COMMAND_D(breaks,       "usage: set breaks [<on|off>]",            'B', set_breaks,       NULL, "|b", PHPDBG_ASYNC_SAFE),
 	PHPDBG_SET_COMMAND_D(quiet,        "usage: set quiet [<on|off>]",             'q', set_quiet,        NULL, "|b", PHPDBG_ASYNC_SAFE),
 	PHPDBG_SET_COMMAND_D(stepping,     "usage: set stepping [<line|op>]",         's', set_stepping,     NULL, "|s", PHPDBG_ASYNC_SAFE),
 	PHPDBG_SET_COMMAND_D(refcount,     "usage: set refcount [<on|off>]",          'r', set_refcount,     NULL, "|b", PHPDBG_ASYNC_SAFE),
+	PHPDBG_SET_COMMAND_D(depth,        "usage: set depth [<levels>]",             'd', set_depth,        NULL, "|n", PHPDBG_ASYNC_SAFE),
+	PHPDBG_SET_COMMAND_D(children,     "usage: set children [<count>]",           'h', set_children,     NULL, "|n", PHPDBG_ASYNC_SAFE),
+	PHPDBG_SET_COMMAND_D(sources,      "usage: set sources [<kilobytes>]",        'S', set_sources,      NULL, "|n", PHPDBG_ASYNC_SAFE),
 	PHPDBG_END_COMMAND
 };
 
@@ -190,6 +195,44 @@ PHPDBG_SET(oplog) /* {{{ */
 	return SUCCESS;
 } /* }}} */
 
+/* tracepoints may log thousands of records per second, they are written out in blocks */
+#define PHPDBG_TRACELOG_BUFFER 65536
+
+PHPDBG_SET(trace) /* {{{ */
+{
+	if (!param || param->type == EMPTY_PARAM) {
+		phpdbg_notice("settrace", "active=\"%s\"", "Tracepoints log to %s", PHPDBG_G(tracelog) ? "a file" : "the console");
+	} else switch (param->type) {
+		case STR_PARAM: {
+			FILE *old = PHPDBG_G(tracelog);
+
+			if (param->len == 1 && *param->str == '-') {
+				PHPDBG_G(tracelog) = NULL;
+			} else if (!(PHPDBG_G(tracelog) = fopen(param->str, "w+"))) {
+				phpdbg_error("settrace", "type=\"openfailure\" file=\"%s\"", "Failed to open %s for tracepoints", param->str);
+				PHPDBG_G(tracelog) = old;
+				break;
+			} else {
+				setvbuf(PHPDBG_G(tracelog), NULL, _IOFBF, PHPDBG_TRACELOG_BUFFER);
+			}
+
+			if (old) {
+				fclose(old);
+			}
+
+			if (PHPDBG_G(tracelog)) {
+				phpdbg_notice("settrace", "file=\"%s\"", "Tracepoints log to %s", param->str);
+			} else {
+				phpdbg_notice("settrace", "file=\"\"", "Tracepoints log to the console");
+			}
+		} break;
+
+		phpdbg_default_switch_case();
+	}
+
+	return SUCCESS;
+} /* }}} */
+
 PHPDBG_SET(quiet) /* {{{ */
 {
 	if (!param || param->type == EMPTY_PARAM) {
@@ -248,3 +291,49 @@ PHPDBG_SET(refcount) /* {{{ */
 
 	return SUCCESS;
 } /* }}} */
+
+PHPDBG_SET(depth) /* {{{ */
+{
+	if (!param || param->type == EMPTY_PARAM) {
+		phpdbg_writeln("setdepth", "depth=\"%d\"", "Variables are dumped %d levels deep (0 is unlimited)", PHPDBG_G(var_depth));
+	} else switch (param->type) {
+		case NUMERIC_PARAM:
+			PHPDBG_G(var_depth) = param->num < 0 ? 0 : param->num;
+			break;
+
+		phpdbg_default_switch_case();
+	}
+
+	return SUCCESS;
+} /* }}} */
+
+PHPDBG_SET(children) /* {{{ */
+{
+	if (!param || param->type == EMPTY_PARAM) {
+		phpdbg_writeln("setchildren", "children=\"%d\"", "Variables are dumped with up to %d children (0 is unlimited)", PHPDBG_G(var_children));
+	} else switch (param->type) {
+		case NUMERIC_PARAM:
+			PHPDBG_G(var_children) = param->num < 0 ? 0 : param->num;
+			break;
+
+		phpdbg_default_switch_case();
+	}
+
+	return SUCCESS;
+} /* }}} */
+
+PHPDBG_SET(sources) /* {{{ */
+{
+	if (!param || param->type == EMPTY_PARAM) {
+		phpdbg_writeln("setsources", "budget=\"%lu\" used=\"%lu\"", "Up to %luKB of listed sources are kept in memory (%luKB in use)", (unsigned long) PHPDBG_G(source_cache).budget / 1024, (unsigned long) PHPDBG_G(source_cache).used / 1024);
+	} else switch (param->type) {
+		case NUMERIC_PARAM:
+			PHPDBG_G(source_cache).budget = param->num < 0 ? 0 : (size_t) param->num * 1024;
+			phpdbg_trim_source_cache(TSRMLS_C);
+			break;
+
+		phpdbg_default_switch_case();
+	}
+
+	return SUCCESS;
+} /* }}} */
@@ -36,6 +36,10 @@ PHPDBG_SET(breaks);
 PHPDBG_SET(quiet);
 PHPDBG_SET(stepping);
 PHPDBG_SET(refcount);
+PHPDBG_SET(depth);
+PHPDBG_SET(children);
+PHPDBG_SET(sources);
+PHPDBG_SET(trace);
 
 extern const phpdbg_command_t phpdbg_set_commands[];
 
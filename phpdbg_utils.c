@@ -504,7 +504,67 @@ PHPDBG_API int phpdbg_parse_variable_with_arg(char *input, size_t len, HashTable
 		return FAILURE;
 }
 
-static int phpdbg_xml_array_element_dump(zval **zv TSRMLS_DC, int num_args, va_list args, zend_hash_key *hash_key) {
+/* {{{ variable handles
+ * Arrays and objects are only dumped up to var_depth levels and var_children
+ * elements each. Whenever something is left out, the container gets a handle,
+ * its remaining children can then be fetched with "print children". Handles
+ * stay valid until execution continues. */
+static zend_ulong phpdbg_var_handle(zval *zv TSRMLS_DC) {
+	zend_ulong handle;
+
+	/* the handle table can't be touched from inside a signal handler */
+	if (PHPDBG_G(flags) & PHPDBG_IN_SIGNAL_HANDLER) {
+		return 0;
+	}
+
+	handle = ++PHPDBG_G(var_handle);
+	Z_ADDREF_P(zv);
+	zend_hash_index_update(&PHPDBG_G(var_handles), handle, &zv, sizeof(zval *), NULL);
+
+	return handle;
+}
+
+PHPDBG_API void phpdbg_clear_var_handles(TSRMLS_D) {
+	zend_hash_clean(&PHPDBG_G(var_handles));
+}
+
+static HashTable *phpdbg_var_children(zval *zv, int *is_temp TSRMLS_DC) {
+	*is_temp = 0;
+
+	switch (Z_TYPE_P(zv)) {
+		case IS_ARRAY:
+			return Z_ARRVAL_P(zv);
+		case IS_OBJECT:
+			return Z_OBJDEBUG_P(zv, *is_temp);
+	}
+
+	return NULL;
+}
+
+static void phpdbg_release_var_children(HashTable *myht, int is_temp) {
+	if (is_temp) {
+		zend_hash_destroy(myht);
+		efree(myht);
+	}
+}
+
+/* returns how many children of a container at the given depth are dumped */
+static int phpdbg_var_shown_children(HashTable *myht, int depth TSRMLS_DC) {
+	int num = myht ? zend_hash_num_elements(myht) : 0;
+
+	if (PHPDBG_G(var_depth) && depth > PHPDBG_G(var_depth)) {
+		return 0;
+	}
+	if (PHPDBG_G(var_children) && num > PHPDBG_G(var_children)) {
+		return PHPDBG_G(var_children);
+	}
+
+	return num;
+} /* }}} */
+
+static void phpdbg_xml_var_dump_ex(zval **zv, int depth TSRMLS_DC);
+
+static void phpdbg_xml_array_element_dump(zval **zv, zend_hash_key *hash_key, int depth TSRMLS_DC) {
 	phpdbg_xml("<element");
 
 	phpdbg_try_access {
@@ -515,19 +575,17 @@ static int phpdbg_xml_array_element_dump(zval **zv TSRMLS_DC, int num_args, va_l
 		}
 	} phpdbg_catch_access {
 		phpdbg_xml(" severity=\"error\" ></element>");
-		return 0;
+		return;
 	} phpdbg_end_try_access();
 
 	phpdbg_xml(">");
 
-	phpdbg_xml_var_dump(zv TSRMLS_CC);
+	phpdbg_xml_var_dump_ex(zv, depth TSRMLS_CC);
 
 	phpdbg_xml("</element>");
-
-	return 0;
 }
 
-static int phpdbg_xml_object_property_dump(zval **zv TSRMLS_DC, int num_args, va_list args, zend_hash_key *hash_key) {
+static void phpdbg_xml_object_property_dump(zval **zv, zend_hash_key *hash_key, int depth TSRMLS_DC) {
 	phpdbg_xml("<property");
 
 	phpdbg_try_access {
@@ -550,26 +608,52 @@ static int phpdbg_xml_object_property_dump(zval **zv TSRMLS_DC, int num_args, va
 		}
 	} phpdbg_catch_access {
 		phpdbg_xml(" severity=\"error\" ></property>");
-		return 0;
+		return;
 	} phpdbg_end_try_access();
 
 	phpdbg_xml(">");
 
-	phpdbg_xml_var_dump(zv TSRMLS_CC);
+	phpdbg_xml_var_dump_ex(zv, depth TSRMLS_CC);
 
 	phpdbg_xml("</property>");
+}
 
-	return 0;
+/* dumps count children starting at offset, the caller guards against recursion */
+static void phpdbg_xml_dump_children(HashTable *myht, zend_bool is_object, long offset, long count, int depth TSRMLS_DC) {
+	HashPosition position;
+	zval **child;
+
+	zend_hash_internal_pointer_reset_ex(myht, &position);
+	while (offset-- > 0 && zend_hash_move_forward_ex(myht, &position) == SUCCESS);
+
+	while (count-- > 0 && zend_hash_get_current_data_ex(myht, (void **) &child, &position) == SUCCESS) {
+		zend_hash_key hash_key;
+		uint key_len;
+
+		if (zend_hash_get_current_key_ex(myht, (char **) &hash_key.arKey, &key_len, &hash_key.h, 0, &position) == HASH_KEY_IS_STRING) {
+			hash_key.nKeyLength = key_len;
+		} else {
+			hash_key.nKeyLength = 0;
+		}
+
+		if (is_object) {
+			phpdbg_xml_object_property_dump(child, &hash_key, depth TSRMLS_CC);
+		} else {
+			phpdbg_xml_array_element_dump(child, &hash_key, depth TSRMLS_CC);
+		}
+
+		zend_hash_move_forward_ex(myht, &position);
+	}
 }
 
 #define COMMON (Z_ISREF_PP(zv) ? "&" : "")
 
-PHPDBG_API void phpdbg_xml_var_dump(zval **zv TSRMLS_DC) {
+static void phpdbg_xml_var_dump_ex(zval **zv, int depth TSRMLS_DC) {
 	HashTable *myht;
 	const char *class_name;
 	zend_uint class_name_len;
-	int (*element_dump_func)(zval** TSRMLS_DC, int, va_list, zend_hash_key*);
-	int is_temp;
+	int is_temp, shown;
+	zend_ulong handle;
 
 	phpdbg_try_access {
 		switch (Z_TYPE_PP(zv)) {
@@ -589,40 +673,36 @@ PHPDBG_API void phpdbg_xml_var_dump(zval **zv TSRMLS_DC) {
 				phpdbg_xml("<string refstatus=\"%s\" length=\"%d\" value=\"%.*s\" />", COMMON, Z_STRLEN_PP(zv), Z_STRLEN_PP(zv), Z_STRVAL_PP(zv));
 				break;
 			case IS_ARRAY:
-				myht = Z_ARRVAL_PP(zv);
-				if (++myht->nApplyCount > 1) {
-					phpdbg_xml("<recursion />");
-					--myht->nApplyCount;
-					break;
-				}
-				phpdbg_xml("<array refstatus=\"%s\" num=\"%d\">", COMMON, zend_hash_num_elements(myht));
-				element_dump_func = phpdbg_xml_array_element_dump;
-				is_temp = 0;
-				goto head_done;
 			case IS_OBJECT:
-				myht = Z_OBJDEBUG_PP(zv, is_temp);
+				myht = phpdbg_var_children(*zv, &is_temp TSRMLS_CC);
 				if (myht && ++myht->nApplyCount > 1) {
 					phpdbg_xml("<recursion />");
 					--myht->nApplyCount;
+					phpdbg_release_var_children(myht, is_temp);
 					break;
 				}
-	
-				if (Z_OBJ_HANDLER(**zv, get_class_name)) {
+
+				shown = phpdbg_var_shown_children(myht, depth TSRMLS_CC);
+				handle = myht && shown < zend_hash_num_elements(myht) ? phpdbg_var_handle(*zv TSRMLS_CC) : 0;
+
+				if (Z_TYPE_PP(zv) == IS_ARRAY) {
+					phpdbg_xml("<array refstatus=\"%s\" num=\"%d\"", COMMON, zend_hash_num_elements(myht));
+				} else if (Z_OBJ_HANDLER(**zv, get_class_name)) {
 					Z_OBJ_HANDLER(**zv, get_class_name)(*zv, &class_name, &class_name_len, 0 TSRMLS_CC);
-					phpdbg_xml("<object refstatus=\"%s\" class=\"%s\" id=\"%d\" num=\"%d\">", COMMON, class_name, Z_OBJ_HANDLE_PP(zv), myht ? zend_hash_num_elements(myht) : 0);
+					phpdbg_xml("<object refstatus=\"%s\" class=\"%s\" id=\"%d\" num=\"%d\"", COMMON, class_name, Z_OBJ_HANDLE_PP(zv), myht ? zend_hash_num_elements(myht) : 0);
 					efree((char*)class_name);
 				} else {
-					phpdbg_xml("<object refstatus=\"%s\" class=\"\" id=\"%d\" num=\"%d\">", COMMON, Z_OBJ_HANDLE_PP(zv), myht ? zend_hash_num_elements(myht) : 0);
+					phpdbg_xml("<object refstatus=\"%s\" class=\"\" id=\"%d\" num=\"%d\"", COMMON, Z_OBJ_HANDLE_PP(zv), myht ? zend_hash_num_elements(myht) : 0);
 				}
-				element_dump_func = phpdbg_xml_object_property_dump;
-head_done:
+				if (handle) {
+					phpdbg_xml(" handle=\"%lu\"", handle);
+				}
+				phpdbg_xml(">");
+
 				if (myht) {
-					zend_hash_apply_with_arguments(myht TSRMLS_CC, (apply_func_args_t) element_dump_func, 0);
+					phpdbg_xml_dump_children(myht, Z_TYPE_PP(zv) == IS_OBJECT, 0, shown, depth + 1 TSRMLS_CC);
 					--myht->nApplyCount;
-					if (is_temp) {
-						zend_hash_destroy(myht);
-						efree(myht);
-					}
+					phpdbg_release_var_children(myht, is_temp);
 				}
 				if (Z_TYPE_PP(zv) == IS_ARRAY) {
 					phpdbg_xml("</array>");
@@ -641,9 +721,196 @@ head_done:
 	} phpdbg_end_try_access();
 }
 
+PHPDBG_API void phpdbg_xml_var_dump(zval **zv TSRMLS_DC) {
+	phpdbg_xml_var_dump_ex(zv, 1 TSRMLS_CC);
+}
+
+/* the key of the child at position, as the text dumps show it */
+static void phpdbg_print_child_key(HashTable *myht, HashPosition *position, zend_bool is_object TSRMLS_DC) {
+	char *key;
+	uint key_len;
+	ulong index;
+
+	if (zend_hash_get_current_key_ex(myht, &key, &key_len, &index, 0, position) == HASH_KEY_IS_STRING) {
+		const char *prop_name = key, *class_name = NULL;
+
+		if (is_object) {
+			zend_unmangle_property_name(key, key_len - 1, &class_name, &prop_name);
+		}
+		if (class_name && class_name[0] != '*') {
+			phpdbg_out("[\"%s:%s\"] => ", class_name, prop_name);
+		} else {
+			phpdbg_out("[\"%s\"] => ", prop_name);
+		}
+	} else {
+		phpdbg_out("[%lu] => ", index);
+	}
+}
+
+/* the text counterpart: one line per child, nested containers only get a handle */
+static void phpdbg_print_children(HashTable *myht, zend_bool is_object, long offset, long count TSRMLS_DC) {
+	HashPosition position;
+	zval **child;
+
+	zend_hash_internal_pointer_reset_ex(myht, &position);
+	while (offset-- > 0 && zend_hash_move_forward_ex(myht, &position) == SUCCESS);
+
+	while (count-- > 0 && zend_hash_get_current_data_ex(myht, (void **) &child, &position) == SUCCESS) {
+		phpdbg_try_access {
+			phpdbg_out("  ");
+			phpdbg_print_child_key(myht, &position, is_object TSRMLS_CC);
+
+			phpdbg_print_flat_zval_r(child, 80 TSRMLS_CC);
+
+			if (Z_TYPE_PP(child) == IS_ARRAY || Z_TYPE_PP(child) == IS_OBJECT) {
+				zend_ulong handle = phpdbg_var_handle(*child TSRMLS_CC);
+
+				if (handle) {
+					phpdbg_out(" (handle %lu)", handle);
+				}
+			}
+		} phpdbg_catch_access {
+			phpdbg_out("???");
+		} phpdbg_end_try_access();
+		phpdbg_out("\n");
+
+		zend_hash_move_forward_ex(myht, &position);
+	}
+}
+
+PHPDBG_API void phpdbg_print_var_children(zval *zv, zend_ulong handle, long offset, long count TSRMLS_DC) {
+	HashTable *myht;
+	int is_temp, num;
+
+	if (!(myht = phpdbg_var_children(zv, &is_temp TSRMLS_CC))) {
+		phpdbg_error("children", "type=\"nochildren\" handle=\"%lu\"", "Handle %lu has no children", handle);
+		return;
+	}
+
+	num = zend_hash_num_elements(myht);
+	if (offset < 0 || offset > num) {
+		offset = num;
+	}
+	if (count <= 0 || count > num - offset) {
+		count = num - offset;
+	}
+
+	if (++myht->nApplyCount > 1) {
+		--myht->nApplyCount;
+		phpdbg_release_var_children(myht, is_temp);
+		phpdbg_error("children", "type=\"recursion\" handle=\"%lu\"", "Handle %lu is being printed already", handle);
+		return;
+	}
+
+	phpdbg_xml("<children %r handle=\"%lu\" offset=\"%ld\" count=\"%ld\" num=\"%d\">", handle, offset, count, num);
+	if (PHPDBG_G(flags) & PHPDBG_WRITE_XML) {
+		phpdbg_xml_dump_children(myht, Z_TYPE_P(zv) == IS_OBJECT, offset, count, 1 TSRMLS_CC);
+	} else {
+		phpdbg_print_children(myht, Z_TYPE_P(zv) == IS_OBJECT, offset, count TSRMLS_CC);
+		if (offset + count < num) {
+			phpdbg_notice("children", "", "%d more, see print children %lu %ld", num - (int) (offset + count), handle, offset + count);
+		}
+	}
+	phpdbg_xml("</children>");
+
+	--myht->nApplyCount;
+	phpdbg_release_var_children(myht, is_temp);
+}
+
+/* one line per child, indented by nesting level; containers beyond var_depth levels or
+ * var_children elements are cut short and get a handle, like in the xml dump */
+static void phpdbg_print_var_ex(zval **zv, int depth TSRMLS_DC) {
+	HashTable *myht = NULL;
+	HashPosition position;
+	zval **child;
+	const char *class_name;
+	zend_uint class_name_len;
+	int is_temp = 0, shown, num, i;
+	zend_ulong handle;
+
+	if (Z_TYPE_PP(zv) == IS_ARRAY || Z_TYPE_PP(zv) == IS_OBJECT) {
+		myht = phpdbg_var_children(*zv, &is_temp TSRMLS_CC);
+	}
+	if (!myht) {
+		phpdbg_print_flat_zval_r(zv, 80 TSRMLS_CC);
+		return;
+	}
+
+	if (++myht->nApplyCount > 1) {
+		phpdbg_out("** RECURSION **");
+		--myht->nApplyCount;
+		phpdbg_release_var_children(myht, is_temp);
+		return;
+	}
+
+	num = zend_hash_num_elements(myht);
+	shown = phpdbg_var_shown_children(myht, depth TSRMLS_CC);
+	handle = shown < num ? phpdbg_var_handle(*zv TSRMLS_CC) : 0;
+
+	if (Z_TYPE_PP(zv) == IS_ARRAY) {
+		phpdbg_out("%sarray(%d) [", COMMON, num);
+	} else if (Z_OBJ_HANDLER(**zv, get_class_name)) {
+		Z_OBJ_HANDLER(**zv, get_class_name)(*zv, &class_name, &class_name_len, 0 TSRMLS_CC);
+		phpdbg_out("%s%s#%u (%d) [", COMMON, class_name, Z_OBJ_HANDLE_PP(zv), num);
+		efree((char*)class_name);
+	} else {
+		phpdbg_out("%sUnknown class#%u (%d) [", COMMON, Z_OBJ_HANDLE_PP(zv), num);
+	}
+
+	if (shown) {
+		phpdbg_out("\n");
+
+		zend_hash_internal_pointer_reset_ex(myht, &position);
+		for (i = 0; i < shown && zend_hash_get_current_data_ex(myht, (void **) &child, &position) == SUCCESS; i++) {
+			phpdbg_out("%*s", depth * 2, "");
+			phpdbg_try_access {
+				phpdbg_print_child_key(myht, &position, Z_TYPE_PP(zv) == IS_OBJECT TSRMLS_CC);
+				phpdbg_print_var_ex(child, depth + 1 TSRMLS_CC);
+			} phpdbg_catch_access {
+				phpdbg_out("???");
+			} phpdbg_end_try_access();
+			phpdbg_out("\n");
+
+			zend_hash_move_forward_ex(myht, &position);
+		}
+
+		if (shown < num) {
+			phpdbg_out("%*s... %d more", depth * 2, "", num - shown);
+			if (handle) {
+				phpdbg_out(", see print children %lu %d", handle, shown);
+			}
+			phpdbg_out("\n");
+		}
+
+		phpdbg_out("%*s]", (depth - 1) * 2, "");
+	} else {
+		phpdbg_out("%s]", num ? "..." : "");
+		if (handle) {
+			phpdbg_out(" (handle %lu)", handle);
+		}
+	}
+
+	--myht->nApplyCount;
+	phpdbg_release_var_children(myht, is_temp);
+}
+
+/* print_r() for the console, limited to var_depth levels and var_children elements per container */
+PHPDBG_API void phpdbg_print_var(zval *zv TSRMLS_DC) {
+	if (Z_TYPE_P(zv) != IS_ARRAY && Z_TYPE_P(zv) != IS_OBJECT) {
+		zend_print_zval_r(zv, 0 TSRMLS_CC);
+		return;
+	}
+
+	phpdbg_print_var_ex(&zv, 1 TSRMLS_CC);
+}
+
+static int phpdbg_print_flat_zval_ex(zval **zv, int len, int depth TSRMLS_DC);
+
 static int phpdbg_print_array_element_dump(zval **zv TSRMLS_DC, int num_args, va_list args, zend_hash_key *hash_key) {
 	int *len = va_arg(args, int *);
 	zend_bool *first = va_arg(args, zend_bool *);
+	int *left = va_arg(args, int *);
+	int depth = va_arg(args, int);
 
 	if (*first) {
 		*first = 0;
@@ -651,7 +918,7 @@ static int phpdbg_print_array_element_dump(zval **zv TSRMLS_DC, int num_args, va
 		*len -= phpdbg_out(", ");
 	}
 
-	if (*len < 0) {
+	if (*len < 0 || !(*left)--) {
 		phpdbg_out("...");
 		return ZEND_HASH_APPLY_STOP;
 	}
@@ -667,7 +934,7 @@ static int phpdbg_print_array_element_dump(zval **zv TSRMLS_DC, int num_args, va
 		return 0;
 	} phpdbg_end_try_access();
 
-	*len = phpdbg_print_flat_zval_r(zv, *len TSRMLS_CC);
+	*len = phpdbg_print_flat_zval_ex(zv, *len, depth + 1 TSRMLS_CC);
 
 	return 0;
 }
@@ -675,6 +942,8 @@ static int phpdbg_print_array_element_dump(zval **zv TSRMLS_DC, int num_args, va
 static int phpdbg_print_object_property_dump(zval **zv TSRMLS_DC, int num_args, va_list args, zend_hash_key *hash_key) {
 	int *len = va_arg(args, int *);
 	zend_bool *first = va_arg(args, zend_bool *);
+	int *left = va_arg(args, int *);
+	int depth = va_arg(args, int);
 
 	if (*first) {
 		*first = 0;
@@ -682,7 +951,7 @@ static int phpdbg_print_object_property_dump(zval **zv TSRMLS_DC, int num_args,
 		*len -= phpdbg_out(", ");
 	}
 
-	if (*len < 0) {
+	if (*len < 0 || !(*left)--) {
 		phpdbg_out("...");
 		return ZEND_HASH_APPLY_STOP;
 	}
@@ -706,21 +975,27 @@ static int phpdbg_print_object_property_dump(zval **zv TSRMLS_DC, int num_args,
 	} phpdbg_end_try_access();
 
 
-	*len = phpdbg_print_flat_zval_r(zv, *len TSRMLS_CC);
+	*len = phpdbg_print_flat_zval_ex(zv, *len, depth + 1 TSRMLS_CC);
 
 	return 0;
 }
 
 #define COMMON (Z_ISREF_PP(zv) ? "&" : "")
 
-PHPDBG_API int phpdbg_print_flat_zval_r(zval **zv, int len TSRMLS_DC) {
+/* flat dumps, e.g. of backtrace arguments, are cut short after len characters, var_children
+ * elements per container and var_depth levels */
+static int phpdbg_print_flat_zval_ex(zval **zv, int len, int depth TSRMLS_DC) {
 	HashTable *myht;
 	const char *class_name;
 	zend_uint class_name_len;
 	int (*element_dump_func)(zval ** TSRMLS_DC, int, va_list, zend_hash_key*);
-	int is_temp;
+	int is_temp, left = PHPDBG_G(var_children) ? PHPDBG_G(var_children) : -1;
 	zend_bool first = 1;
 
+	if (PHPDBG_G(var_depth) && depth > PHPDBG_G(var_depth)) {
+		left = 0;
+	}
+
 	phpdbg_try_access {
 		switch (Z_TYPE_PP(zv)) {
 			case IS_BOOL:
@@ -767,7 +1042,7 @@ PHPDBG_API int phpdbg_print_flat_zval_r(zval **zv, int len TSRMLS_DC) {
 				element_dump_func = phpdbg_print_object_property_dump;
 head_done:
 				if (myht) {
-					zend_hash_apply_with_arguments(myht TSRMLS_CC, (apply_func_args_t) element_dump_func, 2, &len, &first);
+					zend_hash_apply_with_arguments(myht TSRMLS_CC, (apply_func_args_t) element_dump_func, 4, &len, &first, &left, depth);
 					--myht->nApplyCount;
 					if (is_temp) {
 						zend_hash_destroy(myht);
@@ -789,3 +1064,7 @@ head_done:
 	return len;
 }
 
+PHPDBG_API int phpdbg_print_flat_zval_r(zval **zv, int len TSRMLS_DC) {
+	return phpdbg_print_flat_zval_ex(zv, len, 1 TSRMLS_CC);
+}
+
@@ -17,10 +17,23 @@
 */
 
 #include "phpdbg_wait.h"
+#include "phpdbg_webdata_transfer.h"
 #include "phpdbg_prompt.h"
 #include "ext/standard/php_var.h"
 #include "ext/standard/basic_functions.h"
 
+#ifndef _WIN32
+#	include <sys/wait.h>
+#	include <fcntl.h>
+#	include <poll.h>
+#	include <signal.h>
+#	include <sys/socket.h>
+#	include <time.h>
+#	include <unistd.h>
+#else
+#	include "win32/time.h"
+#endif
+
 ZEND_EXTERN_MODULE_GLOBALS(phpdbg);
 
 static void phpdbg_rebuild_http_globals_array(int type, const char *name TSRMLS_DC) {
@@ -43,103 +56,50 @@ static int phpdbg_dearm_autoglobals(zend_auto_global *auto_global TSRMLS_DC) {
 	return ZEND_HASH_APPLY_KEEP;
 }
 
-typedef struct {
-	HashTable *ht[2];
-	HashPosition pos[2];
-} phpdbg_intersect_ptr;
-
-static int phpdbg_array_data_compare(const void *a, const void *b TSRMLS_DC) {
-	Bucket *f, *s;
-	zval result;
-	zval *first, *second;
-
-	f = *((Bucket **) a);
-	s = *((Bucket **) b);
-
-	first = *((zval **) f->pData);
-	second = *((zval **) s->pData);
+static int phpdbg_unregister_unwanted_module(zend_module_entry *mod TSRMLS_DC, int num_args, va_list args, zend_hash_key *hash_key) {
+	HashTable *wanted = va_arg(args, HashTable *);
 
-	if (string_compare_function(&result, first, second TSRMLS_CC) == FAILURE) {
-		return 0;
+	if (!mod->name || !strcmp(PHPDBG_NAME, mod->name) || zend_hash_exists(wanted, hash_key->arKey, hash_key->nKeyLength)) {
+		return ZEND_HASH_APPLY_KEEP;
 	}
 
-	if (Z_LVAL(result) < 0) {
-		return -1;
-	} else if (Z_LVAL(result) > 0) {
-		return 1;
-	}
-
-	return 0;
+	return ZEND_HASH_APPLY_REMOVE;
 }
 
-static void phpdbg_array_intersect_init(phpdbg_intersect_ptr *info, HashTable *ht1, HashTable *ht2 TSRMLS_DC) {
-	info->ht[0] = ht1;
-	info->ht[1] = ht2;
-
-	zend_hash_sort(info->ht[0], zend_qsort, (compare_func_t) phpdbg_array_data_compare, 0 TSRMLS_CC);
-	zend_hash_sort(info->ht[1], zend_qsort, (compare_func_t) phpdbg_array_data_compare, 0 TSRMLS_CC);
-
-	zend_hash_internal_pointer_reset_ex(info->ht[0], &info->pos[0]);
-	zend_hash_internal_pointer_reset_ex(info->ht[1], &info->pos[1]);
+/* whether the system ini of the static part with this hash can be taken from the cache:
+ * the cached diff is against the ini of a fresh startup, so nothing may have been applied since */
+static zend_bool phpdbg_webdata_ini_cached(const unsigned char *hash TSRMLS_DC) {
+	return hash && !PHPDBG_G(webdata).applied && PHPDBG_G(ini_cache).diff && !memcmp(PHPDBG_G(ini_cache).hash, hash, PHPDBG_WEBDATA_HASH_LEN);
 }
 
-/* -1 => first array, 0 => both arrays equal, 1 => second array */
-static int phpdbg_array_intersect(phpdbg_intersect_ptr *info, zval ***ptr) {
-	int ret;
-	zval **zvpp[2];
-	int invalid = !info->ht[0] + !info->ht[1];
-
-	if (invalid > 0) {
-		invalid = !info->ht[0];
-
-		if (zend_hash_get_current_data_ex(info->ht[invalid], (void **) ptr, &info->pos[invalid]) == FAILURE) {
-			*ptr = NULL;
-			return 0;
-		}
-
-		zend_hash_move_forward_ex(info->ht[invalid], &info->pos[invalid]);
-
-		return invalid ? 1 : -1;
+PHPDBG_API void phpdbg_webdata_free_ini_cache(TSRMLS_D) {
+	if (PHPDBG_G(ini_cache).diff) {
+		zend_hash_destroy(PHPDBG_G(ini_cache).diff);
+		free(PHPDBG_G(ini_cache).diff);
+		PHPDBG_G(ini_cache).diff = NULL;
 	}
+}
 
-	if (zend_hash_get_current_data_ex(info->ht[0], (void **) &zvpp[0], &info->pos[0]) == FAILURE) {
-		info->ht[0] = NULL;
-		return phpdbg_array_intersect(info, ptr);
-	}
-	if (zend_hash_get_current_data_ex(info->ht[1], (void **) &zvpp[1], &info->pos[1]) == FAILURE) {
-		info->ht[1] = NULL;
-		return phpdbg_array_intersect(info, ptr);
+/* value must be emalloc'ed and is owned by the entry on success */
+static int phpdbg_webdata_set_ini(zend_ini_entry *ini, char *value, uint value_len TSRMLS_DC) {
+	if (ini->on_modify && ini->on_modify(ini, value, value_len, ini->mh_arg1, ini->mh_arg2, ini->mh_arg3, ZEND_INI_STAGE_ACTIVATE TSRMLS_CC) != SUCCESS) {
+		return FAILURE;
 	}
 
-	ret = zend_binary_zval_strcmp(*zvpp[0], *zvpp[1]);
-
-	if (ret <= 0) {
-		*ptr = zvpp[0];
-		zend_hash_move_forward_ex(info->ht[0], &info->pos[0]);
-	}
-	if (ret >= 0) {
-		*ptr = zvpp[1];
-		zend_hash_move_forward_ex(info->ht[1], &info->pos[1]);
+	if (ini->modified && ini->orig_value != ini->value) {
+		efree(ini->value);
 	}
+	ini->value = value;
+	ini->value_length = value_len;
 
-	return ret;
+	return SUCCESS;
 }
 
-void phpdbg_webdata_decompress(char *msg, int len TSRMLS_DC) {
+/* applies the imported request data and destroys it, hash is the one of its static part (NULL if unknown) */
+static void phpdbg_webdata_apply(zval *zvp, const unsigned char *hash TSRMLS_DC) {
 	zval *free_zv = NULL;
-	zval zv, *zvp = &zv, **zvpp;
-	HashTable *ht;
-	php_unserialize_data_t var_hash;
-
-	PHP_VAR_UNSERIALIZE_INIT(var_hash);
-	if (!php_var_unserialize(&zvp, (const unsigned char **) &msg, (unsigned char *) msg + len, &var_hash TSRMLS_CC)) {
-		PHP_VAR_UNSERIALIZE_DESTROY(var_hash);
-		phpdbg_error("wait", "type=\"invaliddata\" import=\"fail\"", "Malformed serialized was sent to this socket, arborting");
-		return;
-	}
-	PHP_VAR_UNSERIALIZE_DESTROY(var_hash);
-
-	ht = Z_ARRVAL(zv);
+	zval **zvpp;
+	HashTable *ht = Z_ARRVAL_P(zvp);
 
 	/* Reapply symbol table */
 	if (zend_hash_find(ht, "GLOBALS", sizeof("GLOBALS"), (void **) &zvpp) == SUCCESS && Z_TYPE_PP(zvpp) == IS_ARRAY) {
@@ -214,53 +174,50 @@ void phpdbg_webdata_decompress(char *msg, int len TSRMLS_DC) {
 
 	if (zend_hash_find(ht, "modules", sizeof("modules"), (void **) &zvpp) == SUCCESS && Z_TYPE_PP(zvpp) == IS_ARRAY) {
 		HashPosition position;
-		phpdbg_intersect_ptr pos;
 		zval **module;
-		zend_module_entry *mod;
-		HashTable zv_registry;
-
-		/* intersect modules, unregister modules loaded "too much", announce not yet registered modules (phpdbg_notice) */
-
-		zend_hash_init(&zv_registry, zend_hash_num_elements(&module_registry), 0, ZVAL_PTR_DTOR, 0);
-		for (zend_hash_internal_pointer_reset_ex(&module_registry, &position);
-		     zend_hash_get_current_data_ex(&module_registry, (void **) &mod, &position) == SUCCESS;
-		     zend_hash_move_forward_ex(&module_registry, &position)) {
-			if (mod->name) {
-				zval **value = emalloc(sizeof(zval *));
-				MAKE_STD_ZVAL(*value);
-				ZVAL_STRING(*value, mod->name, 1);
-				zend_hash_next_index_insert(&zv_registry, value, sizeof(zval *), NULL);
+		HashTable wanted;
+
+		/* unregister modules loaded "too much", announce not yet registered modules (phpdbg_notice) */
+
+		zend_hash_init(&wanted, zend_hash_num_elements(Z_ARRVAL_PP(zvpp)), NULL, NULL, 0);
+		for (zend_hash_internal_pointer_reset_ex(Z_ARRVAL_PP(zvpp), &position);
+		     zend_hash_get_current_data_ex(Z_ARRVAL_PP(zvpp), (void **) &module, &position) == SUCCESS;
+		     zend_hash_move_forward_ex(Z_ARRVAL_PP(zvpp), &position)) {
+			char *lcname;
+
+			if (Z_TYPE_PP(module) != IS_STRING) {
+				continue;
 			}
-		}
 
-		phpdbg_array_intersect_init(&pos, &zv_registry, Z_ARRVAL_PP(zvpp) TSRMLS_CC);
-		do {
-			int mode = phpdbg_array_intersect(&pos, &module);
-			if (mode < 0) {
-				// loaded module, but not needed
-				if (strcmp(PHPDBG_NAME, Z_STRVAL_PP(module))) {
-					zend_hash_del(&module_registry, Z_STRVAL_PP(module), Z_STRLEN_PP(module) + 1);
-				}
-			} else if (mode > 0) {
+			/* the registry is keyed by lowercased name */
+			lcname = zend_str_tolower_dup(Z_STRVAL_PP(module), Z_STRLEN_PP(module));
+			zend_hash_add_empty_element(&wanted, lcname, Z_STRLEN_PP(module) + 1);
+
+			if (!zend_hash_exists(&module_registry, lcname, Z_STRLEN_PP(module) + 1)) {
 				// not loaded module
 				if (!sapi_module.name || strcmp(sapi_module.name, Z_STRVAL_PP(module))) {
 					phpdbg_notice("wait", "missingmodule=\"%.*s\"", "The module %.*s isn't present in " PHPDBG_NAME ", you still can load via dl /path/to/module/%.*s.so", Z_STRLEN_PP(module), Z_STRVAL_PP(module), Z_STRLEN_PP(module), Z_STRVAL_PP(module));
 				}
 			}
-		} while (module);
+			efree(lcname);
+		}
 
-		zend_hash_clean(&zv_registry);
+		// loaded module, but not needed
+		zend_hash_apply_with_arguments(&module_registry TSRMLS_CC, (apply_func_args_t) phpdbg_unregister_unwanted_module, 1, &wanted);
+
+		zend_hash_destroy(&wanted);
 	}
 
 	if (zend_hash_find(ht, "extensions", sizeof("extensions"), (void **) &zvpp) == SUCCESS && Z_TYPE_PP(zvpp) == IS_ARRAY) {
 		zend_extension *extension;
-		zend_llist_position pos;
+		zend_llist_element *elm, *next;
 		HashPosition hpos;
 		zval **name, key;
 
-		extension = (zend_extension *) zend_llist_get_first_ex(&zend_extensions, &pos);
-		while (extension) {
-			extension = (zend_extension *) zend_llist_get_next_ex(&zend_extensions, &pos);
+		for (elm = zend_extensions.head; elm; elm = next) {
+			/* the element may be unlinked below, so the next one is looked up first */
+			next = elm->next;
+			extension = (zend_extension *) elm->data;
 
 			/* php_serach_array() body should be in some ZEND_API function */
 			for (zend_hash_internal_pointer_reset_ex(Z_ARRVAL_PP(zvpp), &hpos);
@@ -271,9 +228,8 @@ void phpdbg_webdata_decompress(char *msg, int len TSRMLS_DC) {
 				}
 			}
 
-			if (zend_hash_get_current_data_ex(Z_ARRVAL_PP(zvpp), (void **) &zvpp, &hpos) == FAILURE) {
-				/* sigh, breaking the encapsulation, there aren't any functions manipulating the llist at the place of the zend_llist_position */
-				zend_llist_element *elm = pos;
+			if (zend_hash_get_current_data_ex(Z_ARRVAL_PP(zvpp), (void **) &name, &hpos) == FAILURE) {
+				/* sigh, breaking the encapsulation, there aren't any functions manipulating the llist at the place of an element */
 				if (elm->prev) {
 					elm->prev->next = elm->next;
 				} else {
@@ -300,10 +256,13 @@ void phpdbg_webdata_decompress(char *msg, int len TSRMLS_DC) {
 					zend_hash_index_del(Z_ARRVAL_PP(zvpp), Z_LVAL(key));
 				}
 			}
+		}
 
-			for (zend_hash_internal_pointer_reset_ex(Z_ARRVAL_PP(zvpp), &hpos);
-			     zend_hash_get_current_data_ex(Z_ARRVAL_PP(zvpp), (void **) &name, &hpos) == SUCCESS;
-			     zend_hash_move_forward_ex(Z_ARRVAL_PP(zvpp), &hpos)) {
+		/* whatever is left was wanted, but is not loaded */
+		for (zend_hash_internal_pointer_reset_ex(Z_ARRVAL_PP(zvpp), &hpos);
+		     zend_hash_get_current_data_ex(Z_ARRVAL_PP(zvpp), (void **) &name, &hpos) == SUCCESS;
+		     zend_hash_move_forward_ex(Z_ARRVAL_PP(zvpp), &hpos)) {
+			if (Z_TYPE_PP(name) == IS_STRING) {
 				phpdbg_notice("wait", "missingextension=\"%.*s\"", "The Zend extension %.*s isn't present in " PHPDBG_NAME ", you still can load via dl /path/to/extension.so", Z_STRLEN_PP(name), Z_STRVAL_PP(name));
 			}
 		}
@@ -311,11 +270,39 @@ void phpdbg_webdata_decompress(char *msg, int len TSRMLS_DC) {
 
 	zend_ini_deactivate(TSRMLS_C);
 
-	if (zend_hash_find(ht, "systemini", sizeof("systemini"), (void **) &zvpp) == SUCCESS && Z_TYPE_PP(zvpp) == IS_ARRAY) {
+	if (phpdbg_webdata_ini_cached(hash TSRMLS_CC)) {
+		/* same static part as before on the same fresh ini: only the known differences */
+		HashPosition position;
+		char *value, *name;
+		uint name_len;
+		ulong index;
+		zend_ini_entry *original_ini;
+
+		for (zend_hash_internal_pointer_reset_ex(PHPDBG_G(ini_cache).diff, &position);
+		     zend_hash_get_current_data_ex(PHPDBG_G(ini_cache).diff, (void **) &value, &position) == SUCCESS;
+		     zend_hash_move_forward_ex(PHPDBG_G(ini_cache).diff, &position)) {
+			zend_hash_get_current_key_ex(PHPDBG_G(ini_cache).diff, &name, &name_len, &index, 0, &position);
+			if (zend_hash_find(EG(ini_directives), name, name_len, (void **) &original_ini) == SUCCESS) {
+				char *copy = estrdup(value);
+
+				if (phpdbg_webdata_set_ini(original_ini, copy, strlen(copy) TSRMLS_CC) == FAILURE) {
+					efree(copy);
+				}
+			}
+		}
+	} else if (zend_hash_find(ht, "systemini", sizeof("systemini"), (void **) &zvpp) == SUCCESS && Z_TYPE_PP(zvpp) == IS_ARRAY) {
 		HashPosition position;
 		zval **ini_entry;
 		zend_ini_entry *original_ini;
 		zval key;
+		HashTable *diff = NULL;
+
+		/* remember what differs from a fresh startup for the next time this static part comes in */
+		if (hash && !PHPDBG_G(webdata).applied) {
+			phpdbg_webdata_free_ini_cache(TSRMLS_C);
+			diff = malloc(sizeof(HashTable));
+			zend_hash_init(diff, 32, NULL, NULL, 1);
+		}
 
 		for (zend_hash_internal_pointer_reset_ex(Z_ARRVAL_PP(zvpp), &position);
 		     zend_hash_get_current_data_ex(Z_ARRVAL_PP(zvpp), (void**) &ini_entry, &position) == SUCCESS;
@@ -324,12 +311,15 @@ void phpdbg_webdata_decompress(char *msg, int len TSRMLS_DC) {
 			if (Z_TYPE(key) == IS_STRING) {
 				if (Z_TYPE_PP(ini_entry) == IS_STRING) {
 					if (zend_hash_find(EG(ini_directives), Z_STRVAL(key), Z_STRLEN(key) + 1, (void **) &original_ini) == SUCCESS) {
-						if (!original_ini->on_modify || original_ini->on_modify(original_ini, Z_STRVAL_PP(ini_entry), Z_STRLEN_PP(ini_entry), original_ini->mh_arg1, original_ini->mh_arg2, original_ini->mh_arg3, ZEND_INI_STAGE_ACTIVATE TSRMLS_CC) == SUCCESS) {
-							if (original_ini->modified && original_ini->orig_value != original_ini->value) {
-								efree(original_ini->value);
+						/* only touch directives whose value differs */
+						if (original_ini->value && original_ini->value_length == Z_STRLEN_PP(ini_entry) && !memcmp(original_ini->value, Z_STRVAL_PP(ini_entry), Z_STRLEN_PP(ini_entry))) {
+							efree(Z_STRVAL(key));
+							continue;
+						}
+						if (phpdbg_webdata_set_ini(original_ini, Z_STRVAL_PP(ini_entry), Z_STRLEN_PP(ini_entry) TSRMLS_CC) == SUCCESS) {
+							if (diff) {
+								zend_hash_update(diff, Z_STRVAL(key), Z_STRLEN(key) + 1, Z_STRVAL_PP(ini_entry), Z_STRLEN_PP(ini_entry) + 1, NULL);
 							}
-							original_ini->value = Z_STRVAL_PP(ini_entry);
-							original_ini->value_length = Z_STRLEN_PP(ini_entry);
 							Z_TYPE_PP(ini_entry) = IS_NULL; /* don't free the value */
 						}
 					}
@@ -337,6 +327,11 @@ void phpdbg_webdata_decompress(char *msg, int len TSRMLS_DC) {
 				efree(Z_STRVAL(key));
 			}
 		}
+
+		if (diff) {
+			PHPDBG_G(ini_cache).diff = diff;
+			memcpy(PHPDBG_G(ini_cache).hash, hash, PHPDBG_WEBDATA_HASH_LEN);
+		}
 	}
 
 	if (zend_hash_find(ht, "userini", sizeof("userini"), (void **) &zvpp) == SUCCESS && Z_TYPE_PP(zvpp) == IS_ARRAY) {
@@ -357,7 +352,14 @@ void phpdbg_webdata_decompress(char *msg, int len TSRMLS_DC) {
 		}
 	}
 
-	zval_dtor(&zv);
+	if (hash) {
+		memcpy(PHPDBG_G(webdata).hash, hash, PHPDBG_WEBDATA_HASH_LEN);
+	} else {
+		memset(PHPDBG_G(webdata).hash, 0, PHPDBG_WEBDATA_HASH_LEN);
+	}
+	PHPDBG_G(webdata).applied = 1;
+
+	zval_dtor(zvp);
 	if (free_zv) {
 		/* separate freeing to not dtor the symtable too, just the container zval... */
 		efree(free_zv);
@@ -367,77 +369,341 @@ void phpdbg_webdata_decompress(char *msg, int len TSRMLS_DC) {
 	/* ??? */
 }
 
-PHPDBG_COMMAND(wait) /* {{{ */
+void phpdbg_webdata_decompress(char *msg, int len TSRMLS_DC) {
+	zval zv, *zvp = &zv;
+	php_unserialize_data_t var_hash;
+
+	PHP_VAR_UNSERIALIZE_INIT(var_hash);
+	if (!php_var_unserialize(&zvp, (const unsigned char **) &msg, (unsigned char *) msg + len, &var_hash TSRMLS_CC)) {
+		PHP_VAR_UNSERIALIZE_DESTROY(var_hash);
+		phpdbg_error("wait", "type=\"invaliddata\" import=\"fail\"", "Malformed serialized was sent to this socket, arborting");
+		return;
+	}
+	PHP_VAR_UNSERIALIZE_DESTROY(var_hash);
+
+	phpdbg_webdata_apply(&zv, NULL TSRMLS_CC);
+}
+
+/* {{{ sectioned request data, see phpdbg_webdata_transfer.h */
+static int phpdbg_webdata_get_len(const char **p, const char *end, zend_uint *len) {
+	if (end - *p < (ptrdiff_t) sizeof(*len)) {
+		return FAILURE;
+	}
+	memcpy(len, *p, sizeof(*len));
+	*p += sizeof(*len);
+
+	return *len <= (zend_uint) (end - *p) ? SUCCESS : FAILURE;
+}
+
+/* a list becomes a packed array of strings, a map an array of strings by name */
+static int phpdbg_webdata_decode_strings(zval *array, const char *p, const char *end, zend_bool map) {
+	zend_uint len, vlen;
+	const char *key;
+
+	array_init(array);
+
+	while (p < end) {
+		if (phpdbg_webdata_get_len(&p, end, &len) == FAILURE) {
+			return FAILURE;
+		}
+		if (!map) {
+			add_next_index_stringl(array, (char *) p, len, 1);
+			p += len;
+			continue;
+		}
+
+		key = p;
+		p += len;
+		if (phpdbg_webdata_get_len(&p, end, &vlen) == FAILURE) {
+			return FAILURE;
+		}
+		key = estrndup(key, len);
+		add_assoc_stringl_ex(array, (char *) key, len + 1, (char *) p, vlen, 1);
+		efree((char *) key);
+		p += vlen;
+	}
+
+	return SUCCESS;
+}
+
+/* skip_ini leaves out the system ini, for when it is taken from the cache anyway */
+static int phpdbg_webdata_decode(zval *zv, const char *msg, int msglen, zend_bool skip_ini TSRMLS_DC) {
+	const char *p = msg, *end = msg + msglen;
+	zend_uint len;
+	zval *value;
+	char type;
+
+	while (p < end) {
+		type = *p++;
+		if (phpdbg_webdata_get_len(&p, end, &len) == FAILURE) {
+			return FAILURE;
+		}
+
+		switch (type) {
+			case PHPDBG_WEBDATA_SAPI_NAME:
+				add_assoc_stringl(zv, "sapi_name", (char *) p, len, 1);
+				break;
+
+			case PHPDBG_WEBDATA_PHPINFO: {
+				int as_text;
+
+				if (len != sizeof(as_text)) {
+					return FAILURE;
+				}
+				memcpy(&as_text, p, sizeof(as_text));
+				add_assoc_long(zv, "phpinfo_as_text", as_text);
+			} break;
+
+			case PHPDBG_WEBDATA_SYSTEMINI:
+				if (skip_ini) {
+					break;
+				}
+				/* fallthrough */
+			case PHPDBG_WEBDATA_MODULES:
+			case PHPDBG_WEBDATA_EXTENSIONS:
+			case PHPDBG_WEBDATA_USERINI:
+				MAKE_STD_ZVAL(value);
+				if (phpdbg_webdata_decode_strings(value, p, p + len, type == PHPDBG_WEBDATA_SYSTEMINI || type == PHPDBG_WEBDATA_USERINI) == FAILURE) {
+					zval_ptr_dtor(&value);
+					return FAILURE;
+				}
+				add_assoc_zval(zv, type == PHPDBG_WEBDATA_MODULES ? "modules" : type == PHPDBG_WEBDATA_EXTENSIONS ? "extensions" : type == PHPDBG_WEBDATA_SYSTEMINI ? "systemini" : "userini", value);
+				break;
+
+			case PHPDBG_WEBDATA_GLOBALS: {
+				php_unserialize_data_t var_hash;
+				const unsigned char *data = (const unsigned char *) p;
+
+				MAKE_STD_ZVAL(value);
+				PHP_VAR_UNSERIALIZE_INIT(var_hash);
+				if (!php_var_unserialize(&value, &data, data + len, &var_hash TSRMLS_CC)) {
+					PHP_VAR_UNSERIALIZE_DESTROY(var_hash);
+					zval_ptr_dtor(&value);
+					return FAILURE;
+				}
+				PHP_VAR_UNSERIALIZE_DESTROY(var_hash);
+				add_assoc_zval(zv, "GLOBALS", value);
+			} break;
+
+			case PHPDBG_WEBDATA_INPUT:
+				add_assoc_stringl(zv, "input", (char *) p, len, 1);
+				break;
+
+			case PHPDBG_WEBDATA_INPUT_FD:
+				add_assoc_bool(zv, "input_fd", 1);
+				break;
+
+			case PHPDBG_WEBDATA_CWD:
+				add_assoc_stringl(zv, "cwd", (char *) p, len, 1);
+				break;
+		}
+
+		p += len;
+	}
+
+	return SUCCESS;
+} /* }}} */
+
+static int phpdbg_wait_listen(TSRMLS_D) /* {{{ */
 {
 	char *errstr = NULL;
 	struct timeval tv;
+	int err = 0;
+#ifndef _WIN32
+	zend_bool is_unix;
+#endif
+
+	if (PHPDBG_G(socket_server_stream)) {
+		return SUCCESS;
+	}
 
 	tv.tv_sec = 60;
 	tv.tv_usec = 0;
 
-	if (PHPDBG_G(socket_server_stream) == NULL) {
-		int err = 0;
 #ifndef _WIN32
-		zend_bool is_unix = strlen(PHPDBG_G(socket_path)) > 7 && !memcmp("unix://", PHPDBG_G(socket_path), 7);
+	is_unix = strlen(PHPDBG_G(socket_path)) > 7 && !memcmp("unix://", PHPDBG_G(socket_path), 7);
 
-		/* Try to avoid address already in use style errors on UNIX domain sockets */
-		if (is_unix) {
-			unlink(PHPDBG_G(socket_path) + 7);
-		}
+	/* Try to avoid address already in use style errors on UNIX domain sockets */
+	if (is_unix) {
+		unlink(PHPDBG_G(socket_path) + 7);
+	}
 #endif
 
-		PHPDBG_G(socket_server_stream) = php_stream_xport_create(PHPDBG_G(socket_path), strlen(PHPDBG_G(socket_path)), REPORT_ERRORS, STREAM_XPORT_BIND | STREAM_XPORT_LISTEN | STREAM_XPORT_SERVER, NULL, &tv, NULL, &errstr, &err);
-
-		if (PHPDBG_G(socket_server_stream) == NULL) {
-			phpdbg_error("wait", "type=\"nosocket\" import=\"fail\" socket=\"%s\" reason=\"%s\"", "Unable to connect to %s defined by phpdbg.path ini setting (%s)", PHPDBG_G(socket_path), errstr == NULL ? errno ? strerror(errno) : "Unknown error" : errstr);
+	PHPDBG_G(socket_server_stream) = php_stream_xport_create(PHPDBG_G(socket_path), strlen(PHPDBG_G(socket_path)), REPORT_ERRORS, STREAM_XPORT_BIND | STREAM_XPORT_LISTEN | STREAM_XPORT_SERVER, NULL, &tv, NULL, &errstr, &err);
 
-			if (errstr) {
-				efree(errstr);
-			}
+	if (PHPDBG_G(socket_server_stream) == NULL) {
+		phpdbg_error("wait", "type=\"nosocket\" import=\"fail\" socket=\"%s\" reason=\"%s\"", "Unable to connect to %s defined by phpdbg.path ini setting (%s)", PHPDBG_G(socket_path), errstr == NULL ? errno ? strerror(errno) : "Unknown error" : errstr);
 
-			return SUCCESS;
+		if (errstr) {
+			efree(errstr);
 		}
 
+		return FAILURE;
+	}
+
 #ifndef _WIN32
-		if (is_unix) {
-			chmod(PHPDBG_G(socket_path) + 7, 0666);
-		}
+	if (is_unix) {
+		chmod(PHPDBG_G(socket_path) + 7, 0666);
+	}
 #endif
+
+	return SUCCESS;
+} /* }}} */
+
+/* reads one length prefixed message from the webhelper */
+static char *phpdbg_wait_read_msg(int *len TSRMLS_DC) /* {{{ */
+{
+	char msglen[5], *data;
+	int rcvd = 4;
+
+	if (php_stream_read(PHPDBG_G(socket_client_stream), msglen, rcvd) != 4) {
+		return NULL;
+	}
+
+	*len = rcvd = *(int *) msglen;
+	if (rcvd < 0) {
+		return NULL;
+	}
+	data = emalloc(rcvd + 1);
+
+	while (rcvd > 0) {
+		int oldrcvd = rcvd;
+		rcvd -= php_stream_read(PHPDBG_G(socket_client_stream), &(data[*len - rcvd]), rcvd);
+
+		if (oldrcvd == rcvd) {
+			efree(data);
+			return NULL;
+		}
+	}
+
+	return data;
+} /* }}} */
+
+#if PHP_VERSION_ID >= 50600 && defined(SCM_RIGHTS)
+/* asks the webhelper for the request body descriptor and installs it as php://input */
+static int phpdbg_wait_recv_body(TSRMLS_D) /* {{{ */
+{
+	int sock, fd;
+	char reply = PHPDBG_WEBDATA_SEND_FD, byte, control[CMSG_SPACE(sizeof(int))];
+	struct iovec iov;
+	struct msghdr msg = {0};
+	struct cmsghdr *cmsg;
+	ssize_t got;
+
+	/* nothing can be buffered in the stream: the webhelper waits for this reply */
+	if (php_stream_write(PHPDBG_G(socket_client_stream), &reply, 1) != 1 || php_stream_cast(PHPDBG_G(socket_client_stream), PHP_STREAM_AS_SOCKETD, (void **) &sock, 0) == FAILURE) {
+		return FAILURE;
+	}
+
+	iov.iov_base = &byte;
+	iov.iov_len = 1;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	while ((got = recvmsg(sock, &msg, 0)) == -1 && errno == EINTR);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (got != 1 || !cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+		return FAILURE;
 	}
+	memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+
+	if (SG(request_info).request_body) {
+		php_stream_close(SG(request_info).request_body);
+	}
+	SG(request_info).request_body = php_stream_fopen_from_fd(fd, "rb", NULL);
+	if (!SG(request_info).request_body) {
+		close(fd);
+		return FAILURE;
+	}
+	/* the file offset is shared with the webhelper */
+	php_stream_rewind(SG(request_info).request_body);
+
+	return SUCCESS;
+} /* }}} */
+#endif
+
+/* accepts one webhelper connection and imports its request data, tv NULL waits forever */
+static int phpdbg_wait_import(struct timeval *tv TSRMLS_DC) /* {{{ */
+{
+	char *errstr = NULL;
+	int ret = FAILURE;
 
 	if (PHPDBG_G(socket_client_stream)) {
 		php_stream_close(PHPDBG_G(socket_client_stream));
 		PHPDBG_G(socket_client_stream) = NULL;
 	}
 
-	if (php_stream_xport_accept(PHPDBG_G(socket_server_stream), &PHPDBG_G(socket_client_stream), NULL, NULL, NULL, NULL, &tv, &errstr TSRMLS_CC) && PHPDBG_G(socket_client_stream)) {
+	if (php_stream_xport_accept(PHPDBG_G(socket_server_stream), &PHPDBG_G(socket_client_stream), NULL, NULL, NULL, NULL, tv, &errstr TSRMLS_CC) && PHPDBG_G(socket_client_stream)) {
 		phpdbg_error("wait", "type=\"nosocket\" import=\"fail\" socket=\"%s\" reason=\"%s\"", "Unable to connect to %s defined by phpdbg.path ini setting (%s)", PHPDBG_G(socket_path), errstr == NULL ? errno ? strerror(errno) : "Unknown error" : errstr);
 	} else {
-		char msglen[5], *data;
-		int rcvd = 4;
+		char *data, *hash;
+		int len;
 
-		if (php_stream_read(PHPDBG_G(socket_client_stream), msglen, rcvd) != 4) {
+		if (!(data = phpdbg_wait_read_msg(&len TSRMLS_CC))) {
 			goto read_error;
 		}
 
-		rcvd = *(size_t *) msglen;
-		data = emalloc(rcvd);
-
-		do {
-			int oldrcvd = rcvd;
-			rcvd -= php_stream_read(PHPDBG_G(socket_client_stream), &(data[(*(int *) msglen) - rcvd]), rcvd);
+		if (len == PHPDBG_WEBDATA_MAGIC_LEN + PHPDBG_WEBDATA_HASH_LEN && !memcmp(data, PHPDBG_WEBDATA_MAGIC, PHPDBG_WEBDATA_MAGIC_LEN)) {
+			/* the static part is only needed if it differs from the one applied last time */
+			char reply = PHPDBG_WEBDATA_SEND_STATIC;
+			zval zv;
+			int applied;
+			zend_bool skip_ini;
 
-			if (oldrcvd == rcvd) {
+			hash = data + PHPDBG_WEBDATA_MAGIC_LEN;
+			if (PHPDBG_G(webdata).applied && !memcmp(PHPDBG_G(webdata).hash, hash, PHPDBG_WEBDATA_HASH_LEN)) {
+				reply = PHPDBG_WEBDATA_HAVE_STATIC;
+			}
+			if (php_stream_write(PHPDBG_G(socket_client_stream), &reply, 1) != 1) {
 				efree(data);
 				goto read_error;
 			}
-		} while (rcvd > 0);
 
-		phpdbg_webdata_decompress(data, *(int *) msglen TSRMLS_CC);
+			skip_ini = phpdbg_webdata_ini_cached((unsigned char *) hash TSRMLS_CC);
+			array_init(&zv);
+
+			for (applied = reply == PHPDBG_WEBDATA_HAVE_STATIC; applied < 2; applied++) {
+				char *msg;
+				int msglen;
+
+				if (!(msg = phpdbg_wait_read_msg(&msglen TSRMLS_CC))) {
+					zval_dtor(&zv);
+					efree(data);
+					goto read_error;
+				}
+
+				if (phpdbg_webdata_decode(&zv, msg, msglen, skip_ini TSRMLS_CC) == FAILURE) {
+					phpdbg_error("wait", "type=\"invaliddata\" import=\"fail\"", "Malformed data was sent to this socket, aborting");
+					zval_dtor(&zv);
+					efree(msg);
+					efree(data);
+					goto out;
+				}
+				efree(msg);
+			}
+
+			if (zend_hash_exists(Z_ARRVAL(zv), "input_fd", sizeof("input_fd"))) {
+#if PHP_VERSION_ID >= 50600 && defined(SCM_RIGHTS)
+				if (phpdbg_wait_recv_body(TSRMLS_C) == FAILURE)
+#endif
+				{
+					zval_dtor(&zv);
+					efree(data);
+					goto read_error;
+				}
+			}
+
+			phpdbg_webdata_apply(&zv, (unsigned char *) hash TSRMLS_CC);
+		} else {
+			phpdbg_webdata_decompress(data, len TSRMLS_CC);
+		}
 
 		efree(data);
 
-		phpdbg_notice("wait", "import=\"success\"", "Successfully imported request data, stopped before executing");
+		ret = SUCCESS;
 	}
 
 	if (0) {
@@ -447,9 +713,464 @@ read_error:
 		phpdbg_error("wait", "type=\"nosocket\" import=\"fail\" socket=\"%s\" reason=\"%s\"", "Unable to read from %s (%s)", PHPDBG_G(socket_path), "Connection was aborted by client");
 	}
 
+out:
 	if (errstr) {
 		efree(errstr);
 	}
 
+	return ret;
+} /* }}} */
+
+#ifndef _WIN32
+/* {{{ worker pool
+ * wait <n> forks n workers from the fully initialized debugger (.phpdbginit sourced,
+ * breakpoints set, script compiled). Each worker accepts one webhelper request on the
+ * shared listening socket, runs it and exits, the supervisor then forks a fresh one.
+ * A worker takes the console (an fcntl lock, released when it exits) the first time
+ * it has something to say or needs input, so concurrent requests only queue up
+ * behind each other once they stop at a breakpoint. */
+PHPDBG_API void phpdbg_pool_console(TSRMLS_D) {
+	struct flock lock = {0};
+
+	lock.l_type = F_WRLCK;
+	lock.l_whence = SEEK_SET;
+
+	while (fcntl(PHPDBG_G(pool).lock, F_SETLKW, &lock) == -1 && errno == EINTR);
+
+	PHPDBG_G(pool).console = 1;
+
+	/* ^C on a remote console goes to whoever holds it */
+	if ((PHPDBG_G(flags) & PHPDBG_IS_REMOTE) && !(PHPDBG_G(flags) & PHPDBG_IO_THREAD)) {
+		fcntl(PHPDBG_G(io)[PHPDBG_STDIN].fd, F_SETOWN, getpid());
+	}
+}
+
+static void phpdbg_pool_worker(TSRMLS_D) {
+	PHPDBG_G(pool).worker = 1;
+	PHPDBG_G(pool).console = 0;
+	PHPDBG_G(flags) = (PHPDBG_G(flags) & ~PHPDBG_IS_SIGNALED) | PHPDBG_IS_INTERACTIVE;
+
+	zend_try {
+		if (phpdbg_wait_import(NULL TSRMLS_CC) == SUCCESS) {
+			PHPDBG_COMMAND_HANDLER(run)(NULL TSRMLS_CC);
+		}
+	} zend_end_try();
+
+	if (PHPDBG_G(socket_client_stream)) {
+		php_stream_close(PHPDBG_G(socket_client_stream));
+		PHPDBG_G(socket_client_stream) = NULL;
+	}
+	phpdbg_flush_output(TSRMLS_C);
+
+	if (PHPDBG_G(pool).console && (PHPDBG_G(flags) & PHPDBG_IS_REMOTE) && !(PHPDBG_G(flags) & PHPDBG_IO_THREAD)) {
+		fcntl(PHPDBG_G(io)[PHPDBG_STDIN].fd, F_SETOWN, getppid());
+	}
+
+	_exit(0);
+}
+
+static pid_t phpdbg_pool_spawn(TSRMLS_D) {
+	pid_t pid;
+
+	fflush(NULL);
+
+	if ((pid = fork()) == 0) {
+		phpdbg_pool_worker(TSRMLS_C);
+	}
+
+	return pid;
+}
+
+static void phpdbg_pool_supervise(int workers TSRMLS_DC) {
+	pid_t *pids = ecalloc(workers, sizeof(pid_t));
+	time_t *started = ecalloc(workers, sizeof(time_t));
+	int i, running = 0, status;
+	pid_t pid;
+	FILE *lockfile;
+
+	if (!(lockfile = tmpfile())) {
+		phpdbg_error("wait", "type=\"nolock\"", "Unable to create the console lock (%s)", strerror(errno));
+		goto out;
+	}
+	PHPDBG_G(pool).lock = fileno(lockfile);
+
+	for (i = 0; i < workers; i++) {
+		if ((pids[i] = phpdbg_pool_spawn(TSRMLS_C)) > 0) {
+			started[i] = time(NULL);
+			running++;
+		}
+	}
+
+	phpdbg_notice("wait", "workers=\"%d\"", "Started %d workers, waiting for requests (^C stops them)", running);
+	phpdbg_flush_output(TSRMLS_C);
+
+	/* ^C must reach us instead of being taken as a hard interrupt */
+	PHPDBG_G(flags) &= ~(PHPDBG_IS_INTERACTIVE | PHPDBG_IS_SIGNALED);
+
+	while (running && !(PHPDBG_G(flags) & (PHPDBG_IS_SIGNALED | PHPDBG_IS_STOPPING))) {
+		while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+			for (i = 0; i < workers && pids[i] != pid; i++);
+			if (i == workers) {
+				continue;
+			}
+
+			/* don't fork in a loop if workers fail right away */
+			if ((!WIFEXITED(status) || WEXITSTATUS(status)) && time(NULL) == started[i]) {
+				phpdbg_rlog(fileno(stderr), "worker %d failed immediately, respawning in a second", (int) pid);
+				sleep(1);
+			}
+
+			if ((pids[i] = phpdbg_pool_spawn(TSRMLS_C)) > 0) {
+				started[i] = time(NULL);
+			} else {
+				running--;
+			}
+		}
+
+		/* a worker which died while holding the console can't hand ^C back */
+		if ((PHPDBG_G(flags) & PHPDBG_IS_REMOTE) && !(PHPDBG_G(flags) & PHPDBG_IO_THREAD)) {
+			struct flock lock = {0};
+
+			lock.l_type = F_WRLCK;
+			lock.l_whence = SEEK_SET;
+			if (fcntl(PHPDBG_G(pool).lock, F_GETLK, &lock) == 0 && lock.l_type == F_UNLCK) {
+				fcntl(PHPDBG_G(io)[PHPDBG_STDIN].fd, F_SETOWN, getpid());
+			}
+		}
+
+		poll(NULL, 0, 100);
+	}
+
+	PHPDBG_G(flags) &= ~PHPDBG_IS_SIGNALED;
+	PHPDBG_G(flags) |= PHPDBG_IS_INTERACTIVE;
+
+	for (i = 0; i < workers; i++) {
+		if (pids[i] > 0) {
+			kill(pids[i], SIGTERM);
+		}
+	}
+	for (i = 0; i < workers; i++) {
+		if (pids[i] > 0) {
+			while (waitpid(pids[i], &status, 0) == -1 && errno == EINTR);
+		}
+	}
+
+	fclose(lockfile);
+	PHPDBG_G(pool).lock = -1;
+
+	phpdbg_notice("wait", "workers=\"0\"", "Stopped all workers");
+
+out:
+	efree(pids);
+	efree(started);
+} /* }}} */
+#endif
+
+PHPDBG_COMMAND(wait) /* {{{ */
+{
+	struct timeval tv;
+
+	if (phpdbg_wait_listen(TSRMLS_C) == FAILURE) {
+		return SUCCESS;
+	}
+
+	if (param && param->type == NUMERIC_PARAM) {
+#ifndef _WIN32
+		if (param->num <= 0) {
+			phpdbg_error("wait", "type=\"noworkers\"", "The number of workers must be positive");
+			return SUCCESS;
+		}
+
+		if (PHPDBG_G(flags) & PHPDBG_IO_THREAD) {
+			phpdbg_error("wait", "type=\"iothread\"", "Workers cannot share the console with the io thread (-t)");
+			return SUCCESS;
+		}
+
+		if (EG(in_execution)) {
+			phpdbg_error("wait", "type=\"executing\"", "Workers cannot be started while executing");
+			return SUCCESS;
+		}
+
+		/* every worker starts from the compiled script */
+		if (!PHPDBG_G(ops) && PHPDBG_G(exec) && phpdbg_compile(TSRMLS_C) == FAILURE) {
+			phpdbg_error("compile", "type=\"compilefailure\" context=\"%s\"", "Failed to compile %s, cannot run", PHPDBG_G(exec));
+			return SUCCESS;
+		}
+
+		if (!PHPDBG_G(ops)) {
+			phpdbg_error("inactive", "type=\"nocontext\"", "Nothing to execute!");
+			return SUCCESS;
+		}
+
+		phpdbg_pool_supervise(param->num TSRMLS_CC);
+#else
+		phpdbg_error("wait", "type=\"noworkers\"", "Workers are not supported on this platform");
+#endif
+		return SUCCESS;
+	}
+
+	tv.tv_sec = 60;
+	tv.tv_usec = 0;
+
+	if (phpdbg_wait_import(&tv TSRMLS_CC) == SUCCESS) {
+		phpdbg_notice("wait", "import=\"success\"", "Successfully imported request data, stopped before executing");
+	}
+
+	return SUCCESS;
+} /* }}} */
+
+/* {{{ replay
+ * replay <file> runs the requests of a capture file (see phpdbg.capture_file) one after
+ * another. Every run ends with a clean, so the position in the file is kept in
+ * PHPDBG_G(replay), which survives it, and main() calls phpdbg_replay_next() again. */
+PHPDBG_API void phpdbg_replay_free(TSRMLS_D) {
+	if (PHPDBG_G(replay).file) {
+		free(PHPDBG_G(replay).file);
+	}
+	if (PHPDBG_G(replay).statics) {
+		zend_hash_destroy(PHPDBG_G(replay).statics);
+		free(PHPDBG_G(replay).statics);
+	}
+
+	memset(&PHPDBG_G(replay), 0, sizeof(PHPDBG_G(replay)));
+}
+
+/* the prompt is entered (pause) or left, time spent there is not counted for the request */
+PHPDBG_API void phpdbg_replay_pause(zend_bool pause TSRMLS_DC) {
+	struct timeval now;
+	double ms;
+
+	if (!PHPDBG_G(replay).file) {
+		return;
+	}
+
+	gettimeofday(&now, NULL);
+	ms = now.tv_sec * 1000. + now.tv_usec / 1000.;
+
+	if (pause) {
+		if (!PHPDBG_G(replay).paused_since) {
+			PHPDBG_G(replay).paused_since = ms;
+		}
+	} else if (PHPDBG_G(replay).paused_since) {
+		PHPDBG_G(replay).paused += ms - PHPDBG_G(replay).paused_since;
+		PHPDBG_G(replay).paused_since = 0;
+	}
+}
+
+static void phpdbg_replay_end(TSRMLS_D) {
+	phpdbg_notice("replay", "requests=\"%ld\" time=\"%.3F\" paused=\"%.3F\"", "Replayed %ld requests in %.3Fms, not counting %.3Fms at the prompt", PHPDBG_G(replay).count, PHPDBG_G(replay).time, PHPDBG_G(replay).paused);
+
+	phpdbg_replay_free(TSRMLS_C);
+}
+
+/* no record is larger than this, whatever a corrupt length field claims */
+#define PHPDBG_REPLAY_MAX_MSG (64 * 1024 * 1024)
+
+/* reads the message of the record whose header was just read */
+static char *phpdbg_replay_read_msg(php_stream *stream, const char *header, int *len TSRMLS_DC) {
+	php_stream_statbuf ssb;
+	zend_uint msglen;
+	char *msg;
+
+	memcpy(&msglen, header + 1 + PHPDBG_WEBDATA_HASH_LEN, sizeof(msglen));
+	if (msglen > PHPDBG_REPLAY_MAX_MSG) {
+		return NULL;
+	}
+	/* nor than what is left of the file */
+	if (php_stream_stat(stream, &ssb) == 0 && ssb.sb.st_size >= 0 && (off_t) msglen > ssb.sb.st_size - php_stream_tell(stream)) {
+		return NULL;
+	}
+
+	msg = emalloc(msglen + 1);
+	if (php_stream_read(stream, msg, msglen) != msglen) {
+		efree(msg);
+		return NULL;
+	}
+	*len = msglen;
+
+	return msg;
+}
+
+/* imports the request record whose header was just read, together with its static part */
+static int phpdbg_replay_load(php_stream *stream, const char *header TSRMLS_DC) {
+	char static_header[PHPDBG_WEBDATA_RECORD_LEN], *msg, *static_msg = NULL;
+	int len, static_len;
+	off_t *offset;
+	zval zv;
+
+	if (!(msg = phpdbg_replay_read_msg(stream, header, &len TSRMLS_CC))) {
+		return FAILURE;
+	}
+	PHPDBG_G(replay).offset = php_stream_tell(stream);
+
+	if (zend_hash_find(PHPDBG_G(replay).statics, header + 1, PHPDBG_WEBDATA_HASH_LEN, (void **) &offset) == FAILURE
+	 || php_stream_seek(stream, *offset, SEEK_SET) == -1
+	 || php_stream_read(stream, static_header, sizeof(static_header)) != sizeof(static_header)
+	 || !(static_msg = phpdbg_replay_read_msg(stream, static_header, &static_len TSRMLS_CC))) {
+		phpdbg_error("replay", "type=\"nostatic\" request=\"%ld\"", "Request #%ld refers to a static part missing from the capture file, skipping", PHPDBG_G(replay).seen);
+		efree(msg);
+		return FAILURE;
+	}
+
+	array_init(&zv);
+	if (phpdbg_webdata_decode(&zv, static_msg, static_len, phpdbg_webdata_ini_cached((unsigned char *) header + 1 TSRMLS_CC) TSRMLS_CC) == FAILURE || phpdbg_webdata_decode(&zv, msg, len, 0 TSRMLS_CC) == FAILURE) {
+		phpdbg_error("replay", "type=\"invaliddata\" request=\"%ld\"", "Request #%ld is malformed, skipping", PHPDBG_G(replay).seen);
+		zval_dtor(&zv);
+		efree(static_msg);
+		efree(msg);
+		return FAILURE;
+	}
+	efree(static_msg);
+	efree(msg);
+
+	phpdbg_webdata_apply(&zv, (unsigned char *) header + 1 TSRMLS_CC);
+
+	return SUCCESS;
+}
+
+/* runs the next request of the replay, or ends it */
+PHPDBG_API void phpdbg_replay_next(TSRMLS_D) {
+	php_stream *stream;
+	char header[PHPDBG_WEBDATA_RECORD_LEN], *uri = NULL;
+	struct timeval start, end;
+	zend_bool bailout = 0;
+	double time, paused;
+	zval **zvpp;
+
+	stream = php_stream_open_wrapper(PHPDBG_G(replay).file, "rb", REPORT_ERRORS, NULL);
+	if (!stream || php_stream_seek(stream, PHPDBG_G(replay).offset, SEEK_SET) == -1) {
+		goto end;
+	}
+
+	do {
+		off_t offset;
+		zend_uint len;
+
+		if (PHPDBG_G(replay).last && PHPDBG_G(replay).seen >= PHPDBG_G(replay).last) {
+			goto end;
+		}
+		if (php_stream_read(stream, header, sizeof(header)) != sizeof(header)) {
+			goto end;
+		}
+
+		offset = php_stream_tell(stream);
+		memcpy(&len, header + 1 + PHPDBG_WEBDATA_HASH_LEN, sizeof(len));
+
+		if (header[0] == PHPDBG_WEBDATA_RECORD_REQUEST && ++PHPDBG_G(replay).seen >= PHPDBG_G(replay).first) {
+			if (phpdbg_replay_load(stream, header TSRMLS_CC) == SUCCESS) {
+				break;
+			}
+		} else if (header[0] == PHPDBG_WEBDATA_RECORD_STATIC) {
+			offset -= sizeof(header);
+			zend_hash_update(PHPDBG_G(replay).statics, header + 1, PHPDBG_WEBDATA_HASH_LEN, &offset, sizeof(offset), NULL);
+			offset += sizeof(header);
+		}
+
+		PHPDBG_G(replay).offset = offset + len;
+	} while (php_stream_seek(stream, PHPDBG_G(replay).offset, SEEK_SET) == 0);
+
+	php_stream_close(stream);
+
+	if (PG(http_globals)[TRACK_VARS_SERVER] && zend_hash_find(Z_ARRVAL_P(PG(http_globals)[TRACK_VARS_SERVER]), "REQUEST_URI", sizeof("REQUEST_URI"), (void **) &zvpp) == SUCCESS && Z_TYPE_PP(zvpp) == IS_STRING) {
+		uri = estrndup(Z_STRVAL_PP(zvpp), Z_STRLEN_PP(zvpp));
+	}
+
+	paused = PHPDBG_G(replay).paused;
+
+	gettimeofday(&start, NULL);
+	zend_try {
+		PHPDBG_COMMAND_HANDLER(run)(NULL TSRMLS_CC);
+	} zend_catch {
+		bailout = 1;
+	} zend_end_try();
+	gettimeofday(&end, NULL);
+
+	/* the prompt may have been left by a bailout */
+	phpdbg_replay_pause(0 TSRMLS_CC);
+
+	/* time spent at breakpoints is not the request's */
+	time = (end.tv_sec - start.tv_sec) * 1000. + (end.tv_usec - start.tv_usec) / 1000. - (PHPDBG_G(replay).paused - paused);
+	PHPDBG_G(replay).count++;
+	PHPDBG_G(replay).time += time;
+
+	phpdbg_notice("replay", "request=\"%ld\" uri=\"%s\" time=\"%.3F\"", "Request #%ld (%s) took %.3Fms", PHPDBG_G(replay).seen, uri ? uri : "", time);
+	if (uri) {
+		efree(uri);
+	}
+
+	/* the clean after the run brings us back here for the next request */
+	if (bailout) {
+		zend_bailout();
+	}
+
+	/* only reached when there was nothing to run */
+	phpdbg_replay_end(TSRMLS_C);
+	return;
+
+end:
+	if (stream) {
+		php_stream_close(stream);
+	}
+	phpdbg_replay_end(TSRMLS_C);
+} /* }}} */
+
+PHPDBG_COMMAND(replay) /* {{{ */
+{
+	php_stream *stream;
+	char magic[PHPDBG_WEBDATA_MAGIC_LEN];
+
+	/* replay alone stops after the current request */
+	if (!param || param->type == EMPTY_PARAM) {
+		if (!PHPDBG_G(replay).file) {
+			phpdbg_error("replay", "type=\"noreplay\"", "No replay in progress");
+		} else {
+			PHPDBG_G(replay).last = PHPDBG_G(replay).seen;
+			phpdbg_notice("replay", "type=\"stopping\"", "Replay stops after the current request");
+		}
+
+		return SUCCESS;
+	}
+
+	if (PHPDBG_G(replay).file || EG(in_execution)) {
+		phpdbg_error("replay", "type=\"executing\"", "Cannot replay while executing");
+		return SUCCESS;
+	}
+
+	if (!PHPDBG_G(ops) && !PHPDBG_G(exec)) {
+		phpdbg_error("inactive", "type=\"nocontext\"", "Nothing to execute!");
+		return SUCCESS;
+	}
+
+	if (param->next && (param->next->num < 1 || (param->next->next && param->next->next->num < param->next->num))) {
+		phpdbg_error("replay", "type=\"invalidrange\"", "Requests are numbered from 1 and the range must not be empty");
+		return SUCCESS;
+	}
+
+	stream = php_stream_open_wrapper(param->str, "rb", REPORT_ERRORS, NULL);
+	if (!stream) {
+		phpdbg_error("replay", "type=\"openfailure\" file=\"%s\"", "Could not open capture file %s", param->str);
+		return SUCCESS;
+	}
+	if (php_stream_read(stream, magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, PHPDBG_WEBDATA_CAPTURE_MAGIC, sizeof(magic))) {
+		phpdbg_error("replay", "type=\"invalidfile\" file=\"%s\"", "%s is not a capture file", param->str);
+		php_stream_close(stream);
+		return SUCCESS;
+	}
+	php_stream_close(stream);
+
+	PHPDBG_G(replay).file = strdup(param->str);
+	PHPDBG_G(replay).offset = sizeof(magic);
+	PHPDBG_G(replay).first = 1;
+	if (param->next) {
+		PHPDBG_G(replay).first = param->next->num;
+		if (param->next->next) {
+			PHPDBG_G(replay).last = param->next->next->num;
+		}
+	}
+	PHPDBG_G(replay).statics = malloc(sizeof(HashTable));
+	zend_hash_init(PHPDBG_G(replay).statics, 8, NULL, NULL, 1);
+
+	phpdbg_replay_next(TSRMLS_C);
+
 	return SUCCESS;
 } /* }}} */
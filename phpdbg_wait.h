@@ -23,7 +23,27 @@
 #include "phpdbg.h"
 
 PHPDBG_COMMAND(wait);
+PHPDBG_COMMAND(replay);
 
 void phpdbg_webdata_decompress(char *msg, int len TSRMLS_DC);
 
+PHPDBG_API void phpdbg_webdata_free_ini_cache(TSRMLS_D);
+
+PHPDBG_API void phpdbg_replay_next(TSRMLS_D);
+PHPDBG_API void phpdbg_replay_free(TSRMLS_D);
+PHPDBG_API void phpdbg_replay_pause(zend_bool pause TSRMLS_DC);
+
+#ifndef _WIN32
+PHPDBG_API void phpdbg_pool_console(TSRMLS_D);
+
+/* workers of a pool (wait <n>) must hold the console before using it */
+#	define PHPDBG_POOL_CONSOLE() do { \
+		if (UNEXPECTED(PHPDBG_G(pool).worker) && !PHPDBG_G(pool).console) { \
+			phpdbg_pool_console(TSRMLS_C); \
+		} \
+	} while (0)
+#else
+#	define PHPDBG_POOL_CONSOLE()
+#endif
+
 #endif /* PHPDBG_WAIT_H */
@@ -19,71 +19,48 @@
 #include "phpdbg_webdata_transfer.h"
 #include "ext/standard/php_var.h"
 
-PHPDBG_API void phpdbg_webdata_compress(char **msg, int *len TSRMLS_DC) {
-	zval array;
-	HashTable *ht;
-	/* I really need to change that to an array of zvals... */
-	zval zv1 = {{0}}, *zvp1 = &zv1;
-	zval zv2 = {{0}}, *zvp2 = &zv2;
-	zval zv3 = {{0}}, *zvp3 = &zv3;
-	zval zv4 = {{0}}, *zvp4 = &zv4;
-	zval zv5 = {{0}}, *zvp5 = &zv5;
-	zval zv6 = {{0}}, *zvp6 = &zv6;
-	zval zv7 = {{0}}, *zvp7 = &zv7;
-	zval zv8 = {{0}}, *zvp8 = &zv8;
-	zval zv9 = {{0}}, *zvp9 = &zv9;
-
-	array_init(&array);
-	ht = Z_ARRVAL(array);
+static void phpdbg_webdata_append_len(smart_str *buf, size_t len) {
+	zend_uint len32 = (zend_uint) len;
 
-	/* fetch superglobals */
-	{
-		zend_is_auto_global(ZEND_STRL("GLOBALS") TSRMLS_CC);
-		/* might be JIT */
-		zend_is_auto_global(ZEND_STRL("_ENV") TSRMLS_CC);
-		zend_is_auto_global(ZEND_STRL("_SERVER") TSRMLS_CC);
-		zend_is_auto_global(ZEND_STRL("_REQUEST") TSRMLS_CC);
-		array_init(&zv1);
-		zend_hash_copy(Z_ARRVAL(zv1), &EG(symbol_table), NULL, (void *) NULL, sizeof(zval *));
-		Z_ARRVAL(zv1)->pDestructor = NULL; /* we're operating on a copy! Don't double free zvals */
-		zend_hash_del(Z_ARRVAL(zv1), "GLOBALS", sizeof("GLOBALS")); /* do not use the reference to itself in json */
-		zend_hash_add(ht, "GLOBALS", sizeof("GLOBALS"), &zvp1, sizeof(zval *), NULL);
-	}
+	smart_str_appendl(buf, (const char *) &len32, sizeof(len32));
+}
 
-#if PHP_VERSION_ID >= 50600
-	/* save php://input */
-	{
-		php_stream *stream;
-		int len;
-		char *contents;
+static void phpdbg_webdata_append_string(smart_str *buf, const char *str, size_t len) {
+	phpdbg_webdata_append_len(buf, len);
+	smart_str_appendl(buf, str, len);
+}
 
-		stream = php_stream_temp_create_ex(TEMP_STREAM_DEFAULT, SAPI_POST_BLOCK_SIZE, PG(upload_tmp_dir));
-		if ((len = php_stream_copy_to_mem(stream, &contents, PHP_STREAM_COPY_ALL, 0)) > 0) {
-			ZVAL_STRINGL(&zv2, contents, len, 0);
-		} else {
-			ZVAL_EMPTY_STRING(&zv2);
-		}
-		Z_SET_REFCOUNT(zv2, 2);
-		zend_hash_add(ht, "input", sizeof("input"), &zvp2, sizeof(zval *), NULL);
-	}
-#endif
+/* returns the offset to pass to phpdbg_webdata_end_section() once the data is appended */
+static size_t phpdbg_webdata_begin_section(smart_str *buf, char type) {
+	smart_str_appendc(buf, type);
+	phpdbg_webdata_append_len(buf, 0);
+
+	return buf->len;
+}
+
+static void phpdbg_webdata_end_section(smart_str *buf, size_t offset) {
+	zend_uint len32 = (zend_uint) (buf->len - offset);
+
+	memcpy(buf->c + offset - sizeof(len32), &len32, sizeof(len32));
+}
+
+PHPDBG_API void phpdbg_webdata_compress_static(smart_str *buf TSRMLS_DC) {
+	size_t section;
 
 	/* change sapi name */
-	{
-		if (sapi_module.name) {
-			ZVAL_STRING(&zv6, sapi_module.name, 0);
-		} else {
-			Z_TYPE(zv6) = IS_NULL;
-		}
-		Z_SET_REFCOUNT(zv6, 2);
-		zend_hash_add(ht, "sapi_name", sizeof("sapi_name"), &zvp6, sizeof(zval *), NULL);
+	if (sapi_module.name) {
+		section = phpdbg_webdata_begin_section(buf, PHPDBG_WEBDATA_SAPI_NAME);
+		smart_str_appends(buf, sapi_module.name);
+		phpdbg_webdata_end_section(buf, section);
 	}
 
 	/* print phpinfo() as text? */
 	{
-		Z_LVAL(zv9) = sapi_module.phpinfo_as_text;
-		Z_TYPE(zv9) = IS_LONG;
-		zend_hash_add(ht, "phpinfo_as_text", sizeof("phpinfo_as_text"), &zvp9, sizeof(zval *), NULL);
+		int as_text = sapi_module.phpinfo_as_text;
+
+		section = phpdbg_webdata_begin_section(buf, PHPDBG_WEBDATA_PHPINFO);
+		smart_str_appendl(buf, (const char *) &as_text, sizeof(as_text));
+		phpdbg_webdata_end_section(buf, section);
 	}
 
 	/* handle modules / extensions */
@@ -93,44 +70,21 @@ PHPDBG_API void phpdbg_webdata_compress(char **msg, int *len TSRMLS_DC) {
 		zend_extension *extension;
 		zend_llist_position pos;
 
-		array_init(&zv7);
+		section = phpdbg_webdata_begin_section(buf, PHPDBG_WEBDATA_MODULES);
 		for (zend_hash_internal_pointer_reset_ex(&module_registry, &position);
 		     zend_hash_get_current_data_ex(&module_registry, (void**) &module, &position) == SUCCESS;
 		     zend_hash_move_forward_ex(&module_registry, &position)) {
-			zval **value = emalloc(sizeof(zval *));
-			ALLOC_ZVAL(*value);
-			ZVAL_STRING(*value, module->name, 1);
-			zend_hash_next_index_insert(Z_ARRVAL(zv7), value, sizeof(zval *), NULL);
+			phpdbg_webdata_append_string(buf, module->name, strlen(module->name));
 		}
-		zend_hash_add(ht, "modules", sizeof("modules"), &zvp7, sizeof(zval *), NULL);
+		phpdbg_webdata_end_section(buf, section);
 
-		array_init(&zv8);
+		section = phpdbg_webdata_begin_section(buf, PHPDBG_WEBDATA_EXTENSIONS);
 		extension = (zend_extension *) zend_llist_get_first_ex(&zend_extensions, &pos);
 		while (extension) {
-			zval **value = emalloc(sizeof(zval *));
-			ALLOC_ZVAL(*value);
-			ZVAL_STRING(*value, extension->name, 1);
-			zend_hash_next_index_insert(Z_ARRVAL(zv8), value, sizeof(zval *), NULL);
+			phpdbg_webdata_append_string(buf, extension->name, strlen(extension->name));
 			extension = (zend_extension *) zend_llist_get_next_ex(&zend_extensions, &pos);
 		}
-		zend_hash_add(ht, "extensions", sizeof("extensions"), &zvp8, sizeof(zval *), NULL);
-	}
-
-	/* switch cwd */
-	if (SG(options) & SAPI_OPTION_NO_CHDIR) {
-		char *ret = NULL;
-		char path[MAXPATHLEN];
-
-#if HAVE_GETCWD
-		ret = VCWD_GETCWD(path, MAXPATHLEN);
-#elif HAVE_GETWD
-		ret = VCWD_GETWD(path);
-#endif
-		if (ret) {
-			ZVAL_STRING(&zv5, path, 1);
-			Z_SET_REFCOUNT(zv5, 1);
-			zend_hash_add(ht, "cwd", sizeof("cwd"), &zvp5, sizeof(zval *), NULL);
-		}
+		phpdbg_webdata_end_section(buf, section);
 	}
 
 	/* get system ini entries */
@@ -138,29 +92,104 @@ PHPDBG_API void phpdbg_webdata_compress(char **msg, int *len TSRMLS_DC) {
 		HashPosition position;
 		zend_ini_entry *ini_entry;
 
-		array_init(&zv3);
+		section = phpdbg_webdata_begin_section(buf, PHPDBG_WEBDATA_SYSTEMINI);
 		for (zend_hash_internal_pointer_reset_ex(EG(ini_directives), &position);
 		     zend_hash_get_current_data_ex(EG(ini_directives), (void**) &ini_entry, &position) == SUCCESS;
 		     zend_hash_move_forward_ex(EG(ini_directives), &position)) {
-			zval **value = emalloc(sizeof(zval *));
 			if (ini_entry->modified) {
 				if (!ini_entry->orig_value) {
-					efree(value);
 					continue;
 				}
-				ALLOC_ZVAL(*value);
-				ZVAL_STRINGL(*value, ini_entry->orig_value, ini_entry->orig_value_length, 1);
+				phpdbg_webdata_append_string(buf, ini_entry->name, ini_entry->name_length - 1);
+				phpdbg_webdata_append_string(buf, ini_entry->orig_value, ini_entry->orig_value_length);
 			} else {
 				if (!ini_entry->value) {
-					efree(value);
 					continue;
 				}
-				ALLOC_ZVAL(*value);
-				ZVAL_STRINGL(*value, ini_entry->value, ini_entry->value_length, 1);
+				phpdbg_webdata_append_string(buf, ini_entry->name, ini_entry->name_length - 1);
+				phpdbg_webdata_append_string(buf, ini_entry->value, ini_entry->value_length);
 			}
-			zend_hash_add(Z_ARRVAL(zv3), ini_entry->name, ini_entry->name_length, value, sizeof(zval *), NULL);
 		}
-		zend_hash_add(ht, "systemini", sizeof("systemini"), &zvp3, sizeof(zval *), NULL);
+		phpdbg_webdata_end_section(buf, section);
+	}
+}
+
+PHPDBG_API void phpdbg_webdata_compress_request(smart_str *buf, int *body_fd TSRMLS_DC) {
+	size_t section;
+
+	/* fetch superglobals */
+	{
+		zval globals, *globalsptr = &globals;
+		php_serialize_data_t var_hash;
+
+		zend_is_auto_global(ZEND_STRL("GLOBALS") TSRMLS_CC);
+		/* might be JIT */
+		zend_is_auto_global(ZEND_STRL("_ENV") TSRMLS_CC);
+		zend_is_auto_global(ZEND_STRL("_SERVER") TSRMLS_CC);
+		zend_is_auto_global(ZEND_STRL("_REQUEST") TSRMLS_CC);
+		array_init(&globals);
+		zend_hash_copy(Z_ARRVAL(globals), &EG(symbol_table), NULL, (void *) NULL, sizeof(zval *));
+		Z_ARRVAL(globals)->pDestructor = NULL; /* we're operating on a copy! Don't double free zvals */
+		zend_hash_del(Z_ARRVAL(globals), "GLOBALS", sizeof("GLOBALS")); /* do not use the reference to itself in json */
+
+		section = phpdbg_webdata_begin_section(buf, PHPDBG_WEBDATA_GLOBALS);
+		PHP_VAR_SERIALIZE_INIT(var_hash);
+		php_var_serialize(buf, &globalsptr, &var_hash TSRMLS_CC);
+		PHP_VAR_SERIALIZE_DESTROY(var_hash);
+		phpdbg_webdata_end_section(buf, section);
+
+		zval_dtor(&globals);
+	}
+
+	if (body_fd) {
+		*body_fd = -1;
+	}
+
+#if PHP_VERSION_ID >= 50600
+	/* save php://input, straight into the message unless it can be handed over as a file */
+	if (SG(request_info).request_body && body_fd) {
+		php_stream *body = SG(request_info).request_body;
+
+		/* smaller bodies are still in memory, casting would spill them into a file first */
+		php_stream_seek(body, 0, SEEK_END);
+		if (php_stream_tell(body) > SAPI_POST_BLOCK_SIZE && php_stream_cast(body, PHP_STREAM_AS_FD, (void **) body_fd, 0) == SUCCESS) {
+			section = phpdbg_webdata_begin_section(buf, PHPDBG_WEBDATA_INPUT_FD);
+			phpdbg_webdata_end_section(buf, section);
+		} else {
+			*body_fd = -1;
+		}
+		php_stream_rewind(body);
+	}
+	if (SG(request_info).request_body && (!body_fd || *body_fd == -1)) {
+		size_t got, newlen;
+
+		section = phpdbg_webdata_begin_section(buf, PHPDBG_WEBDATA_INPUT);
+		php_stream_rewind(SG(request_info).request_body);
+		do {
+			smart_str_alloc(buf, SAPI_POST_BLOCK_SIZE, 0);
+			got = php_stream_read(SG(request_info).request_body, buf->c + buf->len, SAPI_POST_BLOCK_SIZE);
+			buf->len += got;
+		} while (got > 0);
+		php_stream_rewind(SG(request_info).request_body);
+		phpdbg_webdata_end_section(buf, section);
+	}
+#endif
+
+	/* switch cwd */
+	if (SG(options) & SAPI_OPTION_NO_CHDIR) {
+		char *ret = NULL;
+		char path[MAXPATHLEN];
+
+#if HAVE_GETCWD
+		ret = VCWD_GETCWD(path, MAXPATHLEN);
+#elif HAVE_GETWD
+		ret = VCWD_GETWD(path);
+#endif
+		if (ret) {
+			section = phpdbg_webdata_begin_section(buf, PHPDBG_WEBDATA_CWD);
+			smart_str_appends(buf, path);
+			phpdbg_webdata_end_section(buf, section);
+		}
 	}
 
 	/* get perdir ini entries */
@@ -168,34 +197,16 @@ PHPDBG_API void phpdbg_webdata_compress(char **msg, int *len TSRMLS_DC) {
 		HashPosition position;
 		zend_ini_entry *ini_entry;
 
-		array_init(&zv4);
+		section = phpdbg_webdata_begin_section(buf, PHPDBG_WEBDATA_USERINI);
 		for (zend_hash_internal_pointer_reset_ex(EG(modified_ini_directives), &position);
 		     zend_hash_get_current_data_ex(EG(modified_ini_directives), (void**) &ini_entry, &position) == SUCCESS;
 		     zend_hash_move_forward_ex(EG(modified_ini_directives), &position)) {
-			zval **value = emalloc(sizeof(zval *));
 			if (!ini_entry->value) {
-				efree(value);
 				continue;
 			}
-			ALLOC_ZVAL(*value);
-			ZVAL_STRINGL(*value, ini_entry->value, ini_entry->value_length, 1);
-			zend_hash_add(Z_ARRVAL(zv4), ini_entry->name, ini_entry->name_length, value, sizeof(zval *), NULL);
+			phpdbg_webdata_append_string(buf, ini_entry->name, ini_entry->name_length - 1);
+			phpdbg_webdata_append_string(buf, ini_entry->value, ini_entry->value_length);
 		}
-		zend_hash_add(ht, "userini", sizeof("userini"), &zvp4, sizeof(zval *), NULL);
+		phpdbg_webdata_end_section(buf, section);
 	}
-
-	/* encode data */
-	{
-		php_serialize_data_t var_hash;
-		smart_str buf = {0};
-		zval *arrayptr = &array;
-
-		PHP_VAR_SERIALIZE_INIT(var_hash);
-		php_var_serialize(&buf, &arrayptr, &var_hash TSRMLS_CC);
-		PHP_VAR_SERIALIZE_DESTROY(var_hash);
-		*msg = buf.c;
-		*len = buf.len;
-	}
-
-	zval_dtor(&array);
 }
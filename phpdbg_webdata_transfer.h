@@ -21,7 +21,51 @@
 
 #include "zend.h"
 #include "phpdbg.h"
+#include "ext/standard/php_smart_str.h"
 
-PHPDBG_API void phpdbg_webdata_compress(char **msg, int *len TSRMLS_DC);
+/* {{{ wire format
+ * Every message is a 32 bit length followed by that many bytes. The webhelper opens
+ * with a hello (magic + hash of the static part), phpdbg replies with a single byte
+ * telling whether it already applied that static part, which is then only sent if
+ * needed, followed by the request part. Both parts are a sequence of sections: a type
+ * byte, a 32 bit length and the data. Lists are length prefixed strings, maps are
+ * length prefixed key/value pairs. Unknown sections are skipped.
+ * Over a UNIX socket a body that already lives in a file is not copied: the request
+ * part only carries an empty INPUT_FD section, phpdbg answers SEND_FD once it read the
+ * request part and the webhelper passes the descriptor with SCM_RIGHTS on a single byte. */
+#define PHPDBG_WEBDATA_MAGIC     "\0PW2" /* a serialized array (the old format) never starts with \0 */
+#define PHPDBG_WEBDATA_MAGIC_LEN 4
+#define PHPDBG_WEBDATA_HASH_LEN  16 /* md5 */
+
+#define PHPDBG_WEBDATA_HAVE_STATIC 'H'
+#define PHPDBG_WEBDATA_SEND_STATIC 'S'
+#define PHPDBG_WEBDATA_SEND_FD     'F' /* after the request part: pass the body descriptor now */
+
+/* static part, once per process of the webhelper */
+#define PHPDBG_WEBDATA_SAPI_NAME   's' /* string */
+#define PHPDBG_WEBDATA_PHPINFO     't' /* 32 bit phpinfo_as_text */
+#define PHPDBG_WEBDATA_MODULES     'm' /* list */
+#define PHPDBG_WEBDATA_EXTENSIONS  'e' /* list */
+#define PHPDBG_WEBDATA_SYSTEMINI   'i' /* map */
+
+/* request part */
+#define PHPDBG_WEBDATA_GLOBALS     'g' /* serialized symbol table */
+#define PHPDBG_WEBDATA_INPUT       'b' /* raw request body */
+#define PHPDBG_WEBDATA_INPUT_FD    'f' /* empty, the body follows as a descriptor */
+#define PHPDBG_WEBDATA_CWD         'c' /* string */
+#define PHPDBG_WEBDATA_USERINI     'u' /* map */ /* }}} */
+
+/* {{{ capture file
+ * With phpdbg.capture_file set, sampled requests are appended to a file instead of being
+ * sent: the magic, then records made of a type byte, the hash of the static part and a
+ * length prefixed message. A process writes its static record before its first request
+ * record, replay looks static records up by hash. */
+#define PHPDBG_WEBDATA_CAPTURE_MAGIC  "\0PWC"
+#define PHPDBG_WEBDATA_RECORD_STATIC  'S'
+#define PHPDBG_WEBDATA_RECORD_REQUEST 'R'
+#define PHPDBG_WEBDATA_RECORD_LEN     (1 + PHPDBG_WEBDATA_HASH_LEN + 4) /* }}} */
+
+PHPDBG_API void phpdbg_webdata_compress_static(smart_str *buf TSRMLS_DC);
+PHPDBG_API void phpdbg_webdata_compress_request(smart_str *buf, int *body_fd TSRMLS_DC);
 
 #endif /* PHPDBG_WEBDATA_TRANSFER_H */
@@ -0,0 +1,148 @@
+/*
+   +----------------------------------------------------------------------+
+   | PHP Version 5                                                        |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 1997-2014 The PHP Group                                |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+   | Authors: Felipe Pena <felipe@php.net>                                |
+   | Authors: Joe Watkins <joe.watkins@live.co.uk>                        |
+   | Authors: Bob Weinand <bwoebi@php.net>                                |
+   +----------------------------------------------------------------------+
+*/
+
+/*
+ * Micro benchmark for the escaper used by phpdbg's XML output
+ *
+ * Build and run with:
+ *   cc -O2 -I. tests/bench/escape.c phpdbg_escape.c -o escape-bench && ./escape-bench
+ * add -mavx2 to use the AVX2 kernel, or make bench-phpdbg-escape inside php-src.
+ *
+ * The input mimics what ev/print of a variable holding a large JSON document
+ * produces: long clean runs of text, quotes around every key and value and an
+ * occasional &, < or newline.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "phpdbg_escape.h"
+
+#define BENCH_INPUT  (8 * 1024 * 1024)
+#define BENCH_ROUNDS 20
+
+/* what phpdbg did before: one pass for XML entities, another for control characters */
+static size_t escape_bytewise(char *out, const char *str, size_t len, char *tmp) {
+	size_t i;
+	char *p = tmp, *o = out;
+
+	for (i = 0; i < len; i++) {
+		if (str[i] == '&') {
+			memcpy(p, "&amp;", 5);
+			p += 5;
+		} else if (str[i] == '<') {
+			memcpy(p, "&lt;", 4);
+			p += 4;
+		} else if (str[i] == '"') {
+			memcpy(p, "&quot;", 6);
+			p += 6;
+		} else {
+			*p++ = str[i];
+		}
+	}
+
+	for (i = 0; i < (size_t) (p - tmp); i++) {
+		unsigned char c = tmp[i];
+
+		if (c < 0x20) {
+			*o++ = '&';
+			*o++ = '#';
+			if (c > 9) {
+				*o++ = (c / 10) + '0';
+			}
+			*o++ = (c % 10) + '0';
+			*o++ = ';';
+		} else {
+			*o++ = c;
+		}
+	}
+
+	return o - out;
+}
+
+static char *make_input(size_t len) {
+	static const char *chunks[] = {
+		"{\"id\":1234567,\"name\":\"Lorem ipsum dolor sit amet, consectetur adipiscing elit\",",
+		"\"tags\":[\"alpha\",\"beta\",\"gamma\"],\"active\":true,\"score\":0.98431,",
+		"\"description\":\"Sed ut perspiciatis unde omnis iste natus error sit voluptatem accusantium doloremque laudantium, totam rem aperiam\",",
+		"\"html\":\"<p>Tom & Jerry</p>\",\n",
+		"\"address\":{\"street\":\"Long Street 42\",\"city\":\"Springfield\",\"zip\":\"12345\"}},\n"
+	};
+	char *buf = malloc(len), *p = buf;
+	size_t i = 0;
+
+	while (p < buf + len) {
+		const char *chunk = chunks[i++ % (sizeof(chunks) / sizeof(*chunks))];
+		size_t n = strlen(chunk);
+
+		if (n > (size_t) (buf + len - p)) {
+			n = buf + len - p;
+		}
+		memcpy(p, chunk, n);
+		p += n;
+	}
+
+	return buf;
+}
+
+static double now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void) {
+	char *in = make_input(BENCH_INPUT);
+	char *out = malloc(BENCH_INPUT * PHPDBG_ESCAPE_MAX_EXPANSION);
+	char *ref = malloc(BENCH_INPUT * PHPDBG_ESCAPE_MAX_EXPANSION);
+	char *tmp = malloc(BENCH_INPUT * PHPDBG_ESCAPE_MAX_EXPANSION);
+	size_t outlen = 0, reflen = 0;
+	double start, bytewise, kernel;
+	int i;
+
+	start = now();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		reflen = escape_bytewise(ref, in, BENCH_INPUT, tmp);
+	}
+	bytewise = now() - start;
+
+	start = now();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		outlen = phpdbg_escape(out, in, BENCH_INPUT, PHPDBG_ESCAPE_XML | PHPDBG_ESCAPE_QUOT | PHPDBG_ESCAPE_CTRL, NULL, 0);
+	}
+	kernel = now() - start;
+
+	if (outlen != reflen || memcmp(out, ref, outlen)) {
+		fprintf(stderr, "output mismatch\n");
+		return 1;
+	}
+
+	printf("bytewise: %8.1f MB/s\n", BENCH_INPUT * (double) BENCH_ROUNDS / bytewise / 1e6);
+	printf("phpdbg_escape: %8.1f MB/s (%.1fx)\n", BENCH_INPUT * (double) BENCH_ROUNDS / kernel / 1e6, bytewise / kernel);
+
+	free(in);
+	free(out);
+	free(ref);
+	free(tmp);
+
+	return 0;
+}